@@ -15,20 +15,20 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef MT32EMU_LA32_WAVE_GENERATOR_H
-#define MT32EMU_LA32_WAVE_GENERATOR_H
+#ifndef MT32EMU_LA32_FLOAT_WAVE_GENERATOR_H
+#define MT32EMU_LA32_FLOAT_WAVE_GENERATOR_H
 
 namespace MT32Emu {
 
 /**
- * LA32WaveGenerator is aimed to represent the exact model of LA32 wave generator.
+ * LA32FloatWaveGenerator is aimed to represent the exact model of LA32 wave generator.
  * The output square wave is created by adding high / low linear segments in-between
  * the rising and falling cosine segments. Basically, its very similar to the phase distortion synthesis.
  * Behaviour of a true resonance filter is emulated by adding decaying sine wave.
  * The beginning and the ending of the resonant sine is multiplied by a cosine window.
  * To synthesise sawtooth waves, the resulting square wave is multiplied by synchronous cosine wave.
  */
-class LA32WaveGenerator {
+class LA32FloatWaveGenerator {
 	//***************************************************************************
 	//  The local copy of partial parameters below
 	//***************************************************************************
@@ -98,21 +98,16 @@ public:
 	bool isPCMWave() const;
 };
 
-// LA32PartialPair contains a structure of two partials being mixed / ring modulated
-class LA32PartialPair {
-	LA32WaveGenerator master;
-	LA32WaveGenerator slave;
+// LA32FloatPartialPair implements the partial pair with the float wave generator model
+class LA32FloatPartialPair : public LA32PartialPair {
+	LA32FloatWaveGenerator master;
+	LA32FloatWaveGenerator slave;
 	bool ringModulated;
 	bool mixed;
 	float masterOutputSample;
 	float slaveOutputSample;
 
 public:
-	enum PairType {
-		MASTER,
-		SLAVE
-	};
-
 	// ringModulated should be set to false for the structures with mixing or stereo output
 	// ringModulated should be set to true for the structures with ring modulation
 	// mixed is used for the structures with ring modulation and indicates whether the master partial output is mixed to the ring modulator output
@@ -130,6 +125,11 @@ public:
 	// Perform mixing / ring modulation and return the result
 	float nextOutSample();
 
+	// Generate up to length samples of the master partial and store the output to outBuf. Must not be used with ring modulation.
+	// The same as invoking generateNextSample() and nextOutSample() for each sample while the master partial remains active.
+	// Returns the number of samples generated, the last one of which may follow deactivation of the master partial.
+	unsigned long generateNextBlock(float *outBuf, const Bit32u *ampVals, const Bit16u *pitchVals, const Bit32u *cutoffVals, const unsigned long length);
+
 	// Deactivate the WG engine
 	void deactivate(const PairType master);
 
@@ -139,4 +139,4 @@ public:
 
 } // namespace MT32Emu
 
-#endif // #ifndef MT32EMU_LA32_WAVE_GENERATOR_H
+#endif // #ifndef MT32EMU_LA32_FLOAT_WAVE_GENERATOR_H
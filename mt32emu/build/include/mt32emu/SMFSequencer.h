@@ -0,0 +1,78 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MT32EMU_SMF_SEQUENCER_H
+#define MT32EMU_SMF_SEQUENCER_H
+
+namespace MT32Emu {
+
+class File;
+class Synth;
+
+// Plays a Standard MIDI File of type 0 or 1 on a synth.
+// On loading, the tracks are merged into a single stream of events sorted by time, and the tick times are converted
+// to timestamps in samples according to the tempo map. Thus, no memory is allocated during playback.
+// The events are enqueued into the MIDI event queue of the synth ahead of rendering, a chunk at a time.
+// A typical offline rendering loop looks like:
+//   while (sequencer.enqueueEvents(renderLength) || synth.isActive()) synth.render(buffer, renderLength);
+// The lookahead has to cover at least the length rendered next, so that all the events due are in the queue in time.
+// The queue should be able to accommodate the events within the lookahead, otherwise they are delayed till the next call.
+class SMFSequencer {
+private:
+	struct Event;
+	struct Track;
+
+	Synth &synth;
+
+	Event *events;
+	Bit32u eventCount;
+	// The sysex messages are stored consecutively, including the leading 0xF0 byte
+	Bit8u *sysexData;
+	Bit32u sysexDataLength;
+
+	Bit64u startTimestamp;
+	Bit32u nextEventIndex;
+
+	void parseTracks(Track *tracks, unsigned int trackCount, Bit16u division, bool countOnly);
+
+public:
+	// The synth remains owned by the caller, and it must outlive the sequencer.
+	SMFSequencer(Synth &synth);
+	~SMFSequencer();
+
+	// Parses the file and prepares the sequencer to play it from the current synth timestamp.
+	// The file isn't needed afterwards. Returns false if the file isn't a valid SMF of type 0 or 1.
+	bool load(File &file);
+	bool load(const Bit8u *data, size_t dataSize);
+	void unload();
+
+	// Rewinds to the beginning of the song, which is played starting from the specified synth timestamp.
+	void start(Bit64u startTimestamp);
+
+	// Enqueues the events due not later than lookaheadLength samples past the current synth timestamp.
+	// Returns false when there are no more events to enqueue.
+	// Should only be called from one thread at a time, though the synth may render concurrently.
+	bool enqueueEvents(Bit32u lookaheadLength);
+
+	// Returns the total number of events in the song, and the time of the last one in samples since the song start.
+	Bit32u getEventCount() const;
+	Bit64u getSongLength() const;
+};
+
+}
+
+#endif
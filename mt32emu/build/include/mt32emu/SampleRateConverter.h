@@ -0,0 +1,90 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MT32EMU_SAMPLE_RATE_CONVERTER_H
+#define MT32EMU_SAMPLE_RATE_CONVERTER_H
+
+namespace MT32Emu {
+
+class Synth;
+
+enum SampleRateConversionQuality {
+	// Short filter with wide transition band, suitable when CPU time is really precious
+	SampleRateConversionQuality_FASTEST,
+	SampleRateConversionQuality_FAST,
+	SampleRateConversionQuality_GOOD,
+	// Long filter with steep rolloff and high stopband attenuation
+	SampleRateConversionQuality_BEST
+};
+
+// Renders output of a synth converted to an arbitrary sample rate, e.g. 44100 or 48000 Hz.
+// Uses a polyphase windowed-sinc filter. The filter coefficients and all the buffers are allocated on construction,
+// so getOutputSamples() neither allocates memory nor needs any intermediate buffer in the application.
+// The output is aligned with the synth output, though the filter needs getLookahead() more samples to produce
+// an output sample. Thus, the synth is rendered that far ahead, and MIDI events should be timestamped accordingly.
+class SampleRateConverter {
+private:
+	Synth &synth;
+	const unsigned int outputSampleRate;
+
+	// Output to input sample rate ratio reduced to the smallest integers
+	Bit32u phaseCount;
+	Bit32u phaseIncrement;
+
+	// Number of filter phases actually stored, equals phaseCount unless the ratio is awkward
+	Bit32u tablePhaseCount;
+	unsigned int tapCount;
+	float *coefficients;
+
+	// Deinterleaved synth output, holding the samples covered by the filter window and the samples rendered ahead
+	float *inputBufferLeft;
+	float *inputBufferRight;
+	Bit32u inputBufferSize;
+	Bit32u inputBufferLength;
+	// Index of the input sample which precedes the current output sample or coincides with it
+	Bit32u inputPosition;
+	// Fractional position of the current output sample between inputPosition and inputPosition + 1, in 1 / phaseCount
+	Bit32u phase;
+
+	float *renderBuffer;
+
+	void initCoefficients(SampleRateConversionQuality quality);
+	void fillInputBuffer(Bit32u outputLength);
+	template <class Sample>
+	void doGetOutputSamples(Sample *buffer, Bit32u length);
+
+public:
+	// The synth must be open. It remains owned by the caller. The output sample rate must be non-zero.
+	SampleRateConverter(Synth &synth, unsigned int outputSampleRate, SampleRateConversionQuality quality);
+	~SampleRateConverter();
+
+	// Fills the buffer with the given number of stereo frames of interleaved output
+	void getOutputSamples(Bit16s *buffer, Bit32u length);
+	void getOutputSamples(float *buffer, Bit32u length);
+
+	// Returns the number of synth samples rendered ahead of the current output position
+	Bit32u getLookahead() const;
+
+	// Convert a time in output samples to the corresponding synth timestamp and vice versa,
+	// given both timelines start at the moment the converter is created.
+	double convertOutputToSynthTimestamp(double outputTimestamp) const;
+	double convertSynthToOutputTimestamp(double synthTimestamp) const;
+};
+
+}
+
+#endif
@@ -36,13 +36,18 @@ class Synth;
 
 class Tables {
 private:
-	Tables();
+	static const Tables instance;
+
+	Tables() {}
 	Tables(Tables &);
 
 public:
+	// The instance holds no data as all the tables are static constants, it's only kept to ease access via a short name.
 	static const Tables &getInstance();
 
 	// Constant LUTs
+	// The tables are generated by mt32emu-tablegen into TableData.cpp, so that they don't depend on the floating-point math
+	// of the platform and are placed in read-only data. The generator contains the formulas they are computed with.
 
 	// CONFIRMED: This is used to convert several parameters to amp-modifying values in the TVA envelope:
 	// - PatchTemp.outputLevel
@@ -50,21 +55,21 @@ public:
 	// - PartialParam.tva.level
 	// - expression
 	// It's used to determine how much to subtract from the amp envelope's target value
-	Bit8u levelToAmpSubtraction[101];
+	static const Bit8u levelToAmpSubtraction[101];
 
 	// CONFIRMED: ...
-	Bit8u envLogarithmicTime[256];
+	static const Bit8u envLogarithmicTime[256];
 
 	// CONFIRMED: ...
-	Bit8u masterVolToAmpSubtraction[101];
+	static const Bit8u masterVolToAmpSubtraction[101];
 
 	// CONFIRMED:
-	Bit8u pulseWidth100To255[101];
+	static const Bit8u pulseWidth100To255[101];
 
-	Bit16u exp9[512];
-	Bit16u logsin9[512];
+	static const Bit16u exp9[512];
+	static const Bit16u logsin9[512];
 
-	const Bit8u *resAmpDecayFactor;
+	static const Bit8u resAmpDecayFactor[8];
 };
 
 }
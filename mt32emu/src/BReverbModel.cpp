@@ -36,7 +36,7 @@ static const Bit32u MODE_3_FEEDBACK_DELAY = 1;
 
 // Default reverb settings for "new" reverb model implemented in CM-32L / LAPC-I.
 // Found by tracing reverb RAM data lines (thanks go to Lord_Nightmare & balrog).
-const BReverbSettings &BReverbModel::getCM32L_LAPCSettings(const ReverbMode mode) {
+static const BReverbSettings &getCM32L_LAPCSettings(const ReverbMode mode) {
 	static const Bit32u MODE_0_NUMBER_OF_ALLPASSES = 3;
 	static const Bit32u MODE_0_ALLPASSES[] = {994, 729, 78};
 	static const Bit32u MODE_0_NUMBER_OF_COMBS = 4; // Well, actually there are 3 comb filters, but the entrance LPF + delay can be processed via a hacked comb.
@@ -105,7 +105,7 @@ const BReverbSettings &BReverbModel::getCM32L_LAPCSettings(const ReverbMode mode
 
 // Default reverb settings for "old" reverb model implemented in MT-32.
 // Found by tracing reverb RAM data lines (thanks go to Lord_Nightmare & balrog).
-const BReverbSettings &BReverbModel::getMT32Settings(const ReverbMode mode) {
+static const BReverbSettings &getMT32Settings(const ReverbMode mode) {
 	static const Bit32u MODE_0_NUMBER_OF_ALLPASSES = 3;
 	static const Bit32u MODE_0_ALLPASSES[] = {994, 729, 78};
 	static const Bit32u MODE_0_NUMBER_OF_COMBS = 4; // Same as above in the new model implementation
@@ -174,11 +174,9 @@ const BReverbSettings &BReverbModel::getMT32Settings(const ReverbMode mode) {
 
 // This algorithm tries to emulate exactly Boss multiplication operation (at least this is what we see on reverb RAM data lines).
 // Also LA32 is suspected to use the similar one to perform PCM interpolation and ring modulation.
-static Sample weirdMul(Sample a, Bit8u addMask, Bit8u carryMask) {
+static Bit16s weirdMul(Bit16s a, Bit8u addMask, Bit8u carryMask) {
 	(void)carryMask;
-#if MT32EMU_USE_FLOAT_SAMPLES
-	return a * addMask / 256.0f;
-#elif MT32EMU_BOSS_REVERB_PRECISE_MODE
+#if MT32EMU_BOSS_REVERB_PRECISE_MODE
 	Bit8u mask = 0x80;
 	Bit32s res = 0;
 	for (int i = 0; i < 8; i++) {
@@ -189,220 +187,270 @@ static Sample weirdMul(Sample a, Bit8u addMask, Bit8u carryMask) {
 	}
 	return res;
 #else
-	return Sample(((Bit32s)a * addMask) >> 8);
+	return Bit16s(((Bit32s)a * addMask) >> 8);
 #endif
 }
 
-RingBuffer::RingBuffer(Bit32u newsize) : size(newsize), index(0) {
-	buffer = new Sample[size];
+static float weirdMul(float a, Bit8u addMask, Bit8u carryMask) {
+	(void)carryMask;
+	return a * addMask / 256.0f;
 }
 
-RingBuffer::~RingBuffer() {
-	delete[] buffer;
-	buffer = NULL;
+static inline Bit16s halveSample(const Bit16s sample) {
+	return sample >> 1;
 }
 
-Sample RingBuffer::next() {
-	if (++index >= size) {
-		index = 0;
-	}
-	return buffer[index];
+static inline float halveSample(const float sample) {
+	return 0.5f * sample;
 }
 
-bool RingBuffer::isEmpty() const {
-	if (buffer == NULL) return true;
-
-#if MT32EMU_USE_FLOAT_SAMPLES
-	Sample max = 0.001f;
-#else
-	Sample max = 8;
-#endif
-	Sample *buf = buffer;
-	for (Bit32u i = 0; i < size; i++) {
-		if (*buf < -max || *buf > max) return false;
-		buf++;
-	}
-	return true;
+static inline bool isSampleAudible(const Bit16s sample) {
+	return sample < -8 || sample > 8;
 }
 
-void RingBuffer::mute() {
-	Synth::muteSampleBuffer(buffer, size);
+static inline bool isSampleAudible(const float sample) {
+	return sample < -0.001f || sample > 0.001f;
 }
 
-AllpassFilter::AllpassFilter(const Bit32u useSize) : RingBuffer(useSize) {}
-
-Sample AllpassFilter::process(const Sample in) {
-	// This model corresponds to the allpass filter implementation of the real CM-32L device
-	// found from sample analysis
-
-	const Sample bufferOut = next();
-
-#if MT32EMU_USE_FLOAT_SAMPLES
-	// store input - feedback / 2
-	buffer[index] = in - 0.5f * bufferOut;
-
-	// return buffer output + feedforward / 2
-	return bufferOut + 0.5f * buffer[index];
-#else
-	// store input - feedback / 2
-	buffer[index] = in - (bufferOut >> 1);
-
-	// return buffer output + feedforward / 2
-	return bufferOut + (buffer[index] >> 1);
-#endif
+// This introduces reverb noise which actually makes output from the real Boss chip nondeterministic
+static inline Bit16s addReverbNoise(const Bit16s sample) {
+	return sample - 1;
 }
 
-CombFilter::CombFilter(const Bit32u useSize, const Bit32u useFilterFactor) : RingBuffer(useSize), filterFactor(useFilterFactor) {}
-
-void CombFilter::process(const Sample in) {
-	// This model corresponds to the comb filter implementation of the real CM-32L device
-
-	// the previously stored value
-	const Sample last = buffer[index];
-
-	// prepare input + feedback
-	const Sample filterIn = in + weirdMul(next(), feedbackFactor, 0xF0);
-
-	// store input + feedback processed by a low-pass filter
-	buffer[index] = weirdMul(last, filterFactor, 0xC0) - filterIn;
+static inline float addReverbNoise(const float sample) {
+	return sample;
 }
 
-Sample CombFilter::getOutputAt(const Bit32u outIndex) const {
-	return buffer[(size + index - outIndex) % size];
+static inline Bit16s mixCombOutputs(Bit16s out1, Bit16s out2, const Bit16s out3) {
+	out1 += out1 >> 1;
+	out2 += out2 >> 1;
+	return out1 + out2 + out3;
 }
 
-void CombFilter::setFeedbackFactor(const Bit32u useFeedbackFactor) {
-	feedbackFactor = useFeedbackFactor;
+static inline float mixCombOutputs(const float out1, const float out2, const float out3) {
+	return 1.5f * (out1 + out2) + out3;
 }
 
-DelayWithLowPassFilter::DelayWithLowPassFilter(const Bit32u useSize, const Bit32u useFilterFactor, const Bit32u useAmp)
-	: CombFilter(useSize, useFilterFactor), amp(useAmp) {}
-
-void DelayWithLowPassFilter::process(const Sample in) {
-	// the previously stored value
-	const Sample last = buffer[index];
+// Number of samples processed by each stage of the model at a time
+static const Bit32u REVERB_BLOCK_SIZE = 128;
+
+// The ring buffer of a filter, which is a view into the arena allocated by the reverb model.
+// The filters are processed by the model in blocks, with the state kept in locals inside the loops.
+template <class Sample>
+struct RingBuffer {
+	Sample *buffer;
+	Bit32u size;
+	Bit32u index;
+	// Number of the subsequent stores that remain until the last audible sample stored is overwritten.
+	// Since exactly one sample is stored per processed sample, this tells whether the buffer contains
+	// any audible samples without scanning it.
+	Bit32u audibleSampleCountdown;
+
+	void init(Sample *useBuffer, const Bit32u useSize) {
+		buffer = useBuffer;
+		size = useSize;
+		index = 0;
+		audibleSampleCountdown = 0;
+	}
 
-	// move to the next index
-	next();
+	// Updates the countdown after a block of stores. audibleStoreEnd is the number of stores in the block
+	// up to and including the last one of an audible sample, or 0 if none of the stored samples is audible.
+	void updateAudibleSampleCountdown(const Bit32u audibleStoreEnd, const Bit32u storeCount) {
+		if (audibleStoreEnd > 0) {
+			Bit32u storesSinceAudible = storeCount - audibleStoreEnd;
+			audibleSampleCountdown = storesSinceAudible < size ? size - storesSinceAudible : 0;
+		} else {
+			audibleSampleCountdown = audibleSampleCountdown > storeCount ? audibleSampleCountdown - storeCount : 0;
+		}
+	}
 
-	// low-pass filter process
-	Sample lpfOut = weirdMul(last, filterFactor, 0xFF) + in;
+	bool isEmpty() const {
+		return audibleSampleCountdown == 0;
+	}
+};
 
-	// store lpfOut multiplied by LPF amp factor
-	buffer[index] = weirdMul(lpfOut, amp, 0xFF);
+// Returns the sample stored outIndex samples before the one at the index. The outIndex must not exceed the size.
+template <class Sample>
+static inline Sample getOutputAt(const Sample *buffer, const Bit32u size, const Bit32u index, const Bit32u outIndex) {
+	Bit32u position = index + size - outIndex;
+	return buffer[position < size ? position : position - size];
 }
 
-TapDelayCombFilter::TapDelayCombFilter(const Bit32u useSize, const Bit32u useFilterFactor) : CombFilter(useSize, useFilterFactor) {}
+// This model corresponds to the allpass filter implementation of the real CM-32L device
+// found from sample analysis
+template <class Sample>
+static void processAllpassBlock(RingBuffer<Sample> &allpass, Sample *samples, const Bit32u length) {
+	Sample * const buffer = allpass.buffer;
+	const Bit32u size = allpass.size;
+	Bit32u index = allpass.index;
+	Bit32u audibleStoreEnd = 0;
+	for (Bit32u i = 0; i < length; i++) {
+		if (++index >= size) {
+			index = 0;
+		}
+		const Sample bufferOut = buffer[index];
 
-void TapDelayCombFilter::process(const Sample in) {
-	// the previously stored value
-	const Sample last = buffer[index];
+		// store input - feedback / 2
+		const Sample stored = samples[i] - halveSample(bufferOut);
+		buffer[index] = stored;
+		if (isSampleAudible(stored)) {
+			audibleStoreEnd = i + 1;
+		}
 
-	// move to the next index
-	next();
+		// return buffer output + feedforward / 2
+		samples[i] = bufferOut + halveSample(stored);
+	}
+	allpass.index = index;
+	allpass.updateAudibleSampleCountdown(audibleStoreEnd, length);
+}
 
-	// prepare input + feedback
-	// Actually, the size of the filter varies with the TIME parameter, the feedback sample is taken from the position just below the right output
-	const Sample filterIn = in + weirdMul(getOutputAt(outR + MODE_3_FEEDBACK_DELAY), feedbackFactor, 0xF0);
+// The reverb engine is specialised at compile time for the tap delay mode, which uses a single comb filter with taps,
+// and the other modes, where the entrance LPF + delay is followed by three series allpass filters and three parallel comb filters.
+// All the ring buffers are allocated in a single arena, and each stage of the model processes a block of samples at a time.
+template <class Sample, bool TAP_DELAY_MODE>
+class BReverbModelImpl : public BReverbModel {
+	Sample *arena;
+	Bit32u arenaSize;
+	// False if the arena is provided by the caller of open()
+	bool arenaOwned;
+	RingBuffer<Sample> allpasses[3];
+	// In the tap delay mode, only the first comb is used. Otherwise, the first one is the entrance LPF + delay.
+	RingBuffer<Sample> combs[4];
+
+	const BReverbSettings &currentSettings;
+	Bit32u combFeedbackFactors[4];
+	Bit32u tapDelayOutL;
+	Bit32u tapDelayOutR;
+	Bit32u dryAmp;
+	Bit32u wetLevel;
+
+	void produceOutput(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, unsigned long numSamples);
+	void processTapDelayBlock(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, const Bit32u length);
+	void processBlock(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, const Bit32u length);
+
+public:
+	BReverbModelImpl(const ReverbMode mode, const bool mt32CompatibleModel) :
+		arena(NULL), arenaSize(0), arenaOwned(false),
+		currentSettings(mt32CompatibleModel ? getMT32Settings(mode) : getCM32L_LAPCSettings(mode)),
+		tapDelayOutL(0), tapDelayOutR(0), dryAmp(0), wetLevel(0) {
+		memset(combFeedbackFactors, 0, sizeof(combFeedbackFactors));
+	}
 
-	// store input + feedback processed by a low-pass filter
-	buffer[index] = weirdMul(last, filterFactor, 0xF0) - filterIn;
-}
+	~BReverbModelImpl() {
+		close();
+	}
 
-Sample TapDelayCombFilter::getLeftOutput() const {
-	return getOutputAt(outL + PROCESS_DELAY + MODE_3_ADDITIONAL_DELAY);
-}
+	Bit32u getBufferSize() const;
+	void open(void *buffers);
+	void close();
+	void mute();
+	void setParameters(Bit8u time, Bit8u level);
+	bool isActive() const;
 
-Sample TapDelayCombFilter::getRightOutput() const {
-	return getOutputAt(outR + PROCESS_DELAY + MODE_3_ADDITIONAL_DELAY);
-}
+	bool process(const Bit16s *inLeft, const Bit16s *inRight, Bit16s *outLeft, Bit16s *outRight, unsigned long numSamples) {
+		return processSamples(inLeft, inRight, outLeft, outRight, numSamples);
+	}
 
-void TapDelayCombFilter::setOutputPositions(const Bit32u useOutL, const Bit32u useOutR) {
-	outL = useOutL;
-	outR = useOutR;
-}
+	bool process(const float *inLeft, const float *inRight, float *outLeft, float *outRight, unsigned long numSamples) {
+		return processSamples(inLeft, inRight, outLeft, outRight, numSamples);
+	}
 
-BReverbModel::BReverbModel(const ReverbMode mode, const bool mt32CompatibleModel) :
-	allpasses(NULL), combs(NULL),
-	currentSettings(mt32CompatibleModel ? getMT32Settings(mode) : getCM32L_LAPCSettings(mode)),
-	tapDelayMode(mode == REVERB_MODE_TAP_DELAY) {}
+private:
+	bool processSamples(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, unsigned long numSamples) {
+		produceOutput(inLeft, inRight, outLeft, outRight, numSamples);
+		return true;
+	}
 
-BReverbModel::~BReverbModel() {
-	close();
-}
+	// Samples of a type different from the renderer type are rejected
+	template <class OtherSample>
+	bool processSamples(const OtherSample *, const OtherSample *, OtherSample *, OtherSample *, unsigned long) {
+		return false;
+	}
+};
 
-void BReverbModel::open() {
-	if (currentSettings.numberOfAllpasses > 0) {
-		allpasses = new AllpassFilter*[currentSettings.numberOfAllpasses];
-		for (Bit32u i = 0; i < currentSettings.numberOfAllpasses; i++) {
-			allpasses[i] = new AllpassFilter(currentSettings.allpassSizes[i]);
+BReverbModel *BReverbModel::createBReverbModel(const ReverbMode mode, const bool mt32CompatibleModel, const RendererType rendererType) {
+	if (mode == REVERB_MODE_TAP_DELAY) {
+		if (rendererType == RendererType_FLOAT) {
+			return new BReverbModelImpl<float, true>(mode, mt32CompatibleModel);
 		}
+		return new BReverbModelImpl<Bit16s, true>(mode, mt32CompatibleModel);
 	}
-	combs = new CombFilter*[currentSettings.numberOfCombs];
-	if (tapDelayMode) {
-		*combs = new TapDelayCombFilter(*currentSettings.combSizes, *currentSettings.filterFactors);
-	} else {
-		combs[0] = new DelayWithLowPassFilter(currentSettings.combSizes[0], currentSettings.filterFactors[0], currentSettings.lpfAmp);
-		for (Bit32u i = 1; i < currentSettings.numberOfCombs; i++) {
-			combs[i] = new CombFilter(currentSettings.combSizes[i], currentSettings.filterFactors[i]);
-		}
+	if (rendererType == RendererType_FLOAT) {
+		return new BReverbModelImpl<float, false>(mode, mt32CompatibleModel);
 	}
-	mute();
+	return new BReverbModelImpl<Bit16s, false>(mode, mt32CompatibleModel);
 }
 
-void BReverbModel::close() {
-	if (allpasses != NULL) {
-		for (Bit32u i = 0; i < currentSettings.numberOfAllpasses; i++) {
-			if (allpasses[i] != NULL) {
-				delete allpasses[i];
-				allpasses[i] = NULL;
-			}
-		}
-		delete[] allpasses;
-		allpasses = NULL;
+template <class Sample, bool TAP_DELAY_MODE>
+Bit32u BReverbModelImpl<Sample, TAP_DELAY_MODE>::getBufferSize() const {
+	Bit32u bufferSize = 0;
+	for (Bit32u i = 0; i < currentSettings.numberOfAllpasses; i++) {
+		bufferSize += currentSettings.allpassSizes[i];
 	}
-	if (combs != NULL) {
-		for (Bit32u i = 0; i < currentSettings.numberOfCombs; i++) {
-			if (combs[i] != NULL) {
-				delete combs[i];
-				combs[i] = NULL;
-			}
-		}
-		delete[] combs;
-		combs = NULL;
+	for (Bit32u i = 0; i < currentSettings.numberOfCombs; i++) {
+		bufferSize += currentSettings.combSizes[i];
 	}
+	return bufferSize;
 }
 
-void BReverbModel::mute() {
-	if (allpasses != NULL) {
+template <class Sample, bool TAP_DELAY_MODE>
+void BReverbModelImpl<Sample, TAP_DELAY_MODE>::open(void *buffers) {
+	if (arena == NULL) {
+		arenaSize = getBufferSize();
+		arenaOwned = buffers == NULL;
+		arena = arenaOwned ? new Sample[arenaSize] : static_cast<Sample *>(buffers);
+		Sample *buffer = arena;
 		for (Bit32u i = 0; i < currentSettings.numberOfAllpasses; i++) {
-			allpasses[i]->mute();
+			allpasses[i].init(buffer, currentSettings.allpassSizes[i]);
+			buffer += currentSettings.allpassSizes[i];
 		}
-	}
-	if (combs != NULL) {
 		for (Bit32u i = 0; i < currentSettings.numberOfCombs; i++) {
-			combs[i]->mute();
+			combs[i].init(buffer, currentSettings.combSizes[i]);
+			buffer += currentSettings.combSizes[i];
 		}
 	}
+	mute();
+}
+
+template <class Sample, bool TAP_DELAY_MODE>
+void BReverbModelImpl<Sample, TAP_DELAY_MODE>::close() {
+	if (arenaOwned) {
+		delete[] arena;
+	}
+	arena = NULL;
+	arenaSize = 0;
+}
+
+template <class Sample, bool TAP_DELAY_MODE>
+void BReverbModelImpl<Sample, TAP_DELAY_MODE>::mute() {
+	if (arena == NULL) return;
+	Synth::muteSampleBuffer(arena, arenaSize);
+	for (Bit32u i = 0; i < currentSettings.numberOfAllpasses; i++) {
+		allpasses[i].audibleSampleCountdown = 0;
+	}
+	for (Bit32u i = 0; i < currentSettings.numberOfCombs; i++) {
+		combs[i].audibleSampleCountdown = 0;
+	}
 }
 
-void BReverbModel::setParameters(Bit8u time, Bit8u level) {
-	if (combs == NULL) return;
+template <class Sample, bool TAP_DELAY_MODE>
+void BReverbModelImpl<Sample, TAP_DELAY_MODE>::setParameters(Bit8u time, Bit8u level) {
+	if (arena == NULL) return;
 	level &= 7;
 	time &= 7;
-	if (tapDelayMode) {
-		TapDelayCombFilter *comb = static_cast<TapDelayCombFilter *> (*combs);
-		comb->setOutputPositions(currentSettings.outLPositions[time], currentSettings.outRPositions[time & 7]);
-		comb->setFeedbackFactor(currentSettings.feedbackFactors[((level < 3) || (time < 6)) ? 0 : 1]);
+	if (TAP_DELAY_MODE) {
+		tapDelayOutL = currentSettings.outLPositions[time];
+		tapDelayOutR = currentSettings.outRPositions[time];
+		combFeedbackFactors[0] = currentSettings.feedbackFactors[((level < 3) || (time < 6)) ? 0 : 1];
 	} else {
 		for (Bit32u i = 0; i < currentSettings.numberOfCombs; i++) {
-			combs[i]->setFeedbackFactor(currentSettings.feedbackFactors[(i << 3) + time]);
+			combFeedbackFactors[i] = currentSettings.feedbackFactors[(i << 3) + time];
 		}
 	}
 	if (time == 0 && level == 0) {
 		dryAmp = wetLevel = 0;
 	} else {
-		if (tapDelayMode && ((time == 0) || (time == 1 && level == 1))) {
+		if (TAP_DELAY_MODE && ((time == 0) || (time == 1 && level == 1))) {
 			// Looks like MT-32 implementation has some minor quirks in this mode:
 			// for odd level values, the output level changes sometimes depending on the time value which doesn't seem right.
 			dryAmp = currentSettings.dryAmps[level + 8];
@@ -413,95 +461,199 @@ void BReverbModel::setParameters(Bit8u time, Bit8u level) {
 	}
 }
 
-bool BReverbModel::isActive() const {
-	if (combs == NULL) {
+template <class Sample, bool TAP_DELAY_MODE>
+bool BReverbModelImpl<Sample, TAP_DELAY_MODE>::isActive() const {
+	if (arena == NULL) {
 		return false;
 	}
 	for (Bit32u i = 0; i < currentSettings.numberOfAllpasses; i++) {
-		if (!allpasses[i]->isEmpty()) return true;
+		if (!allpasses[i].isEmpty()) return true;
 	}
 	for (Bit32u i = 0; i < currentSettings.numberOfCombs; i++) {
-		if (!combs[i]->isEmpty()) return true;
+		if (!combs[i].isEmpty()) return true;
 	}
 	return false;
 }
 
-void BReverbModel::process(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, unsigned long numSamples) {
-	if (combs == NULL) {
+template <class Sample, bool TAP_DELAY_MODE>
+void BReverbModelImpl<Sample, TAP_DELAY_MODE>::produceOutput(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, unsigned long numSamples) {
+	if (arena == NULL) {
 		Synth::muteSampleBuffer(outLeft, numSamples);
 		Synth::muteSampleBuffer(outRight, numSamples);
 		return;
 	}
 
-	Sample dry;
+	// Receives the output of the channels not requested
+	Sample discardedOutput[REVERB_BLOCK_SIZE];
 
-	while ((numSamples--) > 0) {
-		if (tapDelayMode) {
-			dry = *(inLeft++) / 2 + *(inRight++) / 2;
+	while (numSamples > 0) {
+		const Bit32u length = numSamples < REVERB_BLOCK_SIZE ? Bit32u(numSamples) : REVERB_BLOCK_SIZE;
+		Sample *blockOutLeft = outLeft != NULL ? outLeft : discardedOutput;
+		Sample *blockOutRight = outRight != NULL ? outRight : discardedOutput;
+		if (TAP_DELAY_MODE) {
+			processTapDelayBlock(inLeft, inRight, blockOutLeft, blockOutRight, length);
 		} else {
-			dry = *(inLeft++) / 4 + *(inRight++) / 4;
+			processBlock(inLeft, inRight, blockOutLeft, blockOutRight, length);
+		}
+		inLeft += length;
+		inRight += length;
+		if (outLeft != NULL) {
+			outLeft += length;
+		}
+		if (outRight != NULL) {
+			outRight += length;
 		}
+		numSamples -= length;
+	}
+}
+
+template <class Sample, bool TAP_DELAY_MODE>
+void BReverbModelImpl<Sample, TAP_DELAY_MODE>::processTapDelayBlock(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, const Bit32u length) {
+	RingBuffer<Sample> &comb = combs[0];
+	Sample * const buffer = comb.buffer;
+	const Bit32u size = comb.size;
+	Bit32u index = comb.index;
+	const Bit32u filterFactor = currentSettings.filterFactors[0];
+	const Bit32u feedbackFactor = combFeedbackFactors[0];
+	// Actually, the size of the filter varies with the TIME parameter, the feedback sample is taken from the position just below the right output
+	const Bit32u feedbackOutIndex = tapDelayOutR + MODE_3_FEEDBACK_DELAY;
+	const Bit32u leftOutIndex = tapDelayOutL + PROCESS_DELAY + MODE_3_ADDITIONAL_DELAY;
+	const Bit32u rightOutIndex = tapDelayOutR + PROCESS_DELAY + MODE_3_ADDITIONAL_DELAY;
 
-		// Looks like dryAmp doesn't change in MT-32 but it does in CM-32L / LAPC-I
+	// the previously stored value
+	Sample last = buffer[index];
+	Bit32u audibleStoreEnd = 0;
+	for (Bit32u i = 0; i < length; i++) {
+		Sample dry = inLeft[i] / 2 + inRight[i] / 2;
 		dry = weirdMul(dry, dryAmp, 0xFF);
 
-		if (tapDelayMode) {
-			TapDelayCombFilter *comb = static_cast<TapDelayCombFilter *> (*combs);
-			comb->process(dry);
-			if (outLeft != NULL) {
-				*(outLeft++) = weirdMul(comb->getLeftOutput(), wetLevel, 0xFF);
+		// move to the next index
+		if (++index >= size) {
+			index = 0;
+		}
+
+		// prepare input + feedback
+		const Sample filterIn = dry + weirdMul(getOutputAt(buffer, size, index, feedbackOutIndex), feedbackFactor, 0xF0);
+
+		// store input + feedback processed by a low-pass filter
+		last = weirdMul(last, filterFactor, 0xF0) - filterIn;
+		buffer[index] = last;
+		if (isSampleAudible(last)) {
+			audibleStoreEnd = i + 1;
+		}
+
+		outLeft[i] = weirdMul(getOutputAt(buffer, size, index, leftOutIndex), wetLevel, 0xFF);
+		outRight[i] = weirdMul(getOutputAt(buffer, size, index, rightOutIndex), wetLevel, 0xFF);
+	}
+	comb.index = index;
+	comb.updateAudibleSampleCountdown(audibleStoreEnd, length);
+}
+
+template <class Sample, bool TAP_DELAY_MODE>
+void BReverbModelImpl<Sample, TAP_DELAY_MODE>::processBlock(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, const Bit32u length) {
+	Sample link[REVERB_BLOCK_SIZE];
+
+	// Entrance LPF + delay
+	{
+		RingBuffer<Sample> &entrance = combs[0];
+		Sample * const buffer = entrance.buffer;
+		const Bit32u size = entrance.size;
+		Bit32u index = entrance.index;
+		const Bit32u filterFactor = currentSettings.filterFactors[0];
+		const Bit32u lpfAmp = currentSettings.lpfAmp;
+
+		// the previously stored value
+		Sample last = buffer[index];
+		Bit32u audibleStoreEnd = 0;
+		for (Bit32u i = 0; i < length; i++) {
+			Sample dry = inLeft[i] / 4 + inRight[i] / 4;
+
+			// Looks like dryAmp doesn't change in MT-32 but it does in CM-32L / LAPC-I
+			dry = weirdMul(dry, dryAmp, 0xFF);
+
+			// move to the next index
+			if (++index >= size) {
+				index = 0;
 			}
-			if (outRight != NULL) {
-				*(outRight++) = weirdMul(comb->getRightOutput(), wetLevel, 0xFF);
+
+			// The output position is equal to the size, so it is taken before the sample is overwritten
+			link[i] = addReverbNoise(buffer[index]);
+
+			// low-pass filter process
+			const Sample lpfOut = weirdMul(last, filterFactor, 0xFF) + dry;
+
+			// store lpfOut multiplied by LPF amp factor
+			last = weirdMul(lpfOut, lpfAmp, 0xFF);
+			buffer[index] = last;
+			if (isSampleAudible(last)) {
+				audibleStoreEnd = i + 1;
 			}
-		} else {
-			// If the output position is equal to the comb size, get it now in order not to loose it
-			Sample link = combs[0]->getOutputAt(currentSettings.combSizes[0] - 1);
+		}
+		entrance.index = index;
+		entrance.updateAudibleSampleCountdown(audibleStoreEnd, length);
+	}
 
-			// Entrance LPF. Note, comb.process() differs a bit here.
-			combs[0]->process(dry);
+	processAllpassBlock(allpasses[0], link, length);
+	processAllpassBlock(allpasses[1], link, length);
+	processAllpassBlock(allpasses[2], link, length);
+
+	// The three parallel comb filters are processed in a single loop, with their state kept in arrays,
+	// which the compiler may unroll and interleave.
+	Sample *buffers[3];
+	Bit32u sizes[3];
+	Bit32u indices[3];
+	Bit32u filterFactors[3];
+	Bit32u feedbackFactors[3];
+	Sample lastStored[3];
+	Bit32u audibleStoreEnds[3];
+	for (int c = 0; c < 3; c++) {
+		const RingBuffer<Sample> &comb = combs[c + 1];
+		buffers[c] = comb.buffer;
+		sizes[c] = comb.size;
+		indices[c] = comb.index;
+		filterFactors[c] = currentSettings.filterFactors[c + 1];
+		feedbackFactors[c] = combFeedbackFactors[c + 1];
+		lastStored[c] = comb.buffer[comb.index];
+		audibleStoreEnds[c] = 0;
+	}
+	const Bit32u * const outLPositions = currentSettings.outLPositions;
+	const Bit32u * const outRPositions = currentSettings.outRPositions;
 
-#if !MT32EMU_USE_FLOAT_SAMPLES
-			// This introduces reverb noise which actually makes output from the real Boss chip nondeterministic
-			link = link - 1;
-#endif
-			link = allpasses[0]->process(link);
-			link = allpasses[1]->process(link);
-			link = allpasses[2]->process(link);
-
-			// If the output position is equal to the comb size, get it now in order not to loose it
-			Sample outL1 = combs[1]->getOutputAt(currentSettings.outLPositions[0] - 1);
-
-			combs[1]->process(link);
-			combs[2]->process(link);
-			combs[3]->process(link);
-
-			if (outLeft != NULL) {
-				Sample outL2 = combs[2]->getOutputAt(currentSettings.outLPositions[1]);
-				Sample outL3 = combs[3]->getOutputAt(currentSettings.outLPositions[2]);
-#if MT32EMU_USE_FLOAT_SAMPLES
-				Sample outSample = 1.5f * (outL1 + outL2) + outL3;
-#else
-				outL1 += outL1 >> 1;
-				outL2 += outL2 >> 1;
-				Sample outSample = outL1 + outL2 + outL3;
-#endif
-				*(outLeft++) = weirdMul(outSample, wetLevel, 0xFF);
+	for (Bit32u i = 0; i < length; i++) {
+		const Sample in = link[i];
+
+		// If the output position is equal to the comb size, get it now in order not to loose it
+		const Sample outL1 = getOutputAt(buffers[0], sizes[0], indices[0], outLPositions[0] - 1);
+
+		// This model corresponds to the comb filter implementation of the real CM-32L device
+		for (int c = 0; c < 3; c++) {
+			if (++indices[c] >= sizes[c]) {
+				indices[c] = 0;
 			}
-			if (outRight != NULL) {
-				Sample outR1 = combs[1]->getOutputAt(currentSettings.outRPositions[0]);
-				Sample outR2 = combs[2]->getOutputAt(currentSettings.outRPositions[1]);
-				Sample outR3 = combs[3]->getOutputAt(currentSettings.outRPositions[2]);
-#if MT32EMU_USE_FLOAT_SAMPLES
-				Sample outSample = 1.5f * (outR1 + outR2) + outR3;
-#else
-				outR1 += outR1 >> 1;
-				outR2 += outR2 >> 1;
-				Sample outSample = outR1 + outR2 + outR3;
-#endif
-				*(outRight++) = weirdMul(outSample, wetLevel, 0xFF);
+
+			// prepare input + feedback
+			const Sample filterIn = in + weirdMul(buffers[c][indices[c]], feedbackFactors[c], 0xF0);
+
+			// store input + feedback processed by a low-pass filter
+			lastStored[c] = weirdMul(lastStored[c], filterFactors[c], 0xC0) - filterIn;
+			buffers[c][indices[c]] = lastStored[c];
+			if (isSampleAudible(lastStored[c])) {
+				audibleStoreEnds[c] = i + 1;
 			}
 		}
+
+		const Sample outL2 = getOutputAt(buffers[1], sizes[1], indices[1], outLPositions[1]);
+		const Sample outL3 = getOutputAt(buffers[2], sizes[2], indices[2], outLPositions[2]);
+		outLeft[i] = weirdMul(mixCombOutputs(outL1, outL2, outL3), wetLevel, 0xFF);
+
+		const Sample outR1 = getOutputAt(buffers[0], sizes[0], indices[0], outRPositions[0]);
+		const Sample outR2 = getOutputAt(buffers[1], sizes[1], indices[1], outRPositions[1]);
+		const Sample outR3 = getOutputAt(buffers[2], sizes[2], indices[2], outRPositions[2]);
+		outRight[i] = weirdMul(mixCombOutputs(outR1, outR2, outR3), wetLevel, 0xFF);
+	}
+	for (int c = 0; c < 3; c++) {
+		combs[c + 1].index = indices[c];
+		combs[c + 1].updateAudibleSampleCountdown(audibleStoreEnds[c], length);
 	}
 }
 
@@ -34,82 +34,28 @@ struct BReverbSettings {
 	const Bit32u lpfAmp;
 };
 
-class RingBuffer {
-protected:
-	Sample *buffer;
-	const Bit32u size;
-	Bit32u index;
-
-public:
-	RingBuffer(const Bit32u size);
-	virtual ~RingBuffer();
-	Sample next();
-	bool isEmpty() const;
-	void mute();
-};
-
-class AllpassFilter : public RingBuffer {
-public:
-	AllpassFilter(const Bit32u size);
-	Sample process(const Sample in);
-};
-
-class CombFilter : public RingBuffer {
-protected:
-	const Bit32u filterFactor;
-	Bit32u feedbackFactor;
-
-public:
-	CombFilter(const Bit32u size, const Bit32u useFilterFactor);
-	virtual void process(const Sample in);
-	Sample getOutputAt(const Bit32u outIndex) const;
-	void setFeedbackFactor(const Bit32u useFeedbackFactor);
-};
-
-class DelayWithLowPassFilter : public CombFilter {
-	Bit32u amp;
-
-public:
-	DelayWithLowPassFilter(const Bit32u useSize, const Bit32u useFilterFactor, const Bit32u useAmp);
-	void process(const Sample in);
-	void setFeedbackFactor(const Bit32u) {}
-};
-
-class TapDelayCombFilter : public CombFilter {
-	Bit32u outL;
-	Bit32u outR;
-
-public:
-	TapDelayCombFilter(const Bit32u useSize, const Bit32u useFilterFactor);
-	void process(const Sample in);
-	Sample getLeftOutput() const;
-	Sample getRightOutput() const;
-	void setOutputPositions(const Bit32u useOutL, const Bit32u useOutR);
-};
-
+// Interface of the reverb model which is implemented for either type of samples produced by the renderer.
 class BReverbModel {
-	AllpassFilter **allpasses;
-	CombFilter **combs;
-
-	const BReverbSettings &currentSettings;
-	const bool tapDelayMode;
-	Bit32u dryAmp;
-	Bit32u wetLevel;
-	void mute();
-
-	static const BReverbSettings &getCM32L_LAPCSettings(const ReverbMode mode);
-	static const BReverbSettings &getMT32Settings(const ReverbMode mode);
-
 public:
-	BReverbModel(const ReverbMode mode, const bool mt32CompatibleModel = false);
-	~BReverbModel();
+	static BReverbModel *createBReverbModel(const ReverbMode mode, const bool mt32CompatibleModel, const RendererType rendererType);
+
+	virtual ~BReverbModel() {}
+	// Returns the number of samples of the renderer type the buffers of the model occupy.
+	virtual Bit32u getBufferSize() const = 0;
 	// After construction or a close(), open() must be called at least once before any other call (with the exception of close()).
-	void open();
+	// The buffers are placed at the specified location, which should accommodate getBufferSize() samples of the renderer type,
+	// and remain valid until close(). The location may be shared among the models that are never used at the same time,
+	// provided that the model is muted before it is used in turn. If NULL, the model allocates the buffers itself.
+	virtual void open(void *buffers = NULL) = 0;
 	// May be called multiple times without an open() in between.
-	void close();
-	void setParameters(Bit8u time, Bit8u level);
-	void process(const Sample *inLeft, const Sample *inRight, Sample *outLeft, Sample *outRight, unsigned long numSamples);
-	bool isActive() const;
+	virtual void close() = 0;
+	virtual void mute() = 0;
+	virtual void setParameters(Bit8u time, Bit8u level) = 0;
+	// Returns true while any audible samples remain in the buffers. This is tracked during processing, so the call is cheap.
+	virtual bool isActive() const = 0;
+	// Returns false and leaves the output intact unless the sample type matches the renderer type the model is created for.
+	virtual bool process(const Bit16s *inLeft, const Bit16s *inRight, Bit16s *outLeft, Bit16s *outRight, unsigned long numSamples) = 0;
+	virtual bool process(const float *inLeft, const float *inRight, float *outLeft, float *outRight, unsigned long numSamples) = 0;
 };
 
 }
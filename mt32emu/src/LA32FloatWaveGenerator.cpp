@@ -26,7 +26,7 @@ static const float MIDDLE_CUTOFF_VALUE = 128.0f;
 static const float RESONANCE_DECAY_THRESHOLD_CUTOFF_VALUE = 144.0f;
 static const float MAX_CUTOFF_VALUE = 240.0f;
 
-float LA32WaveGenerator::getPCMSample(unsigned int position) {
+float LA32FloatWaveGenerator::getPCMSample(unsigned int position) {
 	if (position >= pcmWaveLength) {
 		if (!pcmWaveLooped) {
 			return 0;
@@ -38,7 +38,7 @@ float LA32WaveGenerator::getPCMSample(unsigned int position) {
 	return ((pcmSample & 32768) == 0) ? sampleValue : -sampleValue;
 }
 
-void LA32WaveGenerator::initSynth(const bool sawtoothWaveform, const Bit8u pulseWidth, const Bit8u resonance) {
+void LA32FloatWaveGenerator::initSynth(const bool sawtoothWaveform, const Bit8u pulseWidth, const Bit8u resonance) {
 	this->sawtoothWaveform = sawtoothWaveform;
 	this->pulseWidth = pulseWidth;
 	this->resonance = resonance;
@@ -50,7 +50,7 @@ void LA32WaveGenerator::initSynth(const bool sawtoothWaveform, const Bit8u pulse
 	active = true;
 }
 
-void LA32WaveGenerator::initPCM(const Bit16s * const pcmWaveAddress, const Bit32u pcmWaveLength, const bool pcmWaveLooped, const bool pcmWaveInterpolated) {
+void LA32FloatWaveGenerator::initPCM(const Bit16s * const pcmWaveAddress, const Bit32u pcmWaveLength, const bool pcmWaveLooped, const bool pcmWaveInterpolated) {
 	this->pcmWaveAddress = pcmWaveAddress;
 	this->pcmWaveLength = pcmWaveLength;
 	this->pcmWaveLooped = pcmWaveLooped;
@@ -60,7 +60,7 @@ void LA32WaveGenerator::initPCM(const Bit16s * const pcmWaveAddress, const Bit32
 	active = true;
 }
 
-float LA32WaveGenerator::generateNextSample(const Bit32u ampVal, const Bit16u pitch, const Bit32u cutoffRampVal) {
+float LA32FloatWaveGenerator::generateNextSample(const Bit32u ampVal, const Bit16u pitch, const Bit32u cutoffRampVal) {
 	if (!active) {
 		return 0.0f;
 	}
@@ -272,26 +272,26 @@ float LA32WaveGenerator::generateNextSample(const Bit32u ampVal, const Bit16u pi
 	return sample;
 }
 
-void LA32WaveGenerator::deactivate() {
+void LA32FloatWaveGenerator::deactivate() {
 	active = false;
 }
 
-bool LA32WaveGenerator::isActive() const {
+bool LA32FloatWaveGenerator::isActive() const {
 	return active;
 }
 
-bool LA32WaveGenerator::isPCMWave() const {
+bool LA32FloatWaveGenerator::isPCMWave() const {
 	return pcmWaveAddress != NULL;
 }
 
-void LA32PartialPair::init(const bool ringModulated, const bool mixed) {
+void LA32FloatPartialPair::init(const bool ringModulated, const bool mixed) {
 	this->ringModulated = ringModulated;
 	this->mixed = mixed;
 	masterOutputSample = 0.0f;
 	slaveOutputSample = 0.0f;
 }
 
-void LA32PartialPair::initSynth(const PairType useMaster, const bool sawtoothWaveform, const Bit8u pulseWidth, const Bit8u resonance) {
+void LA32FloatPartialPair::initSynth(const PairType useMaster, const bool sawtoothWaveform, const Bit8u pulseWidth, const Bit8u resonance) {
 	if (useMaster == MASTER) {
 		master.initSynth(sawtoothWaveform, pulseWidth, resonance);
 	} else {
@@ -299,7 +299,7 @@ void LA32PartialPair::initSynth(const PairType useMaster, const bool sawtoothWav
 	}
 }
 
-void LA32PartialPair::initPCM(const PairType useMaster, const Bit16s *pcmWaveAddress, const Bit32u pcmWaveLength, const bool pcmWaveLooped) {
+void LA32FloatPartialPair::initPCM(const PairType useMaster, const Bit16s *pcmWaveAddress, const Bit32u pcmWaveLength, const bool pcmWaveLooped) {
 	if (useMaster == MASTER) {
 		master.initPCM(pcmWaveAddress, pcmWaveLength, pcmWaveLooped, true);
 	} else {
@@ -307,7 +307,7 @@ void LA32PartialPair::initPCM(const PairType useMaster, const Bit16s *pcmWaveAdd
 	}
 }
 
-void LA32PartialPair::generateNextSample(const PairType useMaster, const Bit32u amp, const Bit16u pitch, const Bit32u cutoff) {
+void LA32FloatPartialPair::generateNextSample(const PairType useMaster, const Bit32u amp, const Bit16u pitch, const Bit32u cutoff) {
 	if (useMaster == MASTER) {
 		masterOutputSample = master.generateNextSample(amp, pitch, cutoff);
 	} else {
@@ -324,7 +324,7 @@ static inline float produceDistortedSample(float sample) {
 	return sample;
 }
 
-float LA32PartialPair::nextOutSample() {
+float LA32FloatPartialPair::nextOutSample() {
 	if (!ringModulated) {
 		return masterOutputSample + slaveOutputSample;
 	}
@@ -340,7 +340,16 @@ float LA32PartialPair::nextOutSample() {
 	return mixed ? masterOutputSample + ringModulatedSample : ringModulatedSample;
 }
 
-void LA32PartialPair::deactivate(const PairType useMaster) {
+unsigned long LA32FloatPartialPair::generateNextBlock(float *outBuf, const Bit32u *ampVals, const Bit16u *pitchVals, const Bit32u *cutoffVals, const unsigned long length) {
+	unsigned long generatedLength = 0;
+	while (generatedLength < length && master.isActive()) {
+		generateNextSample(MASTER, ampVals[generatedLength], pitchVals[generatedLength], cutoffVals[generatedLength]);
+		outBuf[generatedLength++] = nextOutSample();
+	}
+	return generatedLength;
+}
+
+void LA32FloatPartialPair::deactivate(const PairType useMaster) {
 	if (useMaster == MASTER) {
 		master.deactivate();
 		masterOutputSample = 0.0f;
@@ -350,7 +359,7 @@ void LA32PartialPair::deactivate(const PairType useMaster) {
 	}
 }
 
-bool LA32PartialPair::isActive(const PairType useMaster) const {
+bool LA32FloatPartialPair::isActive(const PairType useMaster) const {
 	return useMaster == MASTER ? master.isActive() : slave.isActive();
 }
 
@@ -20,10 +20,6 @@
 #include "mmath.h"
 #include "LA32WaveGenerator.h"
 
-#if MT32EMU_USE_FLOAT_SAMPLES
-#include "LA32FloatWaveGenerator.cpp"
-#else
-
 namespace MT32Emu {
 
 static const Bit32u SINE_SEGMENT_RELATIVE_LENGTH = 1 << 18;
@@ -32,20 +28,35 @@ static const Bit32u RESONANCE_DECAY_THRESHOLD_CUTOFF_VALUE = 144 << 18;
 static const Bit32u MAX_CUTOFF_VALUE = 240 << 18;
 static const LogSample SILENCE = {65535, LogSample::POSITIVE};
 
-Bit16u LA32Utilites::interpolateExp(const Bit16u fract) {
+// The stages of the block generation run through this many samples at once, so that the intermediate arrays stay small
+static const Bit32u SYNTH_BLOCK_LENGTH = 64;
+
+static inline Bit16u interpolateExpTable(const Bit16u *exp9, const Bit16u fract) {
 	Bit16u expTabIndex = fract >> 3;
 	Bit16u extraBits = ~fract & 7;
-	Bit16u expTabEntry2 = 8191 - Tables::getInstance().exp9[expTabIndex];
-	Bit16u expTabEntry1 = expTabIndex == 0 ? 8191 : (8191 - Tables::getInstance().exp9[expTabIndex - 1]);
+	Bit16u expTabEntry2 = 8191 - exp9[expTabIndex];
+	Bit16u expTabEntry1 = expTabIndex == 0 ? 8191 : (8191 - exp9[expTabIndex - 1]);
 	return expTabEntry2 + (((expTabEntry1 - expTabEntry2) * extraBits) >> 3);
 }
 
+static inline Bit16s unlogTable(const Bit16u *exp9, const Bit16u logValue, const bool negative) {
+	Bit32u intLogValue = logValue >> 12;
+	Bit16u fracLogValue = logValue & 4095;
+	Bit16s sample = interpolateExpTable(exp9, fracLogValue) >> intLogValue;
+	return negative ? -sample : sample;
+}
+
+static inline Bit16u clampLogValue(const Bit32u logValue) {
+	return logValue < 65536 ? (Bit16u)logValue : 65535;
+}
+
+Bit16u LA32Utilites::interpolateExp(const Bit16u fract) {
+	return interpolateExpTable(Tables::getInstance().exp9, fract);
+}
+
 Bit16s LA32Utilites::unlog(const LogSample &logSample) {
 	//Bit16s sample = (Bit16s)EXP2F(13.0f - logSample.logValue / 1024.0f);
-	Bit32u intLogValue = logSample.logValue >> 12;
-	Bit16u fracLogValue = logSample.logValue & 4095;
-	Bit16s sample = interpolateExp(fracLogValue) >> intLogValue;
-	return logSample.sign == LogSample::POSITIVE ? sample : -sample;
+	return unlogTable(Tables::getInstance().exp9, logSample.logValue, logSample.sign == LogSample::NEGATIVE);
 }
 
 void LA32Utilites::addLogSamples(LogSample &logSample1, const LogSample &logSample2) {
@@ -54,23 +65,23 @@ void LA32Utilites::addLogSamples(LogSample &logSample1, const LogSample &logSamp
 	logSample1.sign = logSample1.sign == logSample2.sign ? LogSample::POSITIVE : LogSample::NEGATIVE;
 }
 
-Bit32u LA32WaveGenerator::getSampleStep() {
+Bit32u LA32WaveGenerator::getSampleStep(const Bit16u *exp9, const Bit16u pitch) {
 	// sampleStep = EXP2F(pitch / 4096.0f + 4.0f)
-	Bit32u sampleStep = LA32Utilites::interpolateExp(~pitch & 4095);
+	Bit32u sampleStep = interpolateExpTable(exp9, ~pitch & 4095);
 	sampleStep <<= pitch >> 12;
 	sampleStep >>= 8;
 	sampleStep &= ~1;
 	return sampleStep;
 }
 
-Bit32u LA32WaveGenerator::getResonanceWaveLengthFactor(Bit32u effectiveCutoffValue) {
+Bit32u LA32WaveGenerator::getResonanceWaveLengthFactor(const Bit16u *exp9, const Bit32u effectiveCutoffValue) {
 	// resonanceWaveLengthFactor = (Bit32u)EXP2F(12.0f + effectiveCutoffValue / 4096.0f);
-	Bit32u resonanceWaveLengthFactor = LA32Utilites::interpolateExp(~effectiveCutoffValue & 4095);
+	Bit32u resonanceWaveLengthFactor = interpolateExpTable(exp9, ~effectiveCutoffValue & 4095);
 	resonanceWaveLengthFactor <<= effectiveCutoffValue >> 12;
 	return resonanceWaveLengthFactor;
 }
 
-Bit32u LA32WaveGenerator::getHighLinearLength(Bit32u effectiveCutoffValue) {
+Bit32u LA32WaveGenerator::getHighLinearLength(const Bit16u *exp9, const Bit8u pulseWidth, const Bit32u effectiveCutoffValue) {
 	// Ratio of positive segment to wave length
 	Bit32u effectivePulseWidthValue = 0;
 	if (pulseWidth > 128) {
@@ -81,70 +92,67 @@ Bit32u LA32WaveGenerator::getHighLinearLength(Bit32u effectiveCutoffValue) {
 	// highLinearLength = EXP2F(19.0f - effectivePulseWidthValue / 4096.0f + effectiveCutoffValue / 4096.0f) - 2 * SINE_SEGMENT_RELATIVE_LENGTH;
 	if (effectivePulseWidthValue < effectiveCutoffValue) {
 		Bit32u expArg = effectiveCutoffValue - effectivePulseWidthValue;
-		highLinearLength = LA32Utilites::interpolateExp(~expArg & 4095);
+		highLinearLength = interpolateExpTable(exp9, ~expArg & 4095);
 		highLinearLength <<= 7 + (expArg >> 12);
 		highLinearLength -= 2 * SINE_SEGMENT_RELATIVE_LENGTH;
 	}
 	return highLinearLength;
 }
 
-void LA32WaveGenerator::computePositions(Bit32u highLinearLength, Bit32u lowLinearLength, Bit32u resonanceWaveLengthFactor) {
+LA32WaveGenerator::SquareWavePhase LA32WaveGenerator::computePositions(const Bit32u wavePosition, const Bit32u highLinearLength, const Bit32u lowLinearLength, const Bit32u resonanceWaveLengthFactor, Bit32u &squareWavePosition, Bit32u &resonanceSinePosition) {
 	// Assuming 12-bit multiplication used here
 	squareWavePosition = resonanceSinePosition = (wavePosition >> 8) * (resonanceWaveLengthFactor >> 4);
 	if (squareWavePosition < SINE_SEGMENT_RELATIVE_LENGTH) {
-		phase = POSITIVE_RISING_SINE_SEGMENT;
-		return;
+		return POSITIVE_RISING_SINE_SEGMENT;
 	}
 	squareWavePosition -= SINE_SEGMENT_RELATIVE_LENGTH;
 	if (squareWavePosition < highLinearLength) {
-		phase = POSITIVE_LINEAR_SEGMENT;
-		return;
+		return POSITIVE_LINEAR_SEGMENT;
 	}
 	squareWavePosition -= highLinearLength;
 	if (squareWavePosition < SINE_SEGMENT_RELATIVE_LENGTH) {
-		phase = POSITIVE_FALLING_SINE_SEGMENT;
-		return;
+		return POSITIVE_FALLING_SINE_SEGMENT;
 	}
 	squareWavePosition -= SINE_SEGMENT_RELATIVE_LENGTH;
 	resonanceSinePosition = squareWavePosition;
 	if (squareWavePosition < SINE_SEGMENT_RELATIVE_LENGTH) {
-		phase = NEGATIVE_FALLING_SINE_SEGMENT;
-		return;
+		return NEGATIVE_FALLING_SINE_SEGMENT;
 	}
 	squareWavePosition -= SINE_SEGMENT_RELATIVE_LENGTH;
 	if (squareWavePosition < lowLinearLength) {
-		phase = NEGATIVE_LINEAR_SEGMENT;
-		return;
+		return NEGATIVE_LINEAR_SEGMENT;
 	}
 	squareWavePosition -= lowLinearLength;
-	phase = NEGATIVE_RISING_SINE_SEGMENT;
+	return NEGATIVE_RISING_SINE_SEGMENT;
+}
+
+LA32WaveGenerator::ResonanceWavePhase LA32WaveGenerator::getResonancePhase(const SquareWavePhase phase, const Bit32u resonanceSinePosition) {
+	return ResonanceWavePhase(((resonanceSinePosition >> 18) + (phase > POSITIVE_FALLING_SINE_SEGMENT ? 2 : 0)) & 3);
 }
 
 void LA32WaveGenerator::advancePosition() {
-	wavePosition += getSampleStep();
+	const Bit16u *exp9 = Tables::getInstance().exp9;
+	wavePosition += getSampleStep(exp9, pitch);
 	wavePosition %= 4 * SINE_SEGMENT_RELATIVE_LENGTH;
 
 	Bit32u effectiveCutoffValue = (cutoffVal > MIDDLE_CUTOFF_VALUE) ? (cutoffVal - MIDDLE_CUTOFF_VALUE) >> 10 : 0;
-	Bit32u resonanceWaveLengthFactor = getResonanceWaveLengthFactor(effectiveCutoffValue);
-	Bit32u highLinearLength = getHighLinearLength(effectiveCutoffValue);
+	Bit32u resonanceWaveLengthFactor = getResonanceWaveLengthFactor(exp9, effectiveCutoffValue);
+	Bit32u highLinearLength = getHighLinearLength(exp9, pulseWidth, effectiveCutoffValue);
 	Bit32u lowLinearLength = (resonanceWaveLengthFactor << 8) - 4 * SINE_SEGMENT_RELATIVE_LENGTH - highLinearLength;
-	computePositions(highLinearLength, lowLinearLength, resonanceWaveLengthFactor);
-
-	// resonancePhase computation hack
-	int *resonancePhaseAlias = (int *)&resonancePhase;
-	*resonancePhaseAlias = ((resonanceSinePosition >> 18) + (phase > POSITIVE_FALLING_SINE_SEGMENT ? 2 : 0)) & 3;
+	phase = computePositions(wavePosition, highLinearLength, lowLinearLength, resonanceWaveLengthFactor, squareWavePosition, resonanceSinePosition);
+	resonancePhase = getResonancePhase(phase, resonanceSinePosition);
 }
 
-void LA32WaveGenerator::generateNextSquareWaveLogSample() {
+Bit32u LA32WaveGenerator::getSquareWaveLogValue(const Bit16u *logsin9, const SquareWavePhase phase, const Bit32u squareWavePosition, const Bit32u amp, const Bit32u cutoffVal) {
 	Bit32u logSampleValue;
 	switch (phase) {
 		case POSITIVE_RISING_SINE_SEGMENT:
 		case NEGATIVE_FALLING_SINE_SEGMENT:
-			logSampleValue = Tables::getInstance().logsin9[(squareWavePosition >> 9) & 511];
+			logSampleValue = logsin9[(squareWavePosition >> 9) & 511];
 			break;
 		case POSITIVE_FALLING_SINE_SEGMENT:
 		case NEGATIVE_RISING_SINE_SEGMENT:
-			logSampleValue = Tables::getInstance().logsin9[~(squareWavePosition >> 9) & 511];
+			logSampleValue = logsin9[~(squareWavePosition >> 9) & 511];
 			break;
 		case POSITIVE_LINEAR_SEGMENT:
 		case NEGATIVE_LINEAR_SEGMENT:
@@ -157,57 +165,63 @@ void LA32WaveGenerator::generateNextSquareWaveLogSample() {
 	if (cutoffVal < MIDDLE_CUTOFF_VALUE) {
 		logSampleValue += (MIDDLE_CUTOFF_VALUE - cutoffVal) >> 9;
 	}
+	return logSampleValue;
+}
 
-	squareLogSample.logValue = logSampleValue < 65536 ? (Bit16u)logSampleValue : 65535;
+void LA32WaveGenerator::generateNextSquareWaveLogSample() {
+	squareLogSample.logValue = clampLogValue(getSquareWaveLogValue(Tables::getInstance().logsin9, phase, squareWavePosition, amp, cutoffVal));
 	squareLogSample.sign = phase < NEGATIVE_FALLING_SINE_SEGMENT ? LogSample::POSITIVE : LogSample::NEGATIVE;
 }
 
-void LA32WaveGenerator::generateNextResonanceWaveLogSample() {
+Bit32u LA32WaveGenerator::getResonanceWaveLogValue(const Bit16u *logsin9, const SquareWavePhase usePhase, const ResonanceWavePhase useResonancePhase, const Bit32u useSquareWavePosition, const Bit32u useResonanceSinePosition, const Bit32u useAmp, const Bit32u useCutoffVal) const {
 	Bit32u logSampleValue;
-	if (resonancePhase == POSITIVE_FALLING_RESONANCE_SINE_SEGMENT || resonancePhase == NEGATIVE_RISING_RESONANCE_SINE_SEGMENT) {
-		logSampleValue = Tables::getInstance().logsin9[~(resonanceSinePosition >> 9) & 511];
+	if (useResonancePhase == POSITIVE_FALLING_RESONANCE_SINE_SEGMENT || useResonancePhase == NEGATIVE_RISING_RESONANCE_SINE_SEGMENT) {
+		logSampleValue = logsin9[~(useResonanceSinePosition >> 9) & 511];
 	} else {
-		logSampleValue = Tables::getInstance().logsin9[(resonanceSinePosition >> 9) & 511];
+		logSampleValue = logsin9[(useResonanceSinePosition >> 9) & 511];
 	}
 	logSampleValue <<= 2;
-	logSampleValue += amp >> 10;
+	logSampleValue += useAmp >> 10;
 
 	// From the digital captures, the decaying speed of the resonance sine is found a bit different for the positive and the negative segments
-	Bit32u decayFactor = phase < NEGATIVE_FALLING_SINE_SEGMENT ? resAmpDecayFactor : resAmpDecayFactor + 1;
+	Bit32u decayFactor = usePhase < NEGATIVE_FALLING_SINE_SEGMENT ? resAmpDecayFactor : resAmpDecayFactor + 1;
 	// Unsure about resonanceSinePosition here. It's possible that dedicated counter & decrement are used. Although, cutoff is finely ramped, so maybe not.
-	logSampleValue += resonanceAmpSubtraction + (((resonanceSinePosition >> 4) * decayFactor) >> 8);
+	logSampleValue += resonanceAmpSubtraction + (((useResonanceSinePosition >> 4) * decayFactor) >> 8);
 
 	// To ensure the output wave has no breaks, two different windows are appied to the beginning and the ending of the resonance sine segment
-	if (phase == POSITIVE_RISING_SINE_SEGMENT || phase == NEGATIVE_FALLING_SINE_SEGMENT) {
+	if (usePhase == POSITIVE_RISING_SINE_SEGMENT || usePhase == NEGATIVE_FALLING_SINE_SEGMENT) {
 		// The window is synchronous sine here
-		logSampleValue += Tables::getInstance().logsin9[(squareWavePosition >> 9) & 511] << 2;
-	} else if (phase == POSITIVE_FALLING_SINE_SEGMENT || phase == NEGATIVE_RISING_SINE_SEGMENT) {
+		logSampleValue += logsin9[(useSquareWavePosition >> 9) & 511] << 2;
+	} else if (usePhase == POSITIVE_FALLING_SINE_SEGMENT || usePhase == NEGATIVE_RISING_SINE_SEGMENT) {
 		// The window is synchronous square sine here
-		logSampleValue += Tables::getInstance().logsin9[~(squareWavePosition >> 9) & 511] << 3;
+		logSampleValue += logsin9[~(useSquareWavePosition >> 9) & 511] << 3;
 	}
 
-	if (cutoffVal < MIDDLE_CUTOFF_VALUE) {
+	if (useCutoffVal < MIDDLE_CUTOFF_VALUE) {
 		// For the cutoff values below the cutoff middle point, it seems the amp of the resonance wave is expotentially decayed
-		logSampleValue += 31743 + ((MIDDLE_CUTOFF_VALUE - cutoffVal) >> 9);
-	} else if (cutoffVal < RESONANCE_DECAY_THRESHOLD_CUTOFF_VALUE) {
+		logSampleValue += 31743 + ((MIDDLE_CUTOFF_VALUE - useCutoffVal) >> 9);
+	} else if (useCutoffVal < RESONANCE_DECAY_THRESHOLD_CUTOFF_VALUE) {
 		// For the cutoff values below this point, the amp of the resonance wave is sinusoidally decayed
-		Bit32u sineIx = (cutoffVal - MIDDLE_CUTOFF_VALUE) >> 13;
-		logSampleValue += Tables::getInstance().logsin9[sineIx] << 2;
+		Bit32u sineIx = (useCutoffVal - MIDDLE_CUTOFF_VALUE) >> 13;
+		logSampleValue += logsin9[sineIx] << 2;
 	}
 
 	// After all the amp decrements are added, it should be safe now to adjust the amp of the resonance wave to what we see on captures
 	logSampleValue -= 1 << 12;
+	return logSampleValue;
+}
 
-	resonanceLogSample.logValue = logSampleValue < 65536 ? (Bit16u)logSampleValue : 65535;
+void LA32WaveGenerator::generateNextResonanceWaveLogSample() {
+	resonanceLogSample.logValue = clampLogValue(getResonanceWaveLogValue(Tables::getInstance().logsin9, phase, resonancePhase, squareWavePosition, resonanceSinePosition, amp, cutoffVal));
 	resonanceLogSample.sign = resonancePhase < NEGATIVE_FALLING_RESONANCE_SINE_SEGMENT ? LogSample::POSITIVE : LogSample::NEGATIVE;
 }
 
-void LA32WaveGenerator::generateNextSawtoothCosineLogSample(LogSample &logSample) const {
+void LA32WaveGenerator::getSawtoothCosineLogSample(const Bit16u *logsin9, const Bit32u wavePosition, LogSample &logSample) {
 	Bit32u sawtoothCosinePosition = wavePosition + (1 << 18);
 	if ((sawtoothCosinePosition & (1 << 18)) > 0) {
-		logSample.logValue = Tables::getInstance().logsin9[~(sawtoothCosinePosition >> 9) & 511];
+		logSample.logValue = logsin9[~(sawtoothCosinePosition >> 9) & 511];
 	} else {
-		logSample.logValue = Tables::getInstance().logsin9[(sawtoothCosinePosition >> 9) & 511];
+		logSample.logValue = logsin9[(sawtoothCosinePosition >> 9) & 511];
 	}
 	logSample.logValue <<= 2;
 	logSample.sign = ((sawtoothCosinePosition & (1 << 19)) == 0) ? LogSample::POSITIVE : LogSample::NEGATIVE;
@@ -308,13 +322,98 @@ void LA32WaveGenerator::generateNextSample(const Bit32u useAmp, const Bit16u use
 	generateNextResonanceWaveLogSample();
 	if (sawtoothWaveform) {
 		LogSample cosineLogSample;
-		generateNextSawtoothCosineLogSample(cosineLogSample);
+		getSawtoothCosineLogSample(Tables::getInstance().logsin9, wavePosition, cosineLogSample);
 		LA32Utilites::addLogSamples(squareLogSample, cosineLogSample);
 		LA32Utilites::addLogSamples(resonanceLogSample, cosineLogSample);
 	}
 	advancePosition();
 }
 
+void LA32WaveGenerator::generateNextSynthBlock(Bit16s *outBuf, const Bit32u *ampVals, const Bit16u *pitchVals, const Bit32u *cutoffVals, const Bit32u length) {
+	const Tables &tables = Tables::getInstance();
+	const Bit16u *exp9 = tables.exp9;
+	const Bit16u *logsin9 = tables.logsin9;
+
+	Bit32u clampedCutoffVals[SYNTH_BLOCK_LENGTH];
+	Bit32u sampleSteps[SYNTH_BLOCK_LENGTH];
+	Bit32u resonanceWaveLengthFactors[SYNTH_BLOCK_LENGTH];
+	Bit32u highLinearLengths[SYNTH_BLOCK_LENGTH];
+	Bit32u lowLinearLengths[SYNTH_BLOCK_LENGTH];
+	// The positions include the one to continue from after the block
+	Bit32u wavePositions[SYNTH_BLOCK_LENGTH + 1];
+	Bit32u squareWavePositions[SYNTH_BLOCK_LENGTH + 1];
+	Bit32u resonanceSinePositions[SYNTH_BLOCK_LENGTH + 1];
+	SquareWavePhase phases[SYNTH_BLOCK_LENGTH + 1];
+	ResonanceWavePhase resonancePhases[SYNTH_BLOCK_LENGTH + 1];
+
+	for (Bit32u offset = 0; offset < length; offset += SYNTH_BLOCK_LENGTH) {
+		const Bit32u blockLength = length - offset < SYNTH_BLOCK_LENGTH ? length - offset : SYNTH_BLOCK_LENGTH;
+		const Bit32u *blockAmpVals = ampVals + offset;
+		Bit16s *blockOutBuf = outBuf + offset;
+
+		// The wave shape of each sample only depends on the control values
+		for (Bit32u i = 0; i < blockLength; i++) {
+			// The 240 cutoffVal limit was determined via sample analysis (internal Munt capture IDs: glop3, glop4).
+			// More research is needed to be sure that this is correct, however.
+			Bit32u clampedCutoffVal = (cutoffVals[offset + i] > MAX_CUTOFF_VALUE) ? MAX_CUTOFF_VALUE : cutoffVals[offset + i];
+			clampedCutoffVals[i] = clampedCutoffVal;
+			sampleSteps[i] = getSampleStep(exp9, pitchVals[offset + i]);
+			Bit32u effectiveCutoffValue = (clampedCutoffVal > MIDDLE_CUTOFF_VALUE) ? (clampedCutoffVal - MIDDLE_CUTOFF_VALUE) >> 10 : 0;
+			resonanceWaveLengthFactors[i] = getResonanceWaveLengthFactor(exp9, effectiveCutoffValue);
+			highLinearLengths[i] = getHighLinearLength(exp9, pulseWidth, effectiveCutoffValue);
+			lowLinearLengths[i] = (resonanceWaveLengthFactors[i] << 8) - 4 * SINE_SEGMENT_RELATIVE_LENGTH - highLinearLengths[i];
+		}
+
+		// Only the wave position accumulates from sample to sample. Like advancePosition() does, the positions within
+		// the square and the resonance waves are derived from it using the wave shape of the preceding sample.
+		wavePositions[0] = wavePosition;
+		squareWavePositions[0] = squareWavePosition;
+		resonanceSinePositions[0] = resonanceSinePosition;
+		phases[0] = phase;
+		resonancePhases[0] = resonancePhase;
+		for (Bit32u i = 0; i < blockLength; i++) {
+			Bit32u nextWavePosition = (wavePositions[i] + sampleSteps[i]) % (4 * SINE_SEGMENT_RELATIVE_LENGTH);
+			wavePositions[i + 1] = nextWavePosition;
+			phases[i + 1] = computePositions(nextWavePosition, highLinearLengths[i], lowLinearLengths[i], resonanceWaveLengthFactors[i], squareWavePositions[i + 1], resonanceSinePositions[i + 1]);
+			resonancePhases[i + 1] = getResonancePhase(phases[i + 1], resonanceSinePositions[i + 1]);
+		}
+
+		// Finally, the samples are independent of each other
+		for (Bit32u i = 0; i < blockLength; i++) {
+			Bit16u squareLogValue = clampLogValue(getSquareWaveLogValue(logsin9, phases[i], squareWavePositions[i], blockAmpVals[i], clampedCutoffVals[i]));
+			bool squareNegative = phases[i] >= NEGATIVE_FALLING_SINE_SEGMENT;
+			Bit16u resonanceLogValue = clampLogValue(getResonanceWaveLogValue(logsin9, phases[i], resonancePhases[i], squareWavePositions[i], resonanceSinePositions[i], blockAmpVals[i], clampedCutoffVals[i]));
+			bool resonanceNegative = resonancePhases[i] >= NEGATIVE_FALLING_RESONANCE_SINE_SEGMENT;
+			if (sawtoothWaveform) {
+				LogSample cosineLogSample;
+				getSawtoothCosineLogSample(logsin9, wavePositions[i], cosineLogSample);
+				bool cosineNegative = cosineLogSample.sign == LogSample::NEGATIVE;
+				squareLogValue = clampLogValue(squareLogValue + cosineLogSample.logValue);
+				squareNegative = squareNegative != cosineNegative;
+				resonanceLogValue = clampLogValue(resonanceLogValue + cosineLogSample.logValue);
+				resonanceNegative = resonanceNegative != cosineNegative;
+			}
+			blockOutBuf[i] = unlogTable(exp9, squareLogValue, squareNegative) + unlogTable(exp9, resonanceLogValue, resonanceNegative);
+			if (offset + i + 1 == length) {
+				// Leave the state as generateNextSample() would
+				squareLogSample.logValue = squareLogValue;
+				squareLogSample.sign = squareNegative ? LogSample::NEGATIVE : LogSample::POSITIVE;
+				resonanceLogSample.logValue = resonanceLogValue;
+				resonanceLogSample.sign = resonanceNegative ? LogSample::NEGATIVE : LogSample::POSITIVE;
+			}
+		}
+
+		wavePosition = wavePositions[blockLength];
+		squareWavePosition = squareWavePositions[blockLength];
+		resonanceSinePosition = resonanceSinePositions[blockLength];
+		phase = phases[blockLength];
+		resonancePhase = resonancePhases[blockLength];
+		amp = blockAmpVals[blockLength - 1];
+		pitch = pitchVals[offset + blockLength - 1];
+		cutoffVal = clampedCutoffVals[blockLength - 1];
+	}
+}
+
 LogSample LA32WaveGenerator::getOutputLogSample(const bool first) const {
 	if (!isActive()) {
 		return SILENCE;
@@ -341,12 +440,12 @@ Bit32u LA32WaveGenerator::getPCMInterpolationFactor() const {
 	return pcmInterpolationFactor;
 }
 
-void LA32PartialPair::init(const bool useRingModulated, const bool useMixed) {
+void LA32IntPartialPair::init(const bool useRingModulated, const bool useMixed) {
 	ringModulated = useRingModulated;
 	mixed = useMixed;
 }
 
-void LA32PartialPair::initSynth(const PairType useMaster, const bool sawtoothWaveform, const Bit8u pulseWidth, const Bit8u resonance) {
+void LA32IntPartialPair::initSynth(const PairType useMaster, const bool sawtoothWaveform, const Bit8u pulseWidth, const Bit8u resonance) {
 	if (useMaster == MASTER) {
 		master.initSynth(sawtoothWaveform, pulseWidth, resonance);
 	} else {
@@ -354,7 +453,7 @@ void LA32PartialPair::initSynth(const PairType useMaster, const bool sawtoothWav
 	}
 }
 
-void LA32PartialPair::initPCM(const PairType useMaster, const Bit16s *pcmWaveAddress, const Bit32u pcmWaveLength, const bool pcmWaveLooped) {
+void LA32IntPartialPair::initPCM(const PairType useMaster, const Bit16s *pcmWaveAddress, const Bit32u pcmWaveLength, const bool pcmWaveLooped) {
 	if (useMaster == MASTER) {
 		master.initPCM(pcmWaveAddress, pcmWaveLength, pcmWaveLooped, true);
 	} else {
@@ -362,7 +461,7 @@ void LA32PartialPair::initPCM(const PairType useMaster, const Bit16s *pcmWaveAdd
 	}
 }
 
-void LA32PartialPair::generateNextSample(const PairType useMaster, const Bit32u amp, const Bit16u pitch, const Bit32u cutoff) {
+void LA32IntPartialPair::generateNextSample(const PairType useMaster, const Bit32u amp, const Bit16u pitch, const Bit32u cutoff) {
 	if (useMaster == MASTER) {
 		master.generateNextSample(amp, pitch, cutoff);
 	} else {
@@ -370,7 +469,7 @@ void LA32PartialPair::generateNextSample(const PairType useMaster, const Bit32u
 	}
 }
 
-Bit16s LA32PartialPair::unlogAndMixWGOutput(const LA32WaveGenerator &wg) {
+Bit16s LA32IntPartialPair::unlogAndMixWGOutput(const LA32WaveGenerator &wg) {
 	if (!wg.isActive()) {
 		return 0;
 	}
@@ -382,7 +481,7 @@ Bit16s LA32PartialPair::unlogAndMixWGOutput(const LA32WaveGenerator &wg) {
 	return firstSample + secondSample;
 }
 
-Bit16s LA32PartialPair::nextOutSample() {
+Bit16s LA32IntPartialPair::nextOutSample() {
 	if (!ringModulated) {
 		return unlogAndMixWGOutput(master) + unlogAndMixWGOutput(slave);
 	}
@@ -411,7 +510,20 @@ Bit16s LA32PartialPair::nextOutSample() {
 	return mixed ? nonOverdrivenMasterSample + ringModulatedSample : ringModulatedSample;
 }
 
-void LA32PartialPair::deactivate(const PairType useMaster) {
+unsigned long LA32IntPartialPair::generateNextBlock(Bit16s *outBuf, const Bit32u *ampVals, const Bit16u *pitchVals, const Bit32u *cutoffVals, const unsigned long length) {
+	if (master.isActive() && !master.isPCMWave()) {
+		master.generateNextSynthBlock(outBuf, ampVals, pitchVals, cutoffVals, length);
+		return length;
+	}
+	unsigned long generatedLength = 0;
+	while (generatedLength < length && master.isActive()) {
+		master.generateNextSample(ampVals[generatedLength], pitchVals[generatedLength], cutoffVals[generatedLength]);
+		outBuf[generatedLength++] = nextOutSample();
+	}
+	return generatedLength;
+}
+
+void LA32IntPartialPair::deactivate(const PairType useMaster) {
 	if (useMaster == MASTER) {
 		master.deactivate();
 	} else {
@@ -419,10 +531,8 @@ void LA32PartialPair::deactivate(const PairType useMaster) {
 	}
 }
 
-bool LA32PartialPair::isActive(const PairType useMaster) const {
+bool LA32IntPartialPair::isActive(const PairType useMaster) const {
 	return useMaster == MASTER ? master.isActive() : slave.isActive();
 }
 
 }
-
-#endif // #if MT32EMU_USE_FLOAT_SAMPLES
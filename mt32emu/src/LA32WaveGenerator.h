@@ -15,10 +15,6 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#if MT32EMU_USE_FLOAT_SAMPLES
-#include "LA32FloatWaveGenerator.h"
-#else
-
 #ifndef MT32EMU_LA32_WAVE_GENERATOR_H
 #define MT32EMU_LA32_WAVE_GENERATOR_H
 
@@ -133,7 +129,7 @@ class LA32WaveGenerator {
 	Bit32u pcmInterpolationFactor;
 
 	// Current phase of the square wave
-	enum {
+	enum SquareWavePhase {
 		POSITIVE_RISING_SINE_SEGMENT,
 		POSITIVE_LINEAR_SEGMENT,
 		POSITIVE_FALLING_SINE_SEGMENT,
@@ -143,7 +139,7 @@ class LA32WaveGenerator {
 	} phase;
 
 	// Current phase of the resonance wave
-	enum {
+	enum ResonanceWavePhase {
 		POSITIVE_RISING_RESONANCE_SINE_SEGMENT,
 		POSITIVE_FALLING_RESONANCE_SINE_SEGMENT,
 		NEGATIVE_FALLING_RESONANCE_SINE_SEGMENT,
@@ -162,16 +158,21 @@ class LA32WaveGenerator {
 	// Internal methods below
 	//***************************************************************************
 
-	Bit32u getSampleStep();
-	Bit32u getResonanceWaveLengthFactor(Bit32u effectiveCutoffValue);
-	Bit32u getHighLinearLength(Bit32u effectiveCutoffValue);
+	// The computations below only depend on the passed values, so that the per-sample and the block generation share them.
+	// The tables are passed in to avoid repeated access to the Tables instance in the inner loops.
+	static Bit32u getSampleStep(const Bit16u *exp9, const Bit16u pitch);
+	static Bit32u getResonanceWaveLengthFactor(const Bit16u *exp9, const Bit32u effectiveCutoffValue);
+	static Bit32u getHighLinearLength(const Bit16u *exp9, const Bit8u pulseWidth, const Bit32u effectiveCutoffValue);
+	static SquareWavePhase computePositions(const Bit32u wavePosition, const Bit32u highLinearLength, const Bit32u lowLinearLength, const Bit32u resonanceWaveLengthFactor, Bit32u &squareWavePosition, Bit32u &resonanceSinePosition);
+	static ResonanceWavePhase getResonancePhase(const SquareWavePhase phase, const Bit32u resonanceSinePosition);
+	static Bit32u getSquareWaveLogValue(const Bit16u *logsin9, const SquareWavePhase phase, const Bit32u squareWavePosition, const Bit32u amp, const Bit32u cutoffVal);
+	Bit32u getResonanceWaveLogValue(const Bit16u *logsin9, const SquareWavePhase usePhase, const ResonanceWavePhase useResonancePhase, const Bit32u useSquareWavePosition, const Bit32u useResonanceSinePosition, const Bit32u useAmp, const Bit32u useCutoffVal) const;
+	static void getSawtoothCosineLogSample(const Bit16u *logsin9, const Bit32u wavePosition, LogSample &logSample);
 
-	void computePositions(Bit32u highLinearLength, Bit32u lowLinearLength, Bit32u resonanceWaveLengthFactor);
 	void advancePosition();
 
 	void generateNextSquareWaveLogSample();
 	void generateNextResonanceWaveLogSample();
-	void generateNextSawtoothCosineLogSample(LogSample &logSample) const;
 
 	void pcmSampleToLogSample(LogSample &logSample, const Bit16s pcmSample) const;
 	void generateNextPCMWaveLogSamples();
@@ -186,6 +187,12 @@ public:
 	// Update parameters with respect to TVP, TVA and TVF, and generate next sample
 	void generateNextSample(const Bit32u amp, const Bit16u pitch, const Bit32u cutoff);
 
+	// Generate a block of synth partial samples in the linear space, the same as generateNextSample() followed by unlogging
+	// and mixing of both WG outputs would do for each sample. Rather than advancing the whole WG state sample by sample,
+	// each stage of the computation is run through the block, with the intermediate values kept in arrays.
+	// Only valid for active synth partials, which never get deactivated by the WG itself.
+	void generateNextSynthBlock(Bit16s *outBuf, const Bit32u *ampVals, const Bit16u *pitchVals, const Bit32u *cutoffVals, const Bit32u length);
+
 	// WG output in the log-space consists of two components which are to be added (or ring modulated) in the linear-space afterwards
 	LogSample getOutputLogSample(const bool first) const;
 
@@ -203,7 +210,35 @@ public:
 };
 
 // LA32PartialPair contains a structure of two partials being mixed / ring modulated
+// This is the common interface of the integer and float implementations. The methods that are called per sample
+// (generateNextSample(), nextOutSample() and isActive()) are only declared in the implementations,
+// so that the renderer can invoke them directly once it knows the type of the pair.
 class LA32PartialPair {
+public:
+	enum PairType {
+		MASTER,
+		SLAVE
+	};
+
+	virtual ~LA32PartialPair() {}
+
+	// ringModulated should be set to false for the structures with mixing or stereo output
+	// ringModulated should be set to true for the structures with ring modulation
+	// mixed is used for the structures with ring modulation and indicates whether the master partial output is mixed to the ring modulator output
+	virtual void init(const bool ringModulated, const bool mixed) = 0;
+
+	// Initialise the WG engine for generation of synth partial samples and set up the invariant parameters
+	virtual void initSynth(const PairType master, const bool sawtoothWaveform, const Bit8u pulseWidth, const Bit8u resonance) = 0;
+
+	// Initialise the WG engine for generation of PCM partial samples and set up the invariant parameters
+	virtual void initPCM(const PairType master, const Bit16s * const pcmWaveAddress, const Bit32u pcmWaveLength, const bool pcmWaveLooped) = 0;
+
+	// Deactivate the WG engine
+	virtual void deactivate(const PairType master) = 0;
+};
+
+// LA32IntPartialPair implements the partial pair with the accurate 16-bit integer wave generator model
+class LA32IntPartialPair : public LA32PartialPair {
 	LA32WaveGenerator master;
 	LA32WaveGenerator slave;
 	bool ringModulated;
@@ -212,11 +247,6 @@ class LA32PartialPair {
 	static Bit16s unlogAndMixWGOutput(const LA32WaveGenerator &wg);
 
 public:
-	enum PairType {
-		MASTER,
-		SLAVE
-	};
-
 	// ringModulated should be set to false for the structures with mixing or stereo output
 	// ringModulated should be set to true for the structures with ring modulation
 	// mixed is used for the structures with ring modulation and indicates whether the master partial output is mixed to the ring modulator output
@@ -234,6 +264,11 @@ public:
 	// Perform mixing / ring modulation and return the result
 	Bit16s nextOutSample();
 
+	// Generate up to length samples of the master partial and store the output to outBuf. Must not be used with ring modulation.
+	// The same as invoking generateNextSample() and nextOutSample() for each sample while the master partial remains active.
+	// Returns the number of samples generated, the last one of which may follow deactivation of the master partial.
+	unsigned long generateNextBlock(Bit16s *outBuf, const Bit32u *ampVals, const Bit16u *pitchVals, const Bit32u *cutoffVals, const unsigned long length);
+
 	// Deactivate the WG engine
 	void deactivate(const PairType master);
 
@@ -244,5 +279,3 @@ public:
 } // namespace MT32Emu
 
 #endif // #ifndef MT32EMU_LA32_WAVE_GENERATOR_H
-
-#endif // #if MT32EMU_USE_FLOAT_SAMPLES
@@ -69,10 +69,8 @@ Part::Part(Synth *useSynth, unsigned int usePartNum) {
 	memset(patchCache, 0, sizeof(patchCache));
 }
 
+// The polys are owned by PartialManager, which destroys them all including the active ones.
 Part::~Part() {
-	while (!activePolys.isEmpty()) {
-		delete activePolys.takeFirst();
-	}
 }
 
 void Part::setDataEntryMSB(unsigned char midiDataEntryMSB) {
@@ -471,7 +469,7 @@ void Part::playPoly(const PatchCache cache[4], const MemParams::RhythmTemp *rhyt
 		if (synth->isAbortingPoly()) return;
 	}
 
-	if (!synth->partialManager->freePartials(needPartials, partNum)) {
+	if (!synth->partialManager->freePartials(needPartials, partNum, key)) {
 #if MT32EMU_MONITOR_PARTIALS > 0
 		synth->printDebug("%s (%s): Insufficient free partials to play key %d (velocity %d); needed=%d, free=%d, assignMode=%d", name, currentInstr, midiKey, velocity, needPartials, synth->partialManager->getFreePartialCount(), patchTemp->patch.assignMode);
 		synth->printPartialUsage();
@@ -18,9 +18,11 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <new>
 
 #include "mt32emu.h"
 #include "mmath.h"
+#include "PartialManager.h"
 
 namespace MT32Emu {
 
@@ -29,22 +31,92 @@ static const Bit8u PAN_NUMERATOR_SLAVE[]  = {0, 1, 2, 3, 4, 5, 6, 7, 7, 7, 7, 7,
 
 static const Bit32s PAN_FACTORS[] = {0, 18, 37, 55, 73, 91, 110, 128, 146, 165, 183, 201, 219, 238, 256};
 
-Partial::Partial(Synth *useSynth, int useDebugPartialNum) :
-	synth(useSynth), debugPartialNum(useDebugPartialNum), sampleNum(0) {
+// Alignment of each component object placed in the memory block given to the constructor
+static const size_t COMPONENT_ALIGNMENT = 16;
+
+static inline size_t getAlignedComponentSize(size_t size) {
+	return (size + COMPONENT_ALIGNMENT - 1) & ~(COMPONENT_ALIGNMENT - 1);
+}
+
+// Maximum number of samples produceOutput() processes in each pass. Limits the size of the temporary buffers on stack.
+static const unsigned long MAX_BLOCK_LENGTH = 256;
+
+// The TVP may restart the amp ramp when recalculating sustain, so the order in which the control values are obtained matters.
+// They are evaluated as arguments of a single call to retain the same order as in a call to LA32PartialPair::generateNextSample().
+static inline void storeControlValues(Bit32u &ampVal, Bit16u &pitchVal, Bit32u &cutoffVal, const Bit32u newAmpVal, const Bit16u newPitchVal, const Bit32u newCutoffVal) {
+	ampVal = newAmpVal;
+	pitchVal = newPitchVal;
+	cutoffVal = newCutoffVal;
+}
+
+// Pans the block of samples produced by the LA32 pair and mixes it into the output buffers, advancing the buffer pointers.
+// FIXME: Sample analysis suggests that the use of panVal is linear, but there are some quirks that still need to be resolved.
+// FIXME: Dividing by 7 (or by 14 in a Mok-friendly way) looks of course pointless. Need clarification.
+// FIXME2: LA32 may produce distorted sound in case if the absolute value of maximal amplitude of the input exceeds 8191
+// when the panning value is non-zero. Most probably the distortion occurs in the same way it does with ring modulation,
+// and it seems to be caused by limited precision of the common multiplication circuit.
+// From analysis of this overflow, it is obvious that the right channel output is actually found
+// by subtraction of the left channel output from the input.
+// Though, it is unknown whether this overflow is exploited somewhere.
+static inline void panAndMixBlock(Bit16s *&leftBuf, Bit16s *&rightBuf, const Bit16s *sampleBuf, const unsigned long length, const Bit32s leftPanValue, const Bit32s rightPanValue) {
+	for (unsigned long i = 0; i < length; i++) {
+		Bit16s sample = sampleBuf[i];
+		Bit16s leftOut = Bit16s((sample * leftPanValue) >> 8);
+		Bit16s rightOut = Bit16s((sample * rightPanValue) >> 8);
+		*leftBuf = Synth::clipBit16s((Bit32s)*leftBuf + (Bit32s)leftOut);
+		*rightBuf = Synth::clipBit16s((Bit32s)*rightBuf + (Bit32s)rightOut);
+		leftBuf++;
+		rightBuf++;
+	}
+}
+
+static inline void panAndMixBlock(float *&leftBuf, float *&rightBuf, const float *sampleBuf, const unsigned long length, const Bit32s leftPanValue, const Bit32s rightPanValue) {
+	for (unsigned long i = 0; i < length; i++) {
+		float sample = sampleBuf[i];
+		float leftOut = (sample * (float)leftPanValue) / 14.0f;
+		float rightOut = (sample * (float)rightPanValue) / 14.0f;
+		*(leftBuf++) += leftOut;
+		*(rightBuf++) += rightOut;
+	}
+}
+
+size_t Partial::getComponentMemorySize(const Synth *useSynth) {
+	size_t la32PairSize = useSynth->rendererType == RendererType_FLOAT ? sizeof(LA32FloatPartialPair) : sizeof(LA32IntPartialPair);
+	return getAlignedComponentSize(sizeof(TVA)) + getAlignedComponentSize(sizeof(TVP))
+		+ getAlignedComponentSize(sizeof(TVF)) + getAlignedComponentSize(la32PairSize);
+}
+
+Partial::Partial(Synth *useSynth, int useDebugPartialNum, void *componentMemory) :
+	sampleNum(0), synth(useSynth), debugPartialNum(useDebugPartialNum) {
 	// Initialisation of tva, tvp and tvf uses 'this' pointer
 	// and thus should not be in the initializer list to avoid a compiler warning
-	tva = new TVA(this, &ampRamp);
-	tvp = new TVP(this);
-	tvf = new TVF(this, &cutoffModifierRamp);
+	// The components are placed right after each other, so that the whole voice is kept in adjacent cache lines.
+	Bit8u *nextComponent = static_cast<Bit8u *>(componentMemory);
+	tva = new(nextComponent) TVA(this, &ampRamp);
+	nextComponent += getAlignedComponentSize(sizeof(TVA));
+	tvp = new(nextComponent) TVP(this);
+	nextComponent += getAlignedComponentSize(sizeof(TVP));
+	tvf = new(nextComponent) TVF(this, &cutoffModifierRamp);
+	nextComponent += getAlignedComponentSize(sizeof(TVF));
 	ownerPart = -1;
 	poly = NULL;
 	pair = NULL;
+	deactivatedPartialList = NULL;
+	prerenderedOutput = NULL;
+	prerenderedLength = 0;
+	if (synth->rendererType == RendererType_FLOAT) {
+		la32Pair = new(nextComponent) LA32FloatPartialPair;
+	} else {
+		la32Pair = new(nextComponent) LA32IntPartialPair;
+	}
 }
 
 Partial::~Partial() {
-	delete tva;
-	delete tvp;
-	delete tvf;
+	// The components are destroyed in place, the memory they occupy is owned by the caller.
+	la32Pair->~LA32PartialPair();
+	tva->~TVA();
+	tvp->~TVP();
+	tvf->~TVF();
 }
 
 // Only used for debugging purposes
@@ -79,22 +151,49 @@ void Partial::deactivate() {
 		return;
 	}
 	ownerPart = -1;
-	if (poly != NULL) {
-		poly->partialDeactivated(this);
+	if (deactivatedPartialList != NULL) {
+		// Other partials may be rendered concurrently, so updating the poly and the partial manager is left to completeDeferredDeactivation()
+		deactivatedPartialList->partials[deactivatedPartialList->count++] = this;
+	} else {
+		synth->partialManager->partialDeactivated(debugPartialNum);
+		if (poly != NULL) {
+			poly->partialDeactivated(this);
+		}
 	}
 #if MT32EMU_MONITOR_PARTIALS > 2
 	synth->printDebug("[+%lu] [Partial %d] Deactivated", sampleNum, debugPartialNum);
 	synth->printPartialUsage(sampleNum);
 #endif
 	if (isRingModulatingSlave()) {
-		pair->la32Pair.deactivate(LA32PartialPair::SLAVE);
+		pair->la32Pair->deactivate(LA32PartialPair::SLAVE);
 	} else {
-		la32Pair.deactivate(LA32PartialPair::MASTER);
+		la32Pair->deactivate(LA32PartialPair::MASTER);
 		if (hasRingModulatingSlave()) {
 			pair->deactivate();
 			pair = NULL;
 		}
 	}
+	// Unless it is our ring modulating master, the pair partial may be being rendered concurrently.
+	// In this case, unlinking is also left to completeDeferredDeactivation().
+	if (pair != NULL && (deactivatedPartialList == NULL || isRingModulatingSlave())) {
+		pair->pair = NULL;
+	}
+}
+
+// Also applies to the ring modulating slave as it is deactivated while rendering the output of this partial.
+void Partial::setDeactivatedPartialList(DeactivatedPartialList *list) {
+	deactivatedPartialList = list;
+	if (hasRingModulatingSlave()) {
+		pair->deactivatedPartialList = list;
+	}
+}
+
+void Partial::completeDeferredDeactivation() {
+	deactivatedPartialList = NULL;
+	synth->partialManager->partialDeactivated(debugPartialNum);
+	if (poly != NULL) {
+		poly->partialDeactivated(this);
+	}
 	if (pair != NULL) {
 		pair->pair = NULL;
 	}
@@ -131,10 +230,10 @@ void Partial::startPartial(const Part *part, Poly *usePoly, const PatchCache *us
 	leftPanValue = synth->reversedStereoEnabled ? 14 - panSetting : panSetting;
 	rightPanValue = 14 - leftPanValue;
 
-#if !MT32EMU_USE_FLOAT_SAMPLES
-	leftPanValue = PAN_FACTORS[leftPanValue];
-	rightPanValue = PAN_FACTORS[rightPanValue];
-#endif
+	if (synth->rendererType == RendererType_BIT16S) {
+		leftPanValue = PAN_FACTORS[leftPanValue];
+		rightPanValue = PAN_FACTORS[rightPanValue];
+	}
 
 	// SEMI-CONFIRMED: From sample analysis:
 	// Found that timbres with 3 or 4 partials (i.e. one using two partial pairs) are mixed in two different ways.
@@ -186,11 +285,11 @@ void Partial::startPartial(const Part *part, Poly *usePoly, const PatchCache *us
 	LA32PartialPair *useLA32Pair;
 	if (isRingModulatingSlave()) {
 		pairType = LA32PartialPair::SLAVE;
-		useLA32Pair = &pair->la32Pair;
+		useLA32Pair = pair->la32Pair;
 	} else {
 		pairType = LA32PartialPair::MASTER;
-		la32Pair.init(hasRingModulatingSlave(), mixType == 1);
-		useLA32Pair = &la32Pair;
+		la32Pair->init(hasRingModulatingSlave(), mixType == 1);
+		useLA32Pair = la32Pair;
 	}
 	if (isPCM()) {
 		useLA32Pair->initPCM(pairType, &synth->pcmROMData[pcmWave->addr], pcmWave->len, pcmWave->loop);
@@ -198,7 +297,7 @@ void Partial::startPartial(const Part *part, Poly *usePoly, const PatchCache *us
 		useLA32Pair->initSynth(pairType, (patchCache->waveform & 1) != 0, pulseWidthVal, patchCache->srcPartial.tvf.resonance + 1);
 	}
 	if (!hasRingModulatingSlave()) {
-		la32Pair.deactivate(LA32PartialPair::SLAVE);
+		la32Pair->deactivate(LA32PartialPair::SLAVE);
 	}
 }
 
@@ -265,7 +364,51 @@ void Partial::backupCache(const PatchCache &cache) {
 	}
 }
 
-bool Partial::produceOutput(Sample *leftBuf, Sample *rightBuf, unsigned long length) {
+unsigned long Partial::generateControlBlock(Bit32u *ampVals, Bit16u *pitchVals, Bit32u *cutoffVals, unsigned long offset, unsigned long length) {
+	for (unsigned long i = 0; i < length;) {
+		sampleNum = offset + i;
+		storeControlValues(ampVals[i], pitchVals[i], cutoffVals[i], getAmpValue(), tvp->nextPitch(), getCutoffValue());
+		i++;
+		if (!tva->isPlaying()) {
+			return i;
+		}
+	}
+	return length;
+}
+
+bool Partial::produceOutput(Bit16s *leftBuf, Bit16s *rightBuf, unsigned long length) {
+	return doProduceOutput(leftBuf, rightBuf, length, static_cast<LA32IntPartialPair *>(la32Pair));
+}
+
+bool Partial::produceOutput(float *leftBuf, float *rightBuf, unsigned long length) {
+	return doProduceOutput(leftBuf, rightBuf, length, static_cast<LA32FloatPartialPair *>(la32Pair));
+}
+
+unsigned long Partial::prerenderOutput(Bit16s *buffer, unsigned long length) {
+	return doPrerenderOutput(buffer, length, static_cast<LA32IntPartialPair *>(la32Pair));
+}
+
+unsigned long Partial::prerenderOutput(float *buffer, unsigned long length) {
+	return doPrerenderOutput(buffer, length, static_cast<LA32FloatPartialPair *>(la32Pair));
+}
+
+bool Partial::hasPrerenderedOutput() const {
+	return prerenderedOutput != NULL;
+}
+
+void Partial::discardPrerenderedOutput() {
+	prerenderedOutput = NULL;
+}
+
+template <class Sample, class LA32PairImpl>
+bool Partial::doProduceOutput(Sample *leftBuf, Sample *rightBuf, unsigned long length, LA32PairImpl *la32PairImpl) {
+	if (prerenderedOutput != NULL) {
+		// The partial may have been deactivated meanwhile, yet the output rendered before that is still to be mixed
+		unsigned long mixLength = prerenderedLength < length ? prerenderedLength : length;
+		panAndMixBlock(leftBuf, rightBuf, static_cast<const Sample *>(prerenderedOutput), mixLength, leftPanValue, rightPanValue);
+		prerenderedOutput = NULL;
+		return true;
+	}
 	if (!isActive() || alreadyOutputed || isRingModulatingSlave()) {
 		return false;
 	}
@@ -274,56 +417,99 @@ bool Partial::produceOutput(Sample *leftBuf, Sample *rightBuf, unsigned long len
 		return false;
 	}
 	alreadyOutputed = true;
+	renderOutput(leftBuf, rightBuf, (Sample *)NULL, length, la32PairImpl);
+	return true;
+}
+
+template <class Sample, class LA32PairImpl>
+unsigned long Partial::doPrerenderOutput(Sample *buffer, unsigned long length, LA32PairImpl *la32PairImpl) {
+	if (!isActive() || alreadyOutputed || isRingModulatingSlave() || poly == NULL) {
+		return 0;
+	}
+	alreadyOutputed = true;
+	prerenderedLength = renderOutput((Sample *)NULL, (Sample *)NULL, buffer, length, la32PairImpl);
+	prerenderedOutput = buffer;
+	return prerenderedLength;
+}
 
-	for (sampleNum = 0; sampleNum < length; sampleNum++) {
-		if (!tva->isPlaying() || !la32Pair.isActive(LA32PartialPair::MASTER)) {
+template <class Sample, class LA32PairImpl>
+unsigned long Partial::renderOutput(Sample *leftBuf, Sample *rightBuf, Sample *monoBuf, unsigned long length, LA32PairImpl *la32PairImpl) {
+	Bit32u ampVals[MAX_BLOCK_LENGTH];
+	Bit16u pitchVals[MAX_BLOCK_LENGTH];
+	Bit32u cutoffVals[MAX_BLOCK_LENGTH];
+	Bit32u slaveAmpVals[MAX_BLOCK_LENGTH];
+	Bit16u slavePitchVals[MAX_BLOCK_LENGTH];
+	Bit32u slaveCutoffVals[MAX_BLOCK_LENGTH];
+	Sample sampleBuf[MAX_BLOCK_LENGTH];
+
+	unsigned long renderedLength = 0;
+	while (renderedLength < length) {
+		if (!tva->isPlaying() || !la32PairImpl->isActive(LA32PartialPair::MASTER)) {
+			sampleNum = renderedLength;
 			deactivate();
 			break;
 		}
-		la32Pair.generateNextSample(LA32PartialPair::MASTER, getAmpValue(), tvp->nextPitch(), getCutoffValue());
+		unsigned long blockLength = length - renderedLength;
+		if (blockLength > MAX_BLOCK_LENGTH) {
+			blockLength = MAX_BLOCK_LENGTH;
+		}
+
+		// First, advance the envelopes for the whole block. The block is cut short after the sample at which the TVA stops playing.
+		blockLength = generateControlBlock(ampVals, pitchVals, cutoffVals, renderedLength, blockLength);
+		unsigned long slaveLength = 0;
+		bool slaveEnded = false;
 		if (hasRingModulatingSlave()) {
-			la32Pair.generateNextSample(LA32PartialPair::SLAVE, pair->getAmpValue(), pair->tvp->nextPitch(), pair->getCutoffValue());
-			if (!pair->tva->isPlaying() || !la32Pair.isActive(LA32PartialPair::SLAVE)) {
-				pair->deactivate();
-				if (mixType == 2) {
-					deactivate();
-					break;
+			slaveLength = pair->generateControlBlock(slaveAmpVals, slavePitchVals, slaveCutoffVals, renderedLength, blockLength);
+			slaveEnded = !pair->tva->isPlaying();
+		}
+
+		// Next, run the wave generators through the block.
+		Sample *outBuf = monoBuf != NULL ? monoBuf + renderedLength : sampleBuf;
+		unsigned long outLength = 0;
+		bool deactivated = false;
+		if (!hasRingModulatingSlave()) {
+			// Without ring modulation, the pair can generate the whole block at once, stopping when the master partial ends
+			outLength = la32PairImpl->generateNextBlock(outBuf, ampVals, pitchVals, cutoffVals, blockLength);
+		}
+		for (; outLength < blockLength; outLength++) {
+			sampleNum = renderedLength + outLength;
+			if (!la32PairImpl->isActive(LA32PartialPair::MASTER)) {
+				// Deactivation happens on the next pass
+				break;
+			}
+			la32PairImpl->generateNextSample(LA32PartialPair::MASTER, ampVals[outLength], pitchVals[outLength], cutoffVals[outLength]);
+			if (hasRingModulatingSlave()) {
+				la32PairImpl->generateNextSample(LA32PartialPair::SLAVE, slaveAmpVals[outLength], slavePitchVals[outLength], slaveCutoffVals[outLength]);
+				if ((slaveEnded && outLength + 1 == slaveLength) || !la32PairImpl->isActive(LA32PartialPair::SLAVE)) {
+					pair->deactivate();
+					if (mixType == 2) {
+						deactivate();
+						deactivated = true;
+						break;
+					}
 				}
 			}
-		}
 
-		// Although, LA32 applies panning itself, we assume here it is applied in the mixer, not within a pair.
-		// Applying the pan value in the log-space looks like a waste of unlog resources. Though, it needs clarification.
-		Sample sample = la32Pair.nextOutSample();
+			// Although, LA32 applies panning itself, we assume here it is applied in the mixer, not within a pair.
+			// Applying the pan value in the log-space looks like a waste of unlog resources. Though, it needs clarification.
+			outBuf[outLength] = la32PairImpl->nextOutSample();
+		}
 
-		// FIXME: Sample analysis suggests that the use of panVal is linear, but there are some quirks that still need to be resolved.
-#if MT32EMU_USE_FLOAT_SAMPLES
-		Sample leftOut = (sample * (float)leftPanValue) / 14.0f;
-		Sample rightOut = (sample * (float)rightPanValue) / 14.0f;
-		*(leftBuf++) += leftOut;
-		*(rightBuf++) += rightOut;
-#else
-		// FIXME: Dividing by 7 (or by 14 in a Mok-friendly way) looks of course pointless. Need clarification.
-		// FIXME2: LA32 may produce distorted sound in case if the absolute value of maximal amplitude of the input exceeds 8191
-		// when the panning value is non-zero. Most probably the distortion occurs in the same way it does with ring modulation,
-		// and it seems to be caused by limited precision of the common multiplication circuit.
-		// From analysis of this overflow, it is obvious that the right channel output is actually found
-		// by subtraction of the left channel output from the input.
-		// Though, it is unknown whether this overflow is exploited somewhere.
-		Sample leftOut = Sample((sample * leftPanValue) >> 8);
-		Sample rightOut = Sample((sample * rightPanValue) >> 8);
-		*leftBuf = Synth::clipBit16s((Bit32s)*leftBuf + (Bit32s)leftOut);
-		*rightBuf = Synth::clipBit16s((Bit32s)*rightBuf + (Bit32s)rightOut);
-		leftBuf++;
-		rightBuf++;
-#endif
+		// Finally, pan and mix the block into the output buffers.
+		if (monoBuf == NULL) {
+			panAndMixBlock(leftBuf, rightBuf, sampleBuf, outLength, leftPanValue, rightPanValue);
+		}
+		renderedLength += outLength;
+		if (deactivated) {
+			break;
+		}
 	}
 	sampleNum = 0;
-	return true;
+	return renderedLength;
 }
 
 bool Partial::shouldReverb() {
-	if (!isActive()) {
+	if (!isActive() && prerenderedOutput == NULL) {
 		return false;
 	}
 	return patchCache->reverb;
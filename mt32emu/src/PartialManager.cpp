@@ -16,35 +16,85 @@
  */
 
 #include <cstring>
+#include <new>
 
 #include "mt32emu.h"
 #include "PartialManager.h"
 
 namespace MT32Emu {
 
+// All the voice objects are allocated from a single arena. Each slot in it starts on a cache line boundary,
+// so that the objects of different voices never share a cache line.
+static const size_t CACHE_LINE_SIZE = 64;
+
+static inline size_t getCacheLineAlignedSize(size_t size) {
+	return (size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+}
+
+// Returns the index of the lowest set bit, the argument must not be zero.
+static inline unsigned int findLowestSetBit(Bit32u bits) {
+	static const unsigned int DE_BRUIJN_BIT_POSITIONS[32] = {
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+	return DE_BRUIJN_BIT_POSITIONS[((bits & (0 - bits)) * 0x077CB531U) >> 27];
+}
+
 PartialManager::PartialManager(Synth *useSynth, Part **useParts) {
 	synth = useSynth;
 	parts = useParts;
 	partialTable = new Partial *[synth->getPartialCount()];
 	freePolys = new Poly *[synth->getPartialCount()];
 	firstFreePolyIndex = 0;
+	activePartialMaskLength = (synth->getPartialCount() + 31) >> 5;
+	activePartialMask = new Bit32u[activePartialMaskLength];
+	memset(activePartialMask, 0, activePartialMaskLength * sizeof(Bit32u));
+	activePartialCount = 0;
+	prerenderedPartialCount = 0;
+	if (synth->rendererType == RendererType_FLOAT) {
+		prerenderBuffers = new float[4 * MAX_SAMPLES_PER_RUN];
+	} else {
+		prerenderBuffers = new Bit16s[4 * MAX_SAMPLES_PER_RUN];
+	}
+	deactivatedPrerenderedPartialList.partials = deactivatedPrerenderedPartials;
+	deactivatedPrerenderedPartialList.count = 0;
+	requestingPartNum = 0;
+	requestedKey = 0;
+	neededPartialCount = 0;
+	// Each partial slot holds the partial followed by its components, the polys are kept in separate slots past all the partials.
+	size_t componentOffset = getCacheLineAlignedSize(sizeof(Partial));
+	size_t partialSlotSize = getCacheLineAlignedSize(componentOffset + Partial::getComponentMemorySize(synth));
+	polySlotSize = getCacheLineAlignedSize(sizeof(Poly));
+	voiceArenaStorage = new Bit8u[synth->getPartialCount() * (partialSlotSize + polySlotSize) + CACHE_LINE_SIZE - 1];
+	Bit8u *voiceArena = voiceArenaStorage + ((CACHE_LINE_SIZE - reinterpret_cast<size_t>(voiceArenaStorage) % CACHE_LINE_SIZE) % CACHE_LINE_SIZE);
+	polyArena = voiceArena + synth->getPartialCount() * partialSlotSize;
 	for (unsigned int i = 0; i < synth->getPartialCount(); i++) {
-		partialTable[i] = new Partial(synth, i);
-		freePolys[i] = new Poly();
+		Bit8u *partialSlot = voiceArena + i * partialSlotSize;
+		partialTable[i] = new(partialSlot) Partial(synth, i, partialSlot + componentOffset);
+		freePolys[i] = new(polyArena + i * polySlotSize) Poly();
 	}
 }
 
 PartialManager::~PartialManager(void) {
+	// The polys are destroyed here regardless of whether they are currently owned by a part.
 	for (unsigned int i = 0; i < synth->getPartialCount(); i++) {
-		delete partialTable[i];
-		if (freePolys[i] != NULL) delete freePolys[i];
+		partialTable[i]->~Partial();
+		reinterpret_cast<Poly *>(polyArena + i * polySlotSize)->~Poly();
 	}
+	delete[] voiceArenaStorage;
 	delete[] partialTable;
 	delete[] freePolys;
+	delete[] activePartialMask;
+	if (synth->rendererType == RendererType_FLOAT) {
+		delete[] static_cast<float *>(prerenderBuffers);
+	} else {
+		delete[] static_cast<Bit16s *>(prerenderBuffers);
+	}
 }
 
+// Inactive partials are skipped since their flags are reset by Partial::startPartial() anyway.
 void PartialManager::clearAlreadyOutputed() {
-	for (unsigned int i = 0; i < synth->getPartialCount(); i++) {
+	for (unsigned int i = findNextActivePartial(0); i < synth->getPartialCount(); i = findNextActivePartial(i + 1)) {
 		partialTable[i]->alreadyOutputed = false;
 	}
 }
@@ -53,12 +103,16 @@ bool PartialManager::shouldReverb(int i) {
 	return partialTable[i]->shouldReverb();
 }
 
-bool PartialManager::produceOutput(int i, Sample *leftBuf, Sample *rightBuf, Bit32u bufferLength) {
+bool PartialManager::produceOutput(int i, Bit16s *leftBuf, Bit16s *rightBuf, Bit32u bufferLength) {
+	return partialTable[i]->produceOutput(leftBuf, rightBuf, bufferLength);
+}
+
+bool PartialManager::produceOutput(int i, float *leftBuf, float *rightBuf, Bit32u bufferLength) {
 	return partialTable[i]->produceOutput(leftBuf, rightBuf, bufferLength);
 }
 
 void PartialManager::deactivateAll() {
-	for (unsigned int i = 0; i < synth->getPartialCount(); i++) {
+	for (unsigned int i = findNextActivePartial(0); i < synth->getPartialCount(); i = findNextActivePartial(i + 1)) {
 		partialTable[i]->deactivate();
 	}
 }
@@ -73,35 +127,61 @@ unsigned int PartialManager::setReserve(Bit8u *rset) {
 }
 
 Partial *PartialManager::allocPartial(int partNum) {
-	Partial *outPartial = NULL;
-
 	// Get the first inactive partial
-	for (unsigned int partialNum = 0; partialNum < synth->getPartialCount(); partialNum++) {
-		if (!partialTable[partialNum]->isActive()) {
-			outPartial = partialTable[partialNum];
+	for (unsigned int wordNum = 0; wordNum < activePartialMaskLength; wordNum++) {
+		Bit32u freeBits = ~activePartialMask[wordNum];
+		if (freeBits == 0) {
+			continue;
+		}
+		unsigned int partialNum = (wordNum << 5) + findLowestSetBit(freeBits);
+		if (partialNum >= synth->getPartialCount()) {
 			break;
 		}
-	}
-	if (outPartial != NULL) {
+		activePartialMask[wordNum] |= freeBits & (0 - freeBits);
+		activePartialCount++;
+		Partial *outPartial = partialTable[partialNum];
 		outPartial->activate(partNum);
+		return outPartial;
 	}
-	return outPartial;
+	return NULL;
 }
 
-unsigned int PartialManager::getFreePartialCount(void) {
-	int count = 0;
-	for (unsigned int i = 0; i < synth->getPartialCount(); i++) {
-		if (!partialTable[i]->isActive()) {
-			count++;
+unsigned int PartialManager::getFreePartialCount(void) const {
+	return synth->getPartialCount() - activePartialCount;
+}
+
+unsigned int PartialManager::getActivePartialCount() const {
+	return activePartialCount;
+}
+
+unsigned int PartialManager::findNextActivePartial(unsigned int partialNum) const {
+	if (partialNum >= synth->getPartialCount()) {
+		return synth->getPartialCount();
+	}
+	unsigned int wordNum = partialNum >> 5;
+	Bit32u activeBits = activePartialMask[wordNum] & (0xFFFFFFFFU << (partialNum & 31));
+	while (activeBits == 0) {
+		if (++wordNum == activePartialMaskLength) {
+			return synth->getPartialCount();
 		}
+		activeBits = activePartialMask[wordNum];
+	}
+	return (wordNum << 5) + findLowestSetBit(activeBits);
+}
+
+void PartialManager::partialDeactivated(unsigned int partialNum) {
+	Bit32u bit = 1U << (partialNum & 31);
+	Bit32u &word = activePartialMask[partialNum >> 5];
+	if ((word & bit) != 0) {
+		word &= ~bit;
+		activePartialCount--;
 	}
-	return count;
 }
 
 // This function is solely used to gather data for debug output at the moment.
 void PartialManager::getPerPartPartialUsage(unsigned int perPartPartialUsage[9]) {
 	memset(perPartPartialUsage, 0, 9 * sizeof(unsigned int));
-	for (unsigned int i = 0; i < synth->getPartialCount(); i++) {
+	for (unsigned int i = findNextActivePartial(0); i < synth->getPartialCount(); i = findNextActivePartial(i + 1)) {
 		if (partialTable[i]->isActive()) {
 			perPartPartialUsage[partialTable[i]->getOwnerPart()]++;
 		}
@@ -123,6 +203,7 @@ bool PartialManager::abortFirstReleasingPolyWhereReserveExceeded(int minPart) {
 			// This part has exceeded its reserved partial count.
 			// If it has any releasing polys, kill its first one and we're done.
 			if (parts[usePartNum]->abortFirstPoly(POLY_Releasing)) {
+				reportAbortedPoly(usePartNum);
 				return true;
 			}
 		}
@@ -145,6 +226,7 @@ bool PartialManager::abortFirstPolyPreferHeldWhereReserveExceeded(int minPart) {
 			// This part has exceeded its reserved partial count.
 			// If it has any polys, kill its first (preferably held) one and we're done.
 			if (parts[usePartNum]->abortFirstPolyPreferHeld()) {
+				reportAbortedPoly(usePartNum);
 				return true;
 			}
 		}
@@ -152,7 +234,44 @@ bool PartialManager::abortFirstPolyPreferHeldWhereReserveExceeded(int minPart) {
 	return false;
 }
 
-bool PartialManager::freePartials(unsigned int needed, int partNum) {
+void PartialManager::reportAllocationEvent(PartialAllocationEventType type, int partNum, unsigned int key, PolyState polyState) {
+	PartialAllocationEvent event;
+	event.timestamp = synth->getRenderedSampleCount();
+	event.type = Bit8u(type);
+	event.partNum = Bit8u(partNum);
+	event.requestingPartNum = Bit8u(requestingPartNum);
+	event.key = Bit8u(key);
+	event.polyState = Bit8u(polyState);
+	event.neededPartialCount = Bit8u(neededPartialCount);
+	event.reservedPartialCount = numReservedPartialsForPart[partNum];
+	event.activePartialCount = Bit16u(parts[partNum]->getActivePartialCount());
+	event.freePartialCount = Bit16u(getFreePartialCount());
+	synth->partialAllocationEventOccurred(event);
+}
+
+// Reports the poly which has just started aborting in the part
+void PartialManager::reportAbortedPoly(int partNum) {
+	const Poly *poly = synth->abortingPoly;
+	if (poly == NULL) {
+		// The poly had no partials left
+		reportAllocationEvent(PartialAllocationEventType_POLY_ABORTED, partNum, 0, POLY_Inactive);
+	} else {
+		reportAllocationEvent(PartialAllocationEventType_POLY_ABORTED, partNum, poly->getKey(), poly->getState());
+	}
+}
+
+bool PartialManager::freePartials(unsigned int needed, int partNum, unsigned int key) {
+	requestingPartNum = partNum;
+	requestedKey = key;
+	neededPartialCount = needed;
+	if (abortPolysToFreePartials(needed, partNum)) {
+		return true;
+	}
+	reportAllocationEvent(PartialAllocationEventType_ALLOCATION_FAILED, partNum, key, POLY_Inactive);
+	return false;
+}
+
+bool PartialManager::abortPolysToFreePartials(unsigned int needed, int partNum) {
 	// CONFIRMED: Barring bugs, this matches the real LAPC-I according to information from Mok.
 
 	// BUG: There's a bug in the LAPC-I implementation:
@@ -180,6 +299,7 @@ bool PartialManager::freePartials(unsigned int needed, int partNum) {
 #ifdef MT32EMU_QUIRK_FREE_PARTIALS_MT32
 	// On MT-32, we bail out before even killing releasing partials if the allocating part has exceeded its reserve and is configured for priority-to-earlier-polys.
 	if (parts[partNum]->getActiveNonReleasingPartialCount() + needed > numReservedPartialsForPart[partNum] && (synth->getPart(partNum)->getPatchTemp()->patch.assignMode & 1)) {
+		reportAllocationEvent(PartialAllocationEventType_RESERVE_EXCEEDED, partNum, requestedKey, POLY_Inactive);
 		return false;
 	}
 #endif
@@ -203,6 +323,7 @@ bool PartialManager::freePartials(unsigned int needed, int partNum) {
 
 	if (parts[partNum]->getActiveNonReleasingPartialCount() + needed > numReservedPartialsForPart[partNum]) {
 		// With the new partials we're freeing for, we would end up using more partials than we have reserved.
+		reportAllocationEvent(PartialAllocationEventType_RESERVE_EXCEEDED, partNum, requestedKey, POLY_Inactive);
 		if (synth->getPart(partNum)->getPatchTemp()->patch.assignMode & 1) {
 			// Priority is given to earlier polys, so just give up
 			return false;
@@ -240,6 +361,7 @@ bool PartialManager::freePartials(unsigned int needed, int partNum) {
 		if (!parts[partNum]->abortFirstPolyPreferHeld()) {
 			break;
 		}
+		reportAbortedPoly(partNum);
 		if (synth->isAbortingPoly() || getFreePartialCount() >= needed) {
 			return true;
 		}
@@ -249,6 +371,13 @@ bool PartialManager::freePartials(unsigned int needed, int partNum) {
 	return false;
 }
 
+Partial *PartialManager::getPartial(unsigned int partialNum) {
+	if (partialNum > synth->getPartialCount() - 1) {
+		return NULL;
+	}
+	return partialTable[partialNum];
+}
+
 const Partial *PartialManager::getPartial(unsigned int partialNum) const {
 	if (partialNum > synth->getPartialCount() - 1) {
 		return NULL;
@@ -256,6 +385,60 @@ const Partial *PartialManager::getPartial(unsigned int partialNum) const {
 	return partialTable[partialNum];
 }
 
+Bit32u PartialManager::prerenderAbortingPoly(const Poly *abortingPoly, Bit32u length) {
+	if (synth->rendererType == RendererType_FLOAT) {
+		return doPrerenderAbortingPoly(abortingPoly, static_cast<float *>(prerenderBuffers), length);
+	}
+	return doPrerenderAbortingPoly(abortingPoly, static_cast<Bit16s *>(prerenderBuffers), length);
+}
+
+// Previously, the synth was rendered sample by sample while a poly was aborting, in order to resume processing
+// of the pending MIDI events right after the run in which the poly became inactive. Now the same timing is attained
+// by rendering the partials of the aborting poly first. Their output is mixed in order when rendering the run.
+template <class Sample>
+Bit32u PartialManager::doPrerenderAbortingPoly(const Poly *abortingPoly, Sample *buffers, Bit32u length) {
+	prerenderedPartialCount = 0;
+	deactivatedPrerenderedPartialList.count = 0;
+	bool polyDeactivated = true;
+	Bit32u runLength = 0;
+	for (unsigned int i = findNextActivePartial(0); i < synth->getPartialCount(); i = findNextActivePartial(i + 1)) {
+		Partial *partial = partialTable[i];
+		// Ring modulating slaves are rendered along with their masters
+		if (partial->getPoly() != abortingPoly || partial->isRingModulatingSlave() || prerenderedPartialCount == 4) {
+			continue;
+		}
+		partial->setDeactivatedPartialList(&deactivatedPrerenderedPartialList);
+		Sample *buffer = buffers + prerenderedPartialCount * MAX_SAMPLES_PER_RUN;
+		prerenderedPartials[prerenderedPartialCount++] = partial;
+		Bit32u renderedLength = partial->prerenderOutput(buffer, length);
+		if (renderedLength < length) {
+			// The partial is deactivated during the sample that follows the rendered ones
+			if (runLength < renderedLength + 1) {
+				runLength = renderedLength + 1;
+			}
+		} else {
+			polyDeactivated = false;
+		}
+	}
+	if (!polyDeactivated) {
+		return length;
+	}
+	// Shouldn't happen, though it's safe to proceed as before
+	return runLength > 0 ? runLength : 1;
+}
+
+void PartialManager::completeAbortingPolyPrerender() {
+	for (unsigned int i = 0; i < prerenderedPartialCount; i++) {
+		prerenderedPartials[i]->discardPrerenderedOutput();
+		prerenderedPartials[i]->setDeactivatedPartialList(NULL);
+	}
+	prerenderedPartialCount = 0;
+	for (unsigned int i = 0; i < deactivatedPrerenderedPartialList.count; i++) {
+		deactivatedPrerenderedPartialList.partials[i]->completeDeferredDeactivation();
+	}
+	deactivatedPrerenderedPartialList.count = 0;
+}
+
 Poly *PartialManager::assignPolyToPart(Part *part) {
 	if (firstFreePolyIndex < synth->getPartialCount()) {
 		Poly *poly = freePolys[firstFreePolyIndex];
@@ -264,6 +447,7 @@ Poly *PartialManager::assignPolyToPart(Part *part) {
 		poly->setPart(part);
 		return poly;
 	}
+	reportAllocationEvent(PartialAllocationEventType_ALLOCATION_FAILED, requestingPartNum, requestedKey, POLY_Inactive);
 	return NULL;
 }
 
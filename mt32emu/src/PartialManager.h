@@ -28,25 +28,68 @@ private:
 	Part **parts;
 	Poly **freePolys;
 	Partial **partialTable;
+	// Owns the memory of all the partials, their components and the polys, which are constructed in place
+	Bit8u *voiceArenaStorage;
+	// Cache-line aligned start of the polys within the arena
+	Bit8u *polyArena;
+	size_t polySlotSize;
+	// One bit per partial, set while the partial is active. Kept in sync with Partial::isActive()
+	// by allocPartial() and partialDeactivated(), so that no scans over all partials are needed.
+	Bit32u *activePartialMask;
+	unsigned int activePartialMaskLength;
+	unsigned int activePartialCount;
 	Bit8u numReservedPartialsForPart[9];
 	Bit32u firstFreePolyIndex;
 
+	// Partials of the aborting poly, rendered ahead of the others by prerenderAbortingPoly()
+	Partial *prerenderedPartials[4];
+	unsigned int prerenderedPartialCount;
+	// Buffers of samples of the renderer type, one per prerendered partial
+	void *prerenderBuffers;
+	Partial *deactivatedPrerenderedPartials[4];
+	DeactivatedPartialList deactivatedPrerenderedPartialList;
+
+	// The new poly being allocated, which the reported voice stealing events refer to
+	int requestingPartNum;
+	unsigned int requestedKey;
+	unsigned int neededPartialCount;
+
+	template <class Sample>
+	Bit32u doPrerenderAbortingPoly(const Poly *abortingPoly, Sample *buffers, Bit32u length);
+
 	bool abortFirstReleasingPolyWhereReserveExceeded(int minPart);
 	bool abortFirstPolyPreferHeldWhereReserveExceeded(int minPart);
+	bool abortPolysToFreePartials(unsigned int needed, int partNum);
+	void reportAllocationEvent(PartialAllocationEventType type, int partNum, unsigned int key, PolyState polyState);
+	void reportAbortedPoly(int partNum);
 
 public:
 	PartialManager(Synth *synth, Part **parts);
 	~PartialManager();
 	Partial *allocPartial(int partNum);
-	unsigned int getFreePartialCount(void);
+	unsigned int getFreePartialCount(void) const;
+	unsigned int getActivePartialCount() const;
+	// Returns the number of the first active partial starting from partialNum, or the partial count if there is none.
+	// Iterating this way visits the active partials in the same order as a plain loop over all partials.
+	unsigned int findNextActivePartial(unsigned int partialNum) const;
+	// Invoked by the partial upon deactivation (or upon completing the deferred deactivation).
+	void partialDeactivated(unsigned int partialNum);
 	void getPerPartPartialUsage(unsigned int perPartPartialUsage[9]);
-	bool freePartials(unsigned int needed, int partNum);
+	// Aborts the polys according to the partial reserve, if necessary to play a new poly. The key is only used for reporting.
+	bool freePartials(unsigned int needed, int partNum, unsigned int key);
 	unsigned int setReserve(Bit8u *rset);
 	void deactivateAll();
-	bool produceOutput(int i, Sample *leftBuf, Sample *rightBuf, Bit32u bufferLength);
+	bool produceOutput(int i, Bit16s *leftBuf, Bit16s *rightBuf, Bit32u bufferLength);
+	bool produceOutput(int i, float *leftBuf, float *rightBuf, Bit32u bufferLength);
 	bool shouldReverb(int i);
 	void clearAlreadyOutputed();
+	Partial *getPartial(unsigned int partialNum);
 	const Partial *getPartial(unsigned int partialNum) const;
+	// Renders the partials of the aborting poly for up to length samples ahead of the other partials,
+	// and returns the number of samples to render next, so that the aborting poly becomes inactive exactly at the end of that run.
+	// The deactivation of the prerendered partials is deferred until completeAbortingPolyPrerender() is invoked after the run.
+	Bit32u prerenderAbortingPoly(const Poly *abortingPoly, Bit32u length);
+	void completeAbortingPolyPrerender();
 	Poly *assignPolyToPart(Part *part);
 	void polyFreed(Poly *poly);
 };
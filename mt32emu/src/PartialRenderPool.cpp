@@ -0,0 +1,313 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mt32emu.h"
+
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+
+#include "PartialManager.h"
+#include "PartialRenderPool.h"
+#include "Threads.h"
+
+namespace MT32Emu {
+
+// Splitting the work makes no sense unless each thread gets at least this many partials to render.
+static const unsigned int MIN_PARTIALS_PER_THREAD = 4;
+
+// Shorter runs are rendered serially since the synchronisation overhead outweighs the gain.
+static const Bit32u MIN_CONCURRENT_RENDER_LENGTH = 16;
+
+static void *allocateBuses(RendererType rendererType) {
+	if (rendererType == RendererType_FLOAT) {
+		return new float[4 * MAX_SAMPLES_PER_RUN];
+	}
+	return new Bit16s[4 * MAX_SAMPLES_PER_RUN];
+}
+
+static void freeBuses(void *buses, RendererType rendererType) {
+	if (rendererType == RendererType_FLOAT) {
+		delete[] static_cast<float *>(buses);
+	} else {
+		delete[] static_cast<Bit16s *>(buses);
+	}
+}
+
+static inline void mixSample(Bit16s &target, const Bit16s sample) {
+	target = Synth::clipBit16s((Bit32s)target + (Bit32s)sample);
+}
+
+static inline void mixSample(float &target, const float sample) {
+	target += sample;
+}
+
+struct PartialRenderPool::Worker {
+	PartialRenderPool *pool;
+	ThreadHandle thread;
+
+	// Range of tasks assigned for the current run
+	unsigned int firstTask;
+	unsigned int taskCount;
+
+	// Private buses, each MAX_SAMPLES_PER_RUN long: non-reverb left & right, reverb dry left & right.
+	// Not allocated for the rendering thread which renders directly to the output buffers.
+	// The samples are either Bit16s or float, according to the renderer type.
+	void *buses;
+
+	DeactivatedPartialList deactivatedPartialList;
+};
+
+struct PartialRenderPool::SyncState {
+	Mutex mutex;
+	Condition runStartedCondition;
+	Condition runFinishedCondition;
+
+	// Incremented each time a new run is started
+	Bit32u runNumber;
+	Bit32u runLength;
+	unsigned int busyWorkerCount;
+	bool stopping;
+};
+
+PartialRenderPool::PartialRenderPool(PartialManager *usePartialManager, unsigned int usePartialCount, unsigned int useThreadCount, RendererType useRendererType) :
+	partialManager(usePartialManager), partialCount(usePartialCount), rendererType(useRendererType), threadCount(1) {
+	if (useThreadCount < 1) {
+		useThreadCount = 1;
+	} else if (useThreadCount > MAX_THREAD_COUNT) {
+		useThreadCount = MAX_THREAD_COUNT;
+	}
+	tasks = new Task[partialCount];
+
+	syncState = new SyncState;
+	initMutex(syncState->mutex);
+	initCondition(syncState->runStartedCondition);
+	initCondition(syncState->runFinishedCondition);
+	syncState->runNumber = 0;
+	syncState->runLength = 0;
+	syncState->busyWorkerCount = 0;
+	syncState->stopping = false;
+
+	workers = new Worker[useThreadCount];
+	for (unsigned int i = 0; i < useThreadCount; i++) {
+		Worker &worker = workers[i];
+		worker.pool = this;
+		worker.firstTask = 0;
+		worker.taskCount = 0;
+		worker.buses = i == 0 ? NULL : allocateBuses(rendererType);
+		worker.deactivatedPartialList.partials = new Partial *[partialCount];
+		worker.deactivatedPartialList.count = 0;
+		if (i > 0 && !startThread(worker.thread, workerThreadProc, &worker)) {
+			freeBuses(worker.buses, rendererType);
+			delete[] worker.deactivatedPartialList.partials;
+			break;
+		}
+		threadCount = i + 1;
+	}
+}
+
+PartialRenderPool::~PartialRenderPool() {
+	stopWorkers();
+	for (unsigned int i = 0; i < threadCount; i++) {
+		if (workers[i].buses != NULL) {
+			freeBuses(workers[i].buses, rendererType);
+		}
+		delete[] workers[i].deactivatedPartialList.partials;
+	}
+	delete[] workers;
+	destroyCondition(syncState->runFinishedCondition);
+	destroyCondition(syncState->runStartedCondition);
+	destroyMutex(syncState->mutex);
+	delete syncState;
+	delete[] tasks;
+}
+
+unsigned int PartialRenderPool::getThreadCount() const {
+	return threadCount;
+}
+
+void PartialRenderPool::stopWorkers() {
+	lockMutex(syncState->mutex);
+	syncState->stopping = true;
+	broadcastCondition(syncState->runStartedCondition);
+	unlockMutex(syncState->mutex);
+	for (unsigned int i = 1; i < threadCount; i++) {
+		joinThread(workers[i].thread);
+	}
+}
+
+#ifdef _WIN32
+unsigned long __stdcall PartialRenderPool::workerThreadProc(void *worker) {
+	Worker *useWorker = (Worker *)worker;
+	useWorker->pool->runWorker(*useWorker);
+	return 0;
+}
+#else
+void *PartialRenderPool::workerThreadProc(void *worker) {
+	Worker *useWorker = (Worker *)worker;
+	useWorker->pool->runWorker(*useWorker);
+	return NULL;
+}
+#endif
+
+void PartialRenderPool::runWorker(Worker &worker) {
+	SyncState &sync = *syncState;
+	Bit32u lastRunNumber = 0;
+	lockMutex(sync.mutex);
+	for (;;) {
+		while (!sync.stopping && sync.runNumber == lastRunNumber) {
+			waitCondition(sync.runStartedCondition, sync.mutex);
+		}
+		if (sync.stopping) {
+			break;
+		}
+		lastRunNumber = sync.runNumber;
+		Bit32u len = sync.runLength;
+		unlockMutex(sync.mutex);
+
+		if (worker.taskCount > 0) {
+			if (rendererType == RendererType_FLOAT) {
+				renderToBuses(worker, static_cast<float *>(worker.buses), len);
+			} else {
+				renderToBuses(worker, static_cast<Bit16s *>(worker.buses), len);
+			}
+		}
+
+		lockMutex(sync.mutex);
+		if (--sync.busyWorkerCount == 0) {
+			broadcastCondition(sync.runFinishedCondition);
+		}
+	}
+	unlockMutex(sync.mutex);
+}
+
+template <class Sample>
+void PartialRenderPool::renderToBuses(const Worker &worker, Sample *buses, Bit32u len) {
+	Sample *nonReverbLeft = buses;
+	Sample *nonReverbRight = nonReverbLeft + MAX_SAMPLES_PER_RUN;
+	Sample *reverbDryLeft = nonReverbRight + MAX_SAMPLES_PER_RUN;
+	Sample *reverbDryRight = reverbDryLeft + MAX_SAMPLES_PER_RUN;
+	Synth::muteSampleBuffer(nonReverbLeft, len);
+	Synth::muteSampleBuffer(nonReverbRight, len);
+	Synth::muteSampleBuffer(reverbDryLeft, len);
+	Synth::muteSampleBuffer(reverbDryRight, len);
+	renderTasks(&tasks[worker.firstTask], worker.taskCount, nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+}
+
+template <class Sample>
+void PartialRenderPool::renderTasks(const Task *taskList, unsigned int taskCount, Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Bit32u len) {
+	for (unsigned int i = 0; i < taskCount; i++) {
+		if (taskList[i].reverb) {
+			taskList[i].partial->produceOutput(reverbDryLeft, reverbDryRight, len);
+		} else {
+			taskList[i].partial->produceOutput(nonReverbLeft, nonReverbRight, len);
+		}
+	}
+}
+
+template <class Sample>
+void PartialRenderPool::mixBus(Sample *target, const Sample *bus, Bit32u len) {
+	while (len--) {
+		mixSample(*(target++), *(bus++));
+	}
+}
+
+void PartialRenderPool::produceOutput(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit32u len) {
+	doProduceOutput(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+}
+
+void PartialRenderPool::produceOutput(float *nonReverbLeft, float *nonReverbRight, float *reverbDryLeft, float *reverbDryRight, Bit32u len) {
+	doProduceOutput(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+}
+
+template <class Sample>
+void PartialRenderPool::doProduceOutput(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Bit32u len) {
+	unsigned int taskCount = 0;
+	for (unsigned int i = partialManager->findNextActivePartial(0); i < partialCount; i = partialManager->findNextActivePartial(i + 1)) {
+		Partial *partial = partialManager->getPartial(i);
+		// Ring modulating slaves are rendered along with their masters.
+		// Partials of the aborting poly may be already deactivated, but their prerendered output is still due.
+		if ((!partial->isActive() && !partial->hasPrerenderedOutput()) || partial->isRingModulatingSlave()) {
+			continue;
+		}
+		tasks[taskCount].partial = partial;
+		tasks[taskCount].reverb = partial->shouldReverb();
+		taskCount++;
+	}
+
+	unsigned int usedThreadCount = taskCount / MIN_PARTIALS_PER_THREAD;
+	if (usedThreadCount > threadCount) {
+		usedThreadCount = threadCount;
+	}
+	if (usedThreadCount < 2 || len < MIN_CONCURRENT_RENDER_LENGTH) {
+		renderTasks(tasks, taskCount, nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+		return;
+	}
+
+	// Each thread gets a range of consecutive tasks, so that concatenating the lists of deactivated partials
+	// in the order of threads gives exactly the order the serial rendering loop deactivates them.
+	for (unsigned int i = 0; i < threadCount; i++) {
+		Worker &worker = workers[i];
+		if (i < usedThreadCount) {
+			worker.firstTask = taskCount * i / usedThreadCount;
+			worker.taskCount = taskCount * (i + 1) / usedThreadCount - worker.firstTask;
+		} else {
+			worker.firstTask = 0;
+			worker.taskCount = 0;
+		}
+		worker.deactivatedPartialList.count = 0;
+		for (unsigned int taskNum = worker.firstTask; taskNum < worker.firstTask + worker.taskCount; taskNum++) {
+			tasks[taskNum].partial->setDeactivatedPartialList(&worker.deactivatedPartialList);
+		}
+	}
+
+	SyncState &sync = *syncState;
+	lockMutex(sync.mutex);
+	sync.runLength = len;
+	sync.busyWorkerCount = threadCount - 1;
+	sync.runNumber++;
+	broadcastCondition(sync.runStartedCondition);
+	unlockMutex(sync.mutex);
+
+	renderTasks(tasks, workers[0].taskCount, nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+
+	lockMutex(sync.mutex);
+	while (sync.busyWorkerCount > 0) {
+		waitCondition(sync.runFinishedCondition, sync.mutex);
+	}
+	unlockMutex(sync.mutex);
+
+	for (unsigned int i = 1; i < usedThreadCount; i++) {
+		const Sample *buses = static_cast<const Sample *>(workers[i].buses);
+		mixBus(nonReverbLeft, buses, len);
+		mixBus(nonReverbRight, buses + MAX_SAMPLES_PER_RUN, len);
+		mixBus(reverbDryLeft, buses + 2 * MAX_SAMPLES_PER_RUN, len);
+		mixBus(reverbDryRight, buses + 3 * MAX_SAMPLES_PER_RUN, len);
+	}
+
+	for (unsigned int taskNum = 0; taskNum < taskCount; taskNum++) {
+		tasks[taskNum].partial->setDeactivatedPartialList(NULL);
+	}
+	for (unsigned int i = 0; i < usedThreadCount; i++) {
+		const DeactivatedPartialList &list = workers[i].deactivatedPartialList;
+		for (unsigned int j = 0; j < list.count; j++) {
+			list.partials[j]->completeDeferredDeactivation();
+		}
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MT32EMU_PARTIAL_RENDER_POOL_H
+#define MT32EMU_PARTIAL_RENDER_POOL_H
+
+namespace MT32Emu {
+
+class PartialManager;
+
+// Renders active partials concurrently using a pool of worker threads.
+// The partials are split into disjoint sets of consecutive partials, one set per thread, and each set is mixed into
+// a separate bus. The buses are then reduced in a fixed order, and the polys are notified about deactivated partials
+// in the same order as with serial rendering. Thus, the output is deterministic for a given number of threads.
+// However, it may slightly differ from the output rendered serially, since the partials are summed in a different order.
+class PartialRenderPool {
+private:
+	struct Task {
+		Partial *partial;
+		bool reverb;
+	};
+	struct Worker;
+	struct SyncState;
+
+	PartialManager *partialManager;
+	const unsigned int partialCount;
+	const RendererType rendererType;
+	unsigned int threadCount;
+
+	Task *tasks;
+	Worker *workers;
+	SyncState *syncState;
+
+	template <class Sample>
+	static void renderTasks(const Task *taskList, unsigned int taskCount, Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Bit32u len);
+	template <class Sample>
+	static void mixBus(Sample *target, const Sample *bus, Bit32u len);
+	template <class Sample>
+	void renderToBuses(const Worker &worker, Sample *buses, Bit32u len);
+	template <class Sample>
+	void doProduceOutput(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Bit32u len);
+	void runWorker(Worker &worker);
+	void stopWorkers();
+
+#ifdef _WIN32
+	static unsigned long __stdcall workerThreadProc(void *worker);
+#else
+	static void *workerThreadProc(void *worker);
+#endif
+
+public:
+	static const unsigned int MAX_THREAD_COUNT = 16;
+
+	// Starts threadCount - 1 worker threads. The rendering thread itself makes the last one.
+	// The buses are allocated for the samples of the specified renderer type.
+	PartialRenderPool(PartialManager *partialManager, unsigned int partialCount, unsigned int threadCount, RendererType rendererType);
+	~PartialRenderPool();
+
+	// Returns the number of threads actually available for rendering, including the rendering thread.
+	unsigned int getThreadCount() const;
+
+	// Produces output of all active partials like the serial loop in Synth::doRenderStreams() does.
+	// The buffers are expected to be muted beforehand.
+	// The sample type must match the renderer type.
+	void produceOutput(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit32u len);
+	void produceOutput(float *nonReverbLeft, float *nonReverbRight, float *reverbDryLeft, float *reverbDryRight, Bit32u len);
+};
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "mt32emu.h"
+#include "ROMCache.h"
+
+namespace MT32Emu {
+
+struct ROMCacheEntry {
+	// Points to a statically allocated string within the ROMInfo of the ROM image
+	const char *sha1Digest;
+	// Either Bit8u[CONTROL_ROM_SIZE] or Bit16s[pcmROMSize]
+	void *data;
+	bool pcmROMData;
+	unsigned int refCount;
+	ROMCacheEntry *next;
+};
+
+static ROMCacheEntry *firstEntry = NULL;
+
+#ifdef _WIN32
+
+// A critical section can't be initialised statically
+static class ROMCacheLock {
+private:
+	CRITICAL_SECTION criticalSection;
+
+public:
+	ROMCacheLock() { InitializeCriticalSection(&criticalSection); }
+	~ROMCacheLock() { DeleteCriticalSection(&criticalSection); }
+	void lock() { EnterCriticalSection(&criticalSection); }
+	void unlock() { LeaveCriticalSection(&criticalSection); }
+} cacheLock;
+
+#else
+
+// Only the mutex functions are used, which need no explicit linking against the thread library
+static class ROMCacheLock {
+private:
+	pthread_mutex_t mutex;
+
+public:
+	ROMCacheLock() { pthread_mutex_init(&mutex, NULL); }
+	~ROMCacheLock() { pthread_mutex_destroy(&mutex); }
+	void lock() { pthread_mutex_lock(&mutex); }
+	void unlock() { pthread_mutex_unlock(&mutex); }
+} cacheLock;
+
+#endif
+
+// Each 16-bit sample is stored with the bits of its two bytes shuffled.
+// Since every byte only affects its own set of sample bits, the unscrambling is done with a pair of lookup tables.
+static void unscramblePCMROM(Bit16s *pcmROMData, const Bit8u *fileData, size_t pcmROMSize) {
+	// Source bit for each of the sample bits 15..1, counting from MSB of the first byte. The LSB is always 0.
+	static const int order[15] = {0, 9, 1, 2, 3, 4, 5, 6, 7, 10, 11, 12, 13, 14, 15};
+
+	Bit16u firstByteBits[256];
+	Bit16u secondByteBits[256];
+	for (unsigned int byte = 0; byte < 256; byte++) {
+		Bit16u first = 0;
+		Bit16u second = 0;
+		for (int u = 0; u < 15; u++) {
+			if (order[u] < 8) {
+				first |= ((byte >> (7 - order[u])) & 1) << (15 - u);
+			} else {
+				second |= ((byte >> (7 - (order[u] - 8))) & 1) << (15 - u);
+			}
+		}
+		firstByteBits[byte] = first;
+		secondByteBits[byte] = second;
+	}
+
+	for (size_t i = 0; i < pcmROMSize; i++) {
+		pcmROMData[i] = Bit16s(firstByteBits[fileData[0]] | secondByteBits[fileData[1]]);
+		fileData += 2;
+	}
+}
+
+// Returns the data of a cached ROM image referencing it once more, or NULL if not cached yet.
+// Must be called with the cache locked.
+static void *referenceEntry(const char *sha1Digest) {
+	for (ROMCacheEntry *entry = firstEntry; entry != NULL; entry = entry->next) {
+		if (strcmp(entry->sha1Digest, sha1Digest) == 0) {
+			entry->refCount++;
+			return entry->data;
+		}
+	}
+	return NULL;
+}
+
+// Must be called with the cache locked
+static void addEntry(const char *sha1Digest, void *data, bool pcmROMData) {
+	ROMCacheEntry *entry = new ROMCacheEntry;
+	entry->sha1Digest = sha1Digest;
+	entry->data = data;
+	entry->pcmROMData = pcmROMData;
+	entry->refCount = 1;
+	entry->next = firstEntry;
+	firstEntry = entry;
+}
+
+const Bit8u *ROMCache::acquireControlROMData(const ROMImage &controlROMImage) {
+	const char *sha1Digest = controlROMImage.getROMInfo()->sha1Digest;
+	cacheLock.lock();
+	Bit8u *controlROMData = (Bit8u *)referenceEntry(sha1Digest);
+	if (controlROMData == NULL) {
+		controlROMData = new Bit8u[CONTROL_ROM_SIZE];
+		memcpy(controlROMData, controlROMImage.getFile()->getData(), CONTROL_ROM_SIZE);
+		addEntry(sha1Digest, controlROMData, false);
+	}
+	cacheLock.unlock();
+	return controlROMData;
+}
+
+const Bit16s *ROMCache::acquirePCMROMData(const ROMImage &pcmROMImage, size_t pcmROMSize) {
+	const char *sha1Digest = pcmROMImage.getROMInfo()->sha1Digest;
+	cacheLock.lock();
+	Bit16s *pcmROMData = (Bit16s *)referenceEntry(sha1Digest);
+	if (pcmROMData == NULL) {
+		pcmROMData = new Bit16s[pcmROMSize];
+		unscramblePCMROM(pcmROMData, pcmROMImage.getFile()->getData(), pcmROMSize);
+		addEntry(sha1Digest, pcmROMData, true);
+	}
+	cacheLock.unlock();
+	return pcmROMData;
+}
+
+void ROMCache::releaseROMData(const void *romData) {
+	if (romData == NULL) return;
+	cacheLock.lock();
+	for (ROMCacheEntry **link = &firstEntry; *link != NULL; link = &(*link)->next) {
+		ROMCacheEntry *entry = *link;
+		if (entry->data != romData) continue;
+		if (--entry->refCount == 0) {
+			*link = entry->next;
+			if (entry->pcmROMData) {
+				delete[] (Bit16s *)entry->data;
+			} else {
+				delete[] (Bit8u *)entry->data;
+			}
+			delete entry;
+		}
+		break;
+	}
+	cacheLock.unlock();
+}
+
+}
@@ -0,0 +1,44 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MT32EMU_ROM_CACHE_H
+#define MT32EMU_ROM_CACHE_H
+
+namespace MT32Emu {
+
+class ROMImage;
+
+// Keeps ROM data in the form used by Synth, so that all the synths opened with the same ROMs share a single copy.
+// Entries are identified by the SHA1 digest of the ROM image and freed when the last synth releases them.
+// The data is immutable once loaded. All the methods are safe to call from different threads.
+class ROMCache {
+public:
+	// Both acquire methods expect a ROM image of the right type and size that has been validated by the caller.
+
+	// Returns the contents of the control ROM image given, CONTROL_ROM_SIZE bytes long
+	static const Bit8u *acquireControlROMData(const ROMImage &controlROMImage);
+
+	// Returns the samples of the PCM ROM image given in the unscrambled form, pcmROMSize samples long
+	static const Bit16s *acquirePCMROMData(const ROMImage &pcmROMImage, size_t pcmROMSize);
+
+	// Accepts data returned by either acquire method
+	static void releaseROMData(const void *romData);
+};
+
+}
+
+#endif
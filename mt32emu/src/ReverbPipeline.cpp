@@ -0,0 +1,289 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "mt32emu.h"
+
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+
+#include "BReverbModel.h"
+#include "ReverbPipeline.h"
+#include "Threads.h"
+
+namespace MT32Emu {
+
+static const Bit32u DELAY_LINE_LENGTH = PIPELINED_REVERB_LATENCY;
+// Holds the wet output of the run being processed in addition to the output due during the current run
+static const Bit32u WET_OUTPUT_FIFO_LENGTH = 2 * PIPELINED_REVERB_LATENCY;
+static const Bit32u BUFFER_SIZE = 4 * DELAY_LINE_LENGTH + 2 * WET_OUTPUT_FIFO_LENGTH + 2 * PIPELINED_REVERB_LATENCY;
+
+struct ReverbPipeline::SyncState {
+	Mutex mutex;
+	Condition jobStartedCondition;
+	Condition jobFinishedCondition;
+	ThreadHandle thread;
+
+	// Parameters of the pending job
+	BReverbModel *reverbModel;
+	Bit32u wetOutputWritePosition;
+	Bit32u runLength;
+	// Whether the reverb model had any audible samples before processing the last job
+	bool reverbWasActive;
+
+	bool jobPending;
+	bool stopping;
+};
+
+template <class Sample>
+static void readFromFIFO(const Sample *fifo, Bit32u position, Sample *buffer, Bit32u len) {
+	if (buffer == NULL) return;
+	Bit32u firstLength = WET_OUTPUT_FIFO_LENGTH - position;
+	if (firstLength > len) firstLength = len;
+	memcpy(buffer, fifo + position, firstLength * sizeof(Sample));
+	memcpy(buffer + firstLength, fifo, (len - firstLength) * sizeof(Sample));
+}
+
+template <class Sample>
+static void muteFIFO(Sample *fifo, Bit32u position, Bit32u len) {
+	Bit32u firstLength = WET_OUTPUT_FIFO_LENGTH - position;
+	if (firstLength > len) firstLength = len;
+	Synth::muteSampleBuffer(fifo + position, firstLength);
+	Synth::muteSampleBuffer(fifo, len - firstLength);
+}
+
+template <class Sample>
+static void exchangeWithDelayLine(Sample *delayLine, Bit32u position, Sample *stream, Bit32u len) {
+	if (stream == NULL) return;
+	for (Bit32u i = 0; i < len; i++) {
+		Sample sample = delayLine[position];
+		delayLine[position] = stream[i];
+		stream[i] = sample;
+		if (++position == DELAY_LINE_LENGTH) position = 0;
+	}
+}
+
+static Bit32u advanceFIFOPosition(Bit32u position, Bit32u len) {
+	position += len;
+	return position < WET_OUTPUT_FIFO_LENGTH ? position : position - WET_OUTPUT_FIFO_LENGTH;
+}
+
+ReverbPipeline::ReverbPipeline(RendererType useRendererType) :
+	rendererType(useRendererType), delayLinePosition(0), wetOutputReadPosition(0), wetOutputWritePosition(DELAY_LINE_LENGTH),
+	pendingRunLength(0), pendingRunQuiet(true), quietLength(0)
+{
+	// Initially, the pipeline is filled with silence. It is considered active nonetheless until the reverb model
+	// is known to be inactive, since the model may still hold samples processed before the pipeline was created.
+	if (rendererType == RendererType_FLOAT) {
+		float *floatBuffers = new float[BUFFER_SIZE];
+		Synth::muteSampleBuffer(floatBuffers, BUFFER_SIZE);
+		buffers = floatBuffers;
+	} else {
+		Bit16s *intBuffers = new Bit16s[BUFFER_SIZE];
+		Synth::muteSampleBuffer(intBuffers, BUFFER_SIZE);
+		buffers = intBuffers;
+	}
+
+	syncState = new SyncState;
+	initMutex(syncState->mutex);
+	initCondition(syncState->jobStartedCondition);
+	initCondition(syncState->jobFinishedCondition);
+	syncState->reverbModel = NULL;
+	syncState->wetOutputWritePosition = 0;
+	syncState->runLength = 0;
+	syncState->reverbWasActive = false;
+	syncState->jobPending = false;
+	syncState->stopping = false;
+	threadStarted = startThread(syncState->thread, workerThreadProc, this);
+}
+
+ReverbPipeline::~ReverbPipeline() {
+	if (threadStarted) {
+		sync();
+		lockMutex(syncState->mutex);
+		syncState->stopping = true;
+		broadcastCondition(syncState->jobStartedCondition);
+		unlockMutex(syncState->mutex);
+		joinThread(syncState->thread);
+	}
+	destroyCondition(syncState->jobFinishedCondition);
+	destroyCondition(syncState->jobStartedCondition);
+	destroyMutex(syncState->mutex);
+	delete syncState;
+	if (rendererType == RendererType_FLOAT) {
+		delete[] static_cast<float *>(buffers);
+	} else {
+		delete[] static_cast<Bit16s *>(buffers);
+	}
+}
+
+bool ReverbPipeline::isThreadStarted() const {
+	return threadStarted;
+}
+
+bool ReverbPipeline::isActive() const {
+	return quietLength < PIPELINED_REVERB_LATENCY;
+}
+
+void ReverbPipeline::sync() {
+	if (pendingRunLength == 0) return;
+	SyncState &syncRef = *syncState;
+	lockMutex(syncRef.mutex);
+	while (syncRef.jobPending) {
+		waitCondition(syncRef.jobFinishedCondition, syncRef.mutex);
+	}
+	bool reverbWasActive = syncRef.reverbWasActive;
+	unlockMutex(syncRef.mutex);
+
+	// When the reverb model was inactive and received silence, its output is inaudible as well
+	if (pendingRunQuiet && !reverbWasActive) {
+		quietLength += pendingRunLength;
+		if (quietLength > PIPELINED_REVERB_LATENCY) quietLength = PIPELINED_REVERB_LATENCY;
+	} else {
+		quietLength = 0;
+	}
+	pendingRunLength = 0;
+}
+
+#ifdef _WIN32
+unsigned long __stdcall ReverbPipeline::workerThreadProc(void *pipeline) {
+	static_cast<ReverbPipeline *>(pipeline)->runWorker();
+	return 0;
+}
+#else
+void *ReverbPipeline::workerThreadProc(void *pipeline) {
+	static_cast<ReverbPipeline *>(pipeline)->runWorker();
+	return NULL;
+}
+#endif
+
+void ReverbPipeline::runWorker() {
+	SyncState &syncRef = *syncState;
+	lockMutex(syncRef.mutex);
+	for (;;) {
+		while (!syncRef.stopping && !syncRef.jobPending) {
+			waitCondition(syncRef.jobStartedCondition, syncRef.mutex);
+		}
+		if (syncRef.stopping) {
+			break;
+		}
+		BReverbModel *reverbModel = syncRef.reverbModel;
+		Bit32u writePosition = syncRef.wetOutputWritePosition;
+		Bit32u len = syncRef.runLength;
+		unlockMutex(syncRef.mutex);
+
+		bool reverbWasActive = reverbModel->isActive();
+		if (rendererType == RendererType_FLOAT) {
+			processJob<float>(reverbModel, writePosition, len);
+		} else {
+			processJob<Bit16s>(reverbModel, writePosition, len);
+		}
+
+		lockMutex(syncRef.mutex);
+		syncRef.reverbWasActive = reverbWasActive;
+		syncRef.jobPending = false;
+		broadcastCondition(syncRef.jobFinishedCondition);
+	}
+	unlockMutex(syncRef.mutex);
+}
+
+template <class Sample>
+void ReverbPipeline::processJob(BReverbModel *reverbModel, Bit32u writePosition, Bit32u len) {
+	Sample *wetOutputLeft = static_cast<Sample *>(buffers) + 4 * DELAY_LINE_LENGTH;
+	Sample *wetOutputRight = wetOutputLeft + WET_OUTPUT_FIFO_LENGTH;
+	const Sample *inLeft = wetOutputRight + WET_OUTPUT_FIFO_LENGTH;
+	const Sample *inRight = inLeft + PIPELINED_REVERB_LATENCY;
+	Bit32u firstLength = WET_OUTPUT_FIFO_LENGTH - writePosition;
+	if (firstLength > len) firstLength = len;
+	reverbModel->process(inLeft, inRight, wetOutputLeft + writePosition, wetOutputRight + writePosition, firstLength);
+	if (firstLength < len) {
+		reverbModel->process(inLeft + firstLength, inRight + firstLength, wetOutputLeft, wetOutputRight, len - firstLength);
+	}
+}
+
+void ReverbPipeline::processReverb(BReverbModel *reverbModel, bool dryActive, const Bit16s *reverbDryLeft, const Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u len) {
+	doProcessReverb(reverbModel, dryActive, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
+}
+
+void ReverbPipeline::processReverb(BReverbModel *reverbModel, bool dryActive, const float *reverbDryLeft, const float *reverbDryRight, float *reverbWetLeft, float *reverbWetRight, Bit32u len) {
+	doProcessReverb(reverbModel, dryActive, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
+}
+
+template <class Sample>
+void ReverbPipeline::doProcessReverb(BReverbModel *reverbModel, bool dryActive, const Sample *reverbDryLeft, const Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len) {
+	Sample *wetOutputLeft = static_cast<Sample *>(buffers) + 4 * DELAY_LINE_LENGTH;
+	Sample *wetOutputRight = wetOutputLeft + WET_OUTPUT_FIFO_LENGTH;
+	Sample *inLeft = wetOutputRight + WET_OUTPUT_FIFO_LENGTH;
+	Sample *inRight = inLeft + PIPELINED_REVERB_LATENCY;
+
+	// The wet output due now is complete as soon as the thread finishes the previous run
+	sync();
+	readFromFIFO(wetOutputLeft, wetOutputReadPosition, reverbWetLeft, len);
+	readFromFIFO(wetOutputRight, wetOutputReadPosition, reverbWetRight, len);
+	wetOutputReadPosition = advanceFIFOPosition(wetOutputReadPosition, len);
+
+	if (dryActive) {
+		quietLength = 0;
+	}
+	if (reverbModel == NULL) {
+		muteFIFO(wetOutputLeft, wetOutputWritePosition, len);
+		muteFIFO(wetOutputRight, wetOutputWritePosition, len);
+		wetOutputWritePosition = advanceFIFOPosition(wetOutputWritePosition, len);
+		if (!dryActive) {
+			quietLength += len;
+			if (quietLength > PIPELINED_REVERB_LATENCY) quietLength = PIPELINED_REVERB_LATENCY;
+		}
+		return;
+	}
+
+	memcpy(inLeft, reverbDryLeft, len * sizeof(Sample));
+	memcpy(inRight, reverbDryRight, len * sizeof(Sample));
+	pendingRunLength = len;
+	pendingRunQuiet = !dryActive;
+
+	SyncState &syncRef = *syncState;
+	lockMutex(syncRef.mutex);
+	syncRef.reverbModel = reverbModel;
+	syncRef.wetOutputWritePosition = wetOutputWritePosition;
+	syncRef.runLength = len;
+	syncRef.jobPending = true;
+	broadcastCondition(syncRef.jobStartedCondition);
+	unlockMutex(syncRef.mutex);
+	wetOutputWritePosition = advanceFIFOPosition(wetOutputWritePosition, len);
+}
+
+void ReverbPipeline::delayDryStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit32u len) {
+	doDelayDryStreams(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+}
+
+void ReverbPipeline::delayDryStreams(float *nonReverbLeft, float *nonReverbRight, float *reverbDryLeft, float *reverbDryRight, Bit32u len) {
+	doDelayDryStreams(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+}
+
+template <class Sample>
+void ReverbPipeline::doDelayDryStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Bit32u len) {
+	Sample *delayLines = static_cast<Sample *>(buffers);
+	exchangeWithDelayLine(delayLines, delayLinePosition, nonReverbLeft, len);
+	exchangeWithDelayLine(delayLines + DELAY_LINE_LENGTH, delayLinePosition, nonReverbRight, len);
+	exchangeWithDelayLine(delayLines + 2 * DELAY_LINE_LENGTH, delayLinePosition, reverbDryLeft, len);
+	exchangeWithDelayLine(delayLines + 3 * DELAY_LINE_LENGTH, delayLinePosition, reverbDryRight, len);
+	delayLinePosition = (delayLinePosition + len) % DELAY_LINE_LENGTH;
+}
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MT32EMU_REVERB_PIPELINE_H
+#define MT32EMU_REVERB_PIPELINE_H
+
+namespace MT32Emu {
+
+class BReverbModel;
+
+// Processes the reverb on a dedicated thread, concurrently with rendering of the partials for the next run.
+// The dry reverb input of each run is handed over to the thread, and the wet output is taken back during the next run.
+// To keep the streams aligned, the non-reverb and the dry streams pass through delay lines of the same length,
+// so that all the output is delayed by PIPELINED_REVERB_LATENCY samples. This only works out as long as the runs
+// do not exceed PIPELINED_REVERB_LATENCY samples, since the wet output of a run must be complete before it is due.
+class ReverbPipeline {
+private:
+	struct SyncState;
+
+	const RendererType rendererType;
+	SyncState *syncState;
+	bool threadStarted;
+
+	// Delay lines of PIPELINED_REVERB_LATENCY samples: non-reverb left & right, reverb dry left & right.
+	// Followed by the wet output FIFO of 2 * PIPELINED_REVERB_LATENCY samples per channel, left & right,
+	// and the reverb input of the run being processed, PIPELINED_REVERB_LATENCY samples per channel, left & right.
+	// The samples are either Bit16s or float, according to the renderer type.
+	void *buffers;
+	Bit32u delayLinePosition;
+	Bit32u wetOutputReadPosition;
+	Bit32u wetOutputWritePosition;
+
+	// Length of the run the reverb of which is being processed by the thread, 0 if none
+	Bit32u pendingRunLength;
+	bool pendingRunQuiet;
+	// Number of samples passed through the pipeline lately, while it only contained the inaudible output
+	Bit32u quietLength;
+
+	template <class Sample>
+	void doProcessReverb(BReverbModel *reverbModel, bool dryActive, const Sample *reverbDryLeft, const Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len);
+	template <class Sample>
+	void doDelayDryStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Bit32u len);
+	template <class Sample>
+	void processJob(BReverbModel *reverbModel, Bit32u writePosition, Bit32u len);
+	void runWorker();
+
+#ifdef _WIN32
+	static unsigned long __stdcall workerThreadProc(void *pipeline);
+#else
+	static void *workerThreadProc(void *pipeline);
+#endif
+
+public:
+	// Starts the reverb thread. The buffers are allocated for the samples of the specified renderer type.
+	ReverbPipeline(RendererType rendererType);
+	~ReverbPipeline();
+
+	// Returns false if the thread could not be started, so the pipeline is unusable.
+	bool isThreadStarted() const;
+
+	// Waits until the thread completes processing of the pending run, so that the reverb model may be accessed safely.
+	void sync();
+
+	// Returns false while the pipeline only delays inaudible samples, so that rendering may be skipped
+	// without losing any output. The pipeline is left intact in that case.
+	bool isActive() const;
+
+	// Takes the wet output of the previous run and hands the dry reverb input of this run over to the thread.
+	// If the reverb model is NULL, silence is put into the pipeline. The dryActive flag tells whether any partial
+	// may have contributed to the dry streams of this run. The wet output buffers may be NULL.
+	// The sample type must match the renderer type, and len must not exceed PIPELINED_REVERB_LATENCY.
+	void processReverb(BReverbModel *reverbModel, bool dryActive, const Bit16s *reverbDryLeft, const Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u len);
+	void processReverb(BReverbModel *reverbModel, bool dryActive, const float *reverbDryLeft, const float *reverbDryRight, float *reverbWetLeft, float *reverbWetRight, Bit32u len);
+
+	// Exchanges the samples of the streams with the delay lines in place. NULL streams are left out.
+	void delayDryStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit32u len);
+	void delayDryStreams(float *nonReverbLeft, float *nonReverbRight, float *reverbDryLeft, float *reverbDryRight, Bit32u len);
+};
+
+}
+
+#endif
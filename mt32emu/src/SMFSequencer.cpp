@@ -0,0 +1,304 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "mt32emu.h"
+#include "SMFSequencer.h"
+
+namespace MT32Emu {
+
+// Tempo in microseconds per quarter note assumed until the first Set Tempo meta event
+static const Bit32u DEFAULT_TEMPO = 500000;
+
+struct SMFSequencer::Event {
+	// Relative to the start of the song
+	Bit64u timestamp;
+	Bit32u shortMessageData;
+	// Non-zero length marks a sysex message
+	Bit32u sysexOffset;
+	Bit32u sysexLength;
+};
+
+struct SMFSequencer::Track {
+	const Bit8u *data;
+	const Bit8u *position;
+	const Bit8u *end;
+	// Absolute time of the next event in ticks
+	Bit32u tick;
+	Bit8u runningStatus;
+	bool finished;
+};
+
+static inline Bit32u readBigEndian(const Bit8u *data, unsigned int byteCount) {
+	Bit32u value = 0;
+	for (unsigned int i = 0; i < byteCount; i++) {
+		value = (value << 8) | data[i];
+	}
+	return value;
+}
+
+static bool readVariableLengthQuantity(const Bit8u *&position, const Bit8u *end, Bit32u &value) {
+	value = 0;
+	// The quantity is limited to 4 bytes
+	for (int i = 0; i < 4; i++) {
+		if (position >= end) return false;
+		Bit8u byte = *(position++);
+		value = (value << 7) | (byte & 0x7F);
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+static void readDeltaTime(Bit32u &tick, const Bit8u *&position, const Bit8u *end, bool &finished) {
+	Bit32u deltaTime;
+	if (position >= end || !readVariableLengthQuantity(position, end, deltaTime)) {
+		finished = true;
+		return;
+	}
+	tick += deltaTime;
+}
+
+// Returns the number of samples per tick.
+// The time division specifies either ticks per quarter note, or SMPTE frames per second and ticks per frame.
+static double getTickLength(Bit16u division, Bit32u tempo) {
+	if ((division & 0x8000) == 0) {
+		return double(tempo) * SAMPLE_RATE / (1000000.0 * division);
+	}
+	int framesPerSecond = -Bit8s(division >> 8);
+	unsigned int ticksPerFrame = division & 0xFF;
+	// 29 stands for 30 drop-frame, which is 29.97 frames per second
+	double frameRate = (framesPerSecond == 29) ? 30000.0 / 1001.0 : framesPerSecond;
+	return SAMPLE_RATE / (frameRate * ticksPerFrame);
+}
+
+SMFSequencer::SMFSequencer(Synth &useSynth) : synth(useSynth), events(NULL), eventCount(0), sysexData(NULL), sysexDataLength(0), startTimestamp(0), nextEventIndex(0) {
+}
+
+SMFSequencer::~SMFSequencer() {
+	unload();
+}
+
+void SMFSequencer::unload() {
+	delete[] events;
+	events = NULL;
+	eventCount = 0;
+	delete[] sysexData;
+	sysexData = NULL;
+	sysexDataLength = 0;
+	nextEventIndex = 0;
+}
+
+bool SMFSequencer::load(File &file) {
+	return load(file.getData(), file.getSize());
+}
+
+bool SMFSequencer::load(const Bit8u *data, size_t dataSize) {
+	unload();
+	if (data == NULL || dataSize < 14 || memcmp(data, "MThd", 4) != 0) return false;
+	Bit32u headerLength = readBigEndian(data + 4, 4);
+	if (headerLength < 6 || headerLength > dataSize - 8) return false;
+	Bit16u format = Bit16u(readBigEndian(data + 8, 2));
+	Bit16u declaredTrackCount = Bit16u(readBigEndian(data + 10, 2));
+	Bit16u division = Bit16u(readBigEndian(data + 12, 2));
+	// Type 2 files consist of independent sequences, which can't be merged sensibly
+	if (format > 1 || declaredTrackCount == 0 || (division & 0x7FFF) == 0 || ((division & 0x8000) != 0 && (division & 0xFF) == 0)) return false;
+
+	// The chunk lengths are checked while searching for the tracks. The unknown chunks are skipped.
+	Track *tracks = new Track[declaredTrackCount];
+	unsigned int trackCount = 0;
+	const Bit8u *dataEnd = data + dataSize;
+	const Bit8u *chunk = data + 8 + headerLength;
+	while (trackCount < declaredTrackCount && dataEnd - chunk >= 8) {
+		Bit32u chunkLength = readBigEndian(chunk + 4, 4);
+		const Bit8u *chunkData = chunk + 8;
+		// A truncated track is played as far as it goes
+		const Bit8u *chunkEnd = (Bit32u(dataEnd - chunkData) < chunkLength) ? dataEnd : chunkData + chunkLength;
+		if (memcmp(chunk, "MTrk", 4) == 0) {
+			tracks[trackCount].data = chunkData;
+			tracks[trackCount].end = chunkEnd;
+			trackCount++;
+		}
+		chunk = chunkEnd;
+	}
+	if (trackCount == 0) {
+		delete[] tracks;
+		return false;
+	}
+
+	// The first pass counts the events and the sysex data, the second one fills the buffers allocated accordingly
+	parseTracks(tracks, trackCount, division, true);
+	events = new Event[eventCount];
+	sysexData = new Bit8u[sysexDataLength];
+	parseTracks(tracks, trackCount, division, false);
+	delete[] tracks;
+
+	start(synth.getRenderedSampleCount());
+	return true;
+}
+
+void SMFSequencer::parseTracks(Track *tracks, unsigned int trackCount, Bit16u division, bool countOnly) {
+	for (unsigned int i = 0; i < trackCount; i++) {
+		Track &track = tracks[i];
+		track.position = track.data;
+		track.tick = 0;
+		track.runningStatus = 0;
+		track.finished = false;
+		readDeltaTime(track.tick, track.position, track.end, track.finished);
+	}
+	eventCount = 0;
+	sysexDataLength = 0;
+	double tickLength = getTickLength(division, DEFAULT_TEMPO);
+	// The sample position of the last tempo change, so that the rounding errors don't accumulate
+	double tempoChangeSamplePosition = 0.0;
+	Bit32u tempoChangeTick = 0;
+	for (;;) {
+		// The tracks are merged by picking the earliest event. Simultaneous events are ordered by the track number.
+		Track *track = NULL;
+		for (unsigned int i = 0; i < trackCount; i++) {
+			if (!tracks[i].finished && (track == NULL || tracks[i].tick < track->tick)) {
+				track = &tracks[i];
+			}
+		}
+		if (track == NULL) break;
+		double samplePosition = tempoChangeSamplePosition + (track->tick - tempoChangeTick) * tickLength;
+		Bit64u timestamp = Bit64u(samplePosition + 0.5);
+		const Bit8u *&position = track->position;
+		const Bit8u *end = track->end;
+		if (position >= end) {
+			track->finished = true;
+			continue;
+		}
+
+		Bit8u status = *position;
+		if (status < 0x80) {
+			status = track->runningStatus;
+			if (status == 0) {
+				// Data byte without a status, the track is corrupt
+				track->finished = true;
+				continue;
+			}
+		} else {
+			position++;
+		}
+		if (status < 0xF0) {
+			unsigned int dataLength = ((status & 0xE0) == 0xC0) ? 1 : 2;
+			if (end - position < int(dataLength)) {
+				track->finished = true;
+				continue;
+			}
+			track->runningStatus = status;
+			if (!countOnly) {
+				Event &event = events[eventCount];
+				event.timestamp = timestamp;
+				event.shortMessageData = status | (position[0] << 8) | (dataLength > 1 ? position[1] << 16 : 0);
+				event.sysexOffset = 0;
+				event.sysexLength = 0;
+			}
+			eventCount++;
+			position += dataLength;
+		} else if (status == 0xFF || status == 0xF0 || status == 0xF7) {
+			track->runningStatus = 0;
+			Bit8u metaType = 0;
+			if (status == 0xFF) {
+				if (position >= end) {
+					track->finished = true;
+					continue;
+				}
+				metaType = *(position++);
+			}
+			Bit32u length;
+			if (!readVariableLengthQuantity(position, end, length) || Bit32u(end - position) < length) {
+				track->finished = true;
+				continue;
+			}
+			if (status == 0xFF) {
+				if (metaType == 0x2F) {
+					// End of track
+					track->finished = true;
+					continue;
+				}
+				if (metaType == 0x51 && length == 3 && (division & 0x8000) == 0) {
+					tempoChangeSamplePosition = samplePosition;
+					tempoChangeTick = track->tick;
+					tickLength = getTickLength(division, readBigEndian(position, 3));
+				}
+			} else {
+				// The escaped sysex packets are only played when they contain a complete message.
+				// Messages divided into several packets aren't supported.
+				bool escaped = status == 0xF7;
+				if (!escaped || (length > 0 && position[0] == 0xF0)) {
+					Bit32u sysexLength = escaped ? length : length + 1;
+					if (!countOnly) {
+						Event &event = events[eventCount];
+						event.timestamp = timestamp;
+						event.shortMessageData = 0;
+						event.sysexOffset = sysexDataLength;
+						event.sysexLength = sysexLength;
+						Bit8u *sysex = sysexData + sysexDataLength;
+						if (!escaped) {
+							*(sysex++) = 0xF0;
+						}
+						memcpy(sysex, position, length);
+					}
+					eventCount++;
+					sysexDataLength += sysexLength;
+				}
+			}
+			position += length;
+		} else {
+			// System common and realtime messages aren't allowed in SMF
+			track->finished = true;
+			continue;
+		}
+		readDeltaTime(track->tick, position, end, track->finished);
+	}
+}
+
+void SMFSequencer::start(Bit64u useStartTimestamp) {
+	startTimestamp = useStartTimestamp;
+	nextEventIndex = 0;
+}
+
+bool SMFSequencer::enqueueEvents(Bit32u lookaheadLength) {
+	Bit64u lastTimestamp = synth.getRenderedSampleCount() + lookaheadLength;
+	while (nextEventIndex < eventCount) {
+		const Event &event = events[nextEventIndex];
+		Bit64u timestamp = startTimestamp + event.timestamp;
+		if (timestamp > lastTimestamp) break;
+		bool enqueued;
+		if (event.sysexLength > 0) {
+			enqueued = synth.playSysex(sysexData + event.sysexOffset, event.sysexLength, timestamp);
+		} else {
+			enqueued = synth.playMsg(event.shortMessageData, timestamp);
+		}
+		// The queue is full, the rest is enqueued next time
+		if (!enqueued) break;
+		nextEventIndex++;
+	}
+	return nextEventIndex < eventCount;
+}
+
+Bit32u SMFSequencer::getEventCount() const {
+	return eventCount;
+}
+
+Bit64u SMFSequencer::getSongLength() const {
+	return eventCount > 0 ? events[eventCount - 1].timestamp : 0;
+}
+
+}
@@ -0,0 +1,226 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "mt32emu.h"
+#include "mmath.h"
+
+namespace MT32Emu {
+
+// For awkward sample rate ratios, the fractional position is rounded to one of this many phases
+static const Bit32u MAX_TABLE_PHASE_COUNT = 1024;
+
+struct FilterParameters {
+	// Number of filter taps on either side of the output sample at the lower of the sample rates
+	unsigned int halfTapCount;
+	// Controls the stopband attenuation
+	double kaiserBeta;
+};
+
+static const FilterParameters FILTER_PARAMETERS[] = {
+	{4, 4.0},  // SampleRateConversionQuality_FASTEST, ~40 dB
+	{8, 6.0},  // SampleRateConversionQuality_FAST, ~63 dB
+	{16, 9.0}, // SampleRateConversionQuality_GOOD, ~90 dB
+	{32, 12.0} // SampleRateConversionQuality_BEST, ~118 dB
+};
+
+static Bit32u greatestCommonDivisor(Bit32u a, Bit32u b) {
+	while (b != 0) {
+		Bit32u r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+// Zeroth order modified Bessel function of the first kind
+static double besselI0(double x) {
+	double sum = 1.0;
+	double term = 1.0;
+	double halfX = 0.5 * x;
+	for (int k = 1; term > 1e-21 * sum; k++) {
+		double factor = halfX / k;
+		term *= factor * factor;
+		sum += term;
+	}
+	return sum;
+}
+
+// The filter works with samples in the scale of the float renderer output
+static inline void storeOutputSample(Bit16s *&buffer, float sample) {
+	*(buffer++) = Synth::convertSample(sample);
+}
+
+static inline void storeOutputSample(float *&buffer, float sample) {
+	*(buffer++) = sample;
+}
+
+SampleRateConverter::SampleRateConverter(Synth &useSynth, unsigned int useOutputSampleRate, SampleRateConversionQuality quality) :
+	synth(useSynth), outputSampleRate(useOutputSampleRate) {
+	Bit32u divisor = greatestCommonDivisor(outputSampleRate, SAMPLE_RATE);
+	phaseCount = outputSampleRate / divisor;
+	phaseIncrement = SAMPLE_RATE / divisor;
+	tablePhaseCount = phaseCount < MAX_TABLE_PHASE_COUNT ? phaseCount : MAX_TABLE_PHASE_COUNT;
+	initCoefficients(quality);
+
+	// Enough to produce MAX_SAMPLES_PER_RUN output samples in one go, see fillInputBuffer()
+	unsigned int halfTapCount = tapCount >> 1;
+	inputBufferSize = ((MAX_SAMPLES_PER_RUN - 1) * phaseIncrement + phaseCount - 1) / phaseCount + 2 * halfTapCount + 1;
+	inputBufferLeft = new float[inputBufferSize];
+	inputBufferRight = new float[inputBufferSize];
+	renderBuffer = new float[2 * MAX_SAMPLES_PER_RUN];
+
+	// The first output sample coincides with the first synth sample. The filter window preceding it is silent.
+	inputPosition = halfTapCount - 1;
+	inputBufferLength = halfTapCount - 1;
+	memset(inputBufferLeft, 0, inputBufferLength * sizeof(float));
+	memset(inputBufferRight, 0, inputBufferLength * sizeof(float));
+	phase = 0;
+}
+
+SampleRateConverter::~SampleRateConverter() {
+	delete[] coefficients;
+	delete[] inputBufferLeft;
+	delete[] inputBufferRight;
+	delete[] renderBuffer;
+}
+
+void SampleRateConverter::initCoefficients(SampleRateConversionQuality quality) {
+	const FilterParameters &parameters = FILTER_PARAMETERS[quality];
+
+	// When downsampling, the filter is stretched to keep the same transition band relative to the output sample rate
+	unsigned int halfTapCount = parameters.halfTapCount;
+	double bandwidth = 1.0;
+	if (phaseIncrement > phaseCount) {
+		bandwidth = double(phaseCount) / phaseIncrement;
+		halfTapCount = (halfTapCount * phaseIncrement + phaseCount - 1) / phaseCount;
+	}
+	tapCount = 2 * halfTapCount;
+
+	// Place the transition band, estimated by the Kaiser formula, just below the lower Nyquist frequency.
+	// All the frequencies are relative to the synth sample rate.
+	double attenuation = parameters.kaiserBeta / 0.1102 + 8.7;
+	double transitionWidth = (attenuation - 7.95) / (14.36 * tapCount);
+	double cutoff = 0.5 * bandwidth - 0.5 * transitionWidth;
+	double windowNorm = 1.0 / besselI0(parameters.kaiserBeta);
+
+	coefficients = new float[tablePhaseCount * tapCount];
+	double *taps = new double[tapCount];
+	for (Bit32u tablePhase = 0; tablePhase < tablePhaseCount; tablePhase++) {
+		float *phaseCoefficients = &coefficients[tablePhase * tapCount];
+		double sum = 0.0;
+		for (unsigned int j = 0; j < tapCount; j++) {
+			// Distance between the output sample and the input sample weighted by this tap
+			double x = double(tablePhase) / tablePhaseCount + halfTapCount - 1 - j;
+			double sincArg = 2.0 * DOUBLE_PI * cutoff * x;
+			double sinc = sincArg == 0.0 ? 1.0 : sin(sincArg) / sincArg;
+			double windowArg = x / halfTapCount;
+			double window = windowArg * windowArg < 1.0 ? besselI0(parameters.kaiserBeta * sqrt(1.0 - windowArg * windowArg)) * windowNorm : 0.0;
+			taps[j] = sinc * window;
+			sum += taps[j];
+		}
+		// Unity DC gain for each phase
+		for (unsigned int j = 0; j < tapCount; j++) {
+			phaseCoefficients[j] = float(taps[j] / sum);
+		}
+	}
+	delete[] taps;
+}
+
+void SampleRateConverter::fillInputBuffer(Bit32u outputLength) {
+	unsigned int halfTapCount = tapCount >> 1;
+
+	// Drop the samples the filter window has already passed
+	Bit32u firstUsedPosition = inputPosition + 1 - halfTapCount;
+	if (firstUsedPosition > 0) {
+		inputBufferLength -= firstUsedPosition;
+		memmove(inputBufferLeft, inputBufferLeft + firstUsedPosition, inputBufferLength * sizeof(float));
+		memmove(inputBufferRight, inputBufferRight + firstUsedPosition, inputBufferLength * sizeof(float));
+		inputPosition -= firstUsedPosition;
+	}
+
+	Bit32u lastPosition = inputPosition + (phase + (outputLength - 1) * phaseIncrement) / phaseCount;
+	Bit32u requiredLength = lastPosition + halfTapCount + 1;
+	while (inputBufferLength < requiredLength) {
+		Bit32u renderLength = requiredLength - inputBufferLength;
+		if (renderLength > MAX_SAMPLES_PER_RUN) {
+			renderLength = MAX_SAMPLES_PER_RUN;
+		}
+		synth.render(renderBuffer, renderLength);
+		const float *renderedSample = renderBuffer;
+		for (Bit32u i = 0; i < renderLength; i++) {
+			inputBufferLeft[inputBufferLength] = *(renderedSample++);
+			inputBufferRight[inputBufferLength] = *(renderedSample++);
+			inputBufferLength++;
+		}
+	}
+}
+
+void SampleRateConverter::getOutputSamples(Bit16s *buffer, Bit32u length) {
+	doGetOutputSamples(buffer, length);
+}
+
+void SampleRateConverter::getOutputSamples(float *buffer, Bit32u length) {
+	doGetOutputSamples(buffer, length);
+}
+
+template <class Sample>
+void SampleRateConverter::doGetOutputSamples(Sample *buffer, Bit32u length) {
+	unsigned int halfTapCount = tapCount >> 1;
+	while (length > 0) {
+		Bit32u runLength = length < MAX_SAMPLES_PER_RUN ? length : MAX_SAMPLES_PER_RUN;
+		fillInputBuffer(runLength);
+		for (Bit32u i = 0; i < runLength; i++) {
+			Bit32u tablePhase = tablePhaseCount == phaseCount ? phase : phase * tablePhaseCount / phaseCount;
+			const float *phaseCoefficients = &coefficients[tablePhase * tapCount];
+			const float *left = &inputBufferLeft[inputPosition + 1 - halfTapCount];
+			const float *right = &inputBufferRight[inputPosition + 1 - halfTapCount];
+
+			// The tap count is even, so two independent sums per channel are used to help vectorisation
+			float leftSum0 = 0.0f, leftSum1 = 0.0f, rightSum0 = 0.0f, rightSum1 = 0.0f;
+			for (unsigned int j = 0; j < tapCount; j += 2) {
+				leftSum0 += phaseCoefficients[j] * left[j];
+				leftSum1 += phaseCoefficients[j + 1] * left[j + 1];
+				rightSum0 += phaseCoefficients[j] * right[j];
+				rightSum1 += phaseCoefficients[j + 1] * right[j + 1];
+			}
+			storeOutputSample(buffer, leftSum0 + leftSum1);
+			storeOutputSample(buffer, rightSum0 + rightSum1);
+
+			phase += phaseIncrement;
+			inputPosition += phase / phaseCount;
+			phase %= phaseCount;
+		}
+		length -= runLength;
+	}
+}
+
+Bit32u SampleRateConverter::getLookahead() const {
+	return tapCount >> 1;
+}
+
+double SampleRateConverter::convertOutputToSynthTimestamp(double outputTimestamp) const {
+	return outputTimestamp * SAMPLE_RATE / outputSampleRate;
+}
+
+double SampleRateConverter::convertSynthToOutputTimestamp(double synthTimestamp) const {
+	return synthTimestamp * outputSampleRate / SAMPLE_RATE;
+}
+
+}
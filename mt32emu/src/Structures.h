@@ -18,6 +18,10 @@
 #ifndef MT32EMU_STRUCTURES_H
 #define MT32EMU_STRUCTURES_H
 
+#ifndef _MSC_VER
+#include <stdint.h>
+#endif
+
 namespace MT32Emu {
 
 // MT32EMU_MEMADDR() converts from sysex-padded, MT32EMU_SYSEXMEMADDR converts to it
@@ -31,6 +35,14 @@ namespace MT32Emu {
 #define MT32EMU_ALIGN_PACKED __attribute__((packed))
 #endif
 
+#ifdef _MSC_VER
+typedef unsigned __int64   Bit64u;
+typedef   signed __int64   Bit64s;
+#else
+// C++98 lacks 64-bit integer types, though the C99 header provides them with all the relevant compilers
+typedef uint64_t           Bit64u;
+typedef  int64_t           Bit64s;
+#endif
 typedef unsigned int       Bit32u;
 typedef   signed int       Bit32s;
 typedef unsigned short int Bit16u;
@@ -190,7 +202,7 @@ struct PCMWaveEntry {
 	Bit32u addr;
 	Bit32u len;
 	bool loop;
-	ControlROMPCMStruct *controlROMPCMStruct;
+	const ControlROMPCMStruct *controlROMPCMStruct;
 };
 
 // This is basically a per-partial, pre-processed combination of timbre and patch/rhythm settings
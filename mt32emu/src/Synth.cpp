@@ -20,11 +20,26 @@
 #include <cstdlib>
 #include <cstring>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #include "mt32emu.h"
 #include "mmath.h"
 #include "PartialManager.h"
+#include "PartialRenderPool.h"
+#include "ReverbPipeline.h"
+#include "ROMCache.h"
 #include "BReverbModel.h"
 
+#if MT32EMU_COLLECT_RENDER_STATISTICS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#endif
+
 namespace MT32Emu {
 
 static const ControlROMMap ControlROMMaps[7] = {
@@ -39,6 +54,133 @@ static const ControlROMMap ControlROMMaps[7] = {
 	// (Note that all but CM-32L ROM actually have 86 entries for rhythmTemp)
 };
 
+#ifdef _MSC_VER
+
+// Volatile accesses have acquire / release semantics with MSVC, so only the compiler needs to be prevented from reordering
+static inline Bit32u loadAcquire(const volatile Bit32u &value) {
+	Bit32u result = value;
+	_ReadWriteBarrier();
+	return result;
+}
+
+static inline void storeRelease(volatile Bit32u &value, Bit32u newValue) {
+	_ReadWriteBarrier();
+	value = newValue;
+}
+
+static inline bool compareAndSwap(volatile Bit32u &value, Bit32u expectedValue, Bit32u newValue) {
+	return Bit32u(_InterlockedCompareExchange((volatile long *)&value, long(newValue), long(expectedValue))) == expectedValue;
+}
+
+// 64-bit accesses aren't atomic on 32-bit targets, so they are done via the interlocked compare-and-swap
+static inline bool compareAndSwap(volatile Bit64u &value, Bit64u expectedValue, Bit64u newValue) {
+	return Bit64u(_InterlockedCompareExchange64((volatile __int64 *)&value, __int64(newValue), __int64(expectedValue))) == expectedValue;
+}
+
+static inline Bit64u loadAcquire(const volatile Bit64u &value) {
+	return Bit64u(_InterlockedCompareExchange64((volatile __int64 *)&value, 0, 0));
+}
+
+static inline void storeRelease(volatile Bit64u &value, Bit64u newValue) {
+	Bit64u oldValue = loadAcquire(value);
+	while (!compareAndSwap(value, oldValue, newValue)) {
+		oldValue = loadAcquire(value);
+	}
+}
+
+static inline Bit32u loadRelaxed(const volatile Bit32u &value) {
+	return value;
+}
+
+static inline void storeRelaxed(volatile Bit32u &value, Bit32u newValue) {
+	value = newValue;
+}
+
+static inline void memoryFence() {
+	_ReadWriteBarrier();
+}
+
+#else
+
+static inline Bit32u loadAcquire(const volatile Bit32u &value) {
+	return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+}
+
+static inline void storeRelease(volatile Bit32u &value, Bit32u newValue) {
+	__atomic_store_n(&value, newValue, __ATOMIC_RELEASE);
+}
+
+static inline bool compareAndSwap(volatile Bit32u &value, Bit32u expectedValue, Bit32u newValue) {
+	return __atomic_compare_exchange_n(&value, &expectedValue, newValue, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+static inline Bit64u loadAcquire(const volatile Bit64u &value) {
+	return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+}
+
+static inline void storeRelease(volatile Bit64u &value, Bit64u newValue) {
+	__atomic_store_n(&value, newValue, __ATOMIC_RELEASE);
+}
+
+static inline bool compareAndSwap(volatile Bit64u &value, Bit64u expectedValue, Bit64u newValue) {
+	return __atomic_compare_exchange_n(&value, &expectedValue, newValue, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+static inline Bit32u loadRelaxed(const volatile Bit32u &value) {
+	return __atomic_load_n(&value, __ATOMIC_RELAXED);
+}
+
+static inline void storeRelaxed(volatile Bit32u &value, Bit32u newValue) {
+	__atomic_store_n(&value, newValue, __ATOMIC_RELAXED);
+}
+
+static inline void memoryFence() {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
+
+#if MT32EMU_COLLECT_RENDER_STATISTICS
+
+// Returns the time of a monotonic clock in nanoseconds
+#ifdef _WIN32
+
+static Bit64u getNanoTime() {
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	// Split to avoid overflowing the intermediate product
+	Bit64u seconds = Bit64u(counter.QuadPart / frequency.QuadPart);
+	Bit64u fraction = Bit64u(counter.QuadPart % frequency.QuadPart);
+	return seconds * 1000000000 + fraction * 1000000000 / Bit64u(frequency.QuadPart);
+}
+
+#else
+
+static Bit64u getNanoTime() {
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return Bit64u(time.tv_sec) * 1000000000 + Bit64u(time.tv_nsec);
+}
+
+#endif
+
+// Adds the time elapsed since the start of the stage to the counter, and starts the next stage
+static inline void endRenderStage(Bit64u &counter, Bit64u &stageStartTime) {
+	Bit64u time = getNanoTime();
+	counter += time - stageStartTime;
+	stageStartTime = time;
+}
+
+#define MT32EMU_RENDER_STATISTICS(statement) statement
+
+#else
+
+#define MT32EMU_RENDER_STATISTICS(statement)
+
+#endif
+
+template <class Sample>
 static inline void advanceStreamPosition(Sample *&stream, Bit32u posDelta) {
 	if (stream != NULL) {
 		stream += posDelta;
@@ -69,22 +211,46 @@ Synth::Synth(ReportHandler *useReportHandler) {
 		isDefaultReportHandler = false;
 	}
 
-	reverbModels[REVERB_MODE_ROOM] = new BReverbModel(REVERB_MODE_ROOM);
-	reverbModels[REVERB_MODE_HALL] = new BReverbModel(REVERB_MODE_HALL);
-	reverbModels[REVERB_MODE_PLATE] = new BReverbModel(REVERB_MODE_PLATE);
-	reverbModels[REVERB_MODE_TAP_DELAY] = new BReverbModel(REVERB_MODE_TAP_DELAY);
+	// The reverb models are created in open() according to the renderer type
+	memset(reverbModels, 0, sizeof(reverbModels));
 
 	reverbModel = NULL;
+	reverbBuffers = NULL;
+#if MT32EMU_USE_FLOAT_SAMPLES
+	selectRendererType(RendererType_FLOAT);
+#else
+	selectRendererType(RendererType_BIT16S);
+#endif
+	rendererType = selectedRendererType;
 	setDACInputMode(DACInputMode_NICE);
 	setMIDIDelayMode(MIDIDelayMode_DELAY_SHORT_MESSAGES_ONLY);
 	setOutputGain(1.0f);
 	setReverbOutputGain(1.0f);
 	setReversedStereoEnabled(false);
+	controlROMData = NULL;
+	pcmROMData = NULL;
 	partialManager = NULL;
+	mixBuffers = NULL;
+	partialRenderThreadCount = 1;
+	partialRenderPool = NULL;
+	pipelinedReverbEnabled = false;
+	reverbPipeline = NULL;
 	midiQueue = NULL;
 	lastReceivedMIDIEventTimestamp = 0;
 	memset(parts, 0, sizeof(parts));
 	renderedSampleCount = 0;
+	memset(&renderStatistics, 0, sizeof(renderStatistics));
+	for (unsigned int i = 0; i < sizeof(publishedRenderStatistics) / sizeof(Bit32u); i++) {
+		publishedRenderStatistics[i] = 0;
+	}
+	renderStatisticsSequence = 0;
+	renderStatisticsResetRequested = 0;
+	memset(&partialAllocationStatistics, 0, sizeof(partialAllocationStatistics));
+	partialAllocationEventLog = NULL;
+	partialAllocationEventLogSize = 0;
+	partialAllocationEventLogMask = 0;
+	partialAllocationEventLogStart = 0;
+	partialAllocationEventLogEnd = 0;
 }
 
 Synth::~Synth() {
@@ -119,7 +285,7 @@ void Synth::printDebug(const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
 #if MT32EMU_DEBUG_SAMPLESTAMPS > 0
-	reportHandler->printDebug("[%u] ", renderedSampleCount);
+	reportHandler->printDebug("[%u] ", Bit32u(renderedSampleCount));
 #endif
 	reportHandler->printDebug(fmt, ap);
 	va_end(ap);
@@ -133,9 +299,6 @@ void Synth::setReverbEnabled(bool newReverbEnabled) {
 		refreshSystemReverbParameters();
 		reverbOverridden = oldReverbOverridden;
 	} else {
-#if MT32EMU_REDUCE_REVERB_MEMORY
-		reverbModel->close();
-#endif
 		reverbModel = NULL;
 	}
 }
@@ -153,16 +316,14 @@ bool Synth::isReverbOverridden() const {
 }
 
 void Synth::setDACInputMode(DACInputMode mode) {
-#if MT32EMU_USE_FLOAT_SAMPLES
-	// We aren't emulating these in float mode, so better to inform the invoker
-	if ((mode == DACInputMode_GENERATION1) || (mode == DACInputMode_GENERATION2)) {
-		mode = DACInputMode_NICE;
-	}
-#endif
 	dacInputMode = mode;
 }
 
 DACInputMode Synth::getDACInputMode() const {
+	// We aren't emulating these in float mode, so better to inform the invoker
+	if (selectedRendererType == RendererType_FLOAT && ((dacInputMode == DACInputMode_GENERATION1) || (dacInputMode == DACInputMode_GENERATION2))) {
+		return DACInputMode_NICE;
+	}
 	return dacInputMode;
 }
 
@@ -174,60 +335,102 @@ MIDIDelayMode Synth::getMIDIDelayMode() const {
 	return midiDelayMode;
 }
 
-#if MT32EMU_USE_FLOAT_SAMPLES
+// The float renderer takes the gain factors as is, while the 16-bit renderer uses their limited fixed-point versions.
+// The getters report the gain actually applied by the selected renderer.
 
 void Synth::setOutputGain(float newOutputGain) {
 	outputGain = newOutputGain;
+	if (newOutputGain < 0.0f) newOutputGain = -newOutputGain;
+	if (256.0f < newOutputGain) newOutputGain = 256.0f;
+	intOutputGain = int(newOutputGain * 256.0f);
 }
 
 float Synth::getOutputGain() const {
-	return outputGain;
+	return selectedRendererType == RendererType_FLOAT ? outputGain : intOutputGain / 256.0f;
 }
 
 void Synth::setReverbOutputGain(float newReverbOutputGain) {
 	reverbOutputGain = newReverbOutputGain;
+	if (newReverbOutputGain < 0.0f) newReverbOutputGain = -newReverbOutputGain;
+	float maxValue = 256.0f / CM32L_REVERB_TO_LA32_ANALOG_OUTPUT_GAIN_FACTOR;
+	if (maxValue < newReverbOutputGain) newReverbOutputGain = maxValue;
+	intReverbOutputGain = int(newReverbOutputGain * 256.0f);
 }
 
 float Synth::getReverbOutputGain() const {
-	return reverbOutputGain;
+	return selectedRendererType == RendererType_FLOAT ? reverbOutputGain : intReverbOutputGain / 256.0f;
 }
 
-#else // #if MT32EMU_USE_FLOAT_SAMPLES
-
-void Synth::setOutputGain(float newOutputGain) {
-	if (newOutputGain < 0.0f) newOutputGain = -newOutputGain;
-	if (256.0f < newOutputGain) newOutputGain = 256.0f;
-	outputGain = int(newOutputGain * 256.0f);
+void Synth::setReversedStereoEnabled(bool enabled) {
+	reversedStereoEnabled = enabled;
 }
 
-float Synth::getOutputGain() const {
-	return outputGain / 256.0f;
+bool Synth::isReversedStereoEnabled() {
+	return reversedStereoEnabled;
 }
 
-void Synth::setReverbOutputGain(float newReverbOutputGain) {
-	if (newReverbOutputGain < 0.0f) newReverbOutputGain = -newReverbOutputGain;
-	float maxValue = 256.0f / CM32L_REVERB_TO_LA32_ANALOG_OUTPUT_GAIN_FACTOR;
-	if (maxValue < newReverbOutputGain) newReverbOutputGain = maxValue;
-	reverbOutputGain = int(newReverbOutputGain * 256.0f);
+void Synth::setPartialRenderThreadCount(unsigned int threadCount) {
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	if (threadCount < 1) {
+		threadCount = 1;
+	} else if (threadCount > PartialRenderPool::MAX_THREAD_COUNT) {
+		threadCount = PartialRenderPool::MAX_THREAD_COUNT;
+	}
+	partialRenderThreadCount = threadCount;
+	// Otherwise, the pool is created in open()
+	if (partialManager != NULL) {
+		delete partialRenderPool;
+		partialRenderPool = NULL;
+		if (threadCount > 1) {
+			partialRenderPool = new PartialRenderPool(partialManager, partialCount, threadCount, rendererType);
+			partialRenderThreadCount = partialRenderPool->getThreadCount();
+		}
+	}
+#else
+	(void)threadCount;
+#endif
 }
 
-float Synth::getReverbOutputGain() const {
-	return reverbOutputGain / 256.0f;
+unsigned int Synth::getPartialRenderThreadCount() const {
+	return partialRenderThreadCount;
+}
+
+void Synth::setPipelinedReverbEnabled(bool enabled) {
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	pipelinedReverbEnabled = enabled;
+	// Otherwise, the pipeline is created in open()
+	if (partialManager != NULL) {
+		delete reverbPipeline;
+		reverbPipeline = NULL;
+		if (enabled) {
+			reverbPipeline = new ReverbPipeline(rendererType);
+			if (!reverbPipeline->isThreadStarted()) {
+				printDebug("Failed to start the reverb thread, pipelined reverb disabled");
+				delete reverbPipeline;
+				reverbPipeline = NULL;
+				pipelinedReverbEnabled = false;
+			}
+		}
+	}
+#else
+	(void)enabled;
+#endif
 }
 
-#endif // #if MT32EMU_USE_FLOAT_SAMPLES
+bool Synth::isPipelinedReverbEnabled() const {
+	return pipelinedReverbEnabled;
+}
 
-void Synth::setReversedStereoEnabled(bool enabled) {
-	reversedStereoEnabled = enabled;
+void Synth::selectRendererType(RendererType newRendererType) {
+	selectedRendererType = newRendererType;
 }
 
-bool Synth::isReversedStereoEnabled() {
-	return reversedStereoEnabled;
+RendererType Synth::getSelectedRendererType() const {
+	return selectedRendererType;
 }
 
 bool Synth::loadControlROM(const ROMImage &controlROMImage) {
 	if (&controlROMImage == NULL) return false;
-	File *file = controlROMImage.getFile();
 	const ROMInfo *controlROMInfo = controlROMImage.getROMInfo();
 	if ((controlROMInfo == NULL)
 			|| (controlROMInfo->type != ROMInfo::Control)
@@ -237,8 +440,7 @@ bool Synth::loadControlROM(const ROMImage &controlROMImage) {
 #if MT32EMU_MONITOR_INIT
 	printDebug("Found Control ROM: %s, %s", controlROMInfo->shortName, controlROMInfo->description);
 #endif
-	const Bit8u *fileData = file->getData();
-	memcpy(controlROMData, fileData, CONTROL_ROM_SIZE);
+	controlROMData = ROMCache::acquireControlROMData(controlROMImage);
 
 	// Control ROM successfully loaded, now check whether it's a known type
 	controlROMMap = NULL;
@@ -251,6 +453,8 @@ bool Synth::loadControlROM(const ROMImage &controlROMImage) {
 #if MT32EMU_MONITOR_INIT
 	printDebug("Control ROM failed to load");
 #endif
+	ROMCache::releaseROMData(controlROMData);
+	controlROMData = NULL;
 	return false;
 }
 
@@ -273,30 +477,12 @@ bool Synth::loadPCMROM(const ROMImage &pcmROMImage) {
 #endif
 		return false;
 	}
-	const Bit8u *fileData = file->getData();
-	for (size_t i = 0; i < pcmROMSize; i++) {
-		Bit8u s = *(fileData++);
-		Bit8u c = *(fileData++);
-
-		int order[16] = {0, 9, 1, 2, 3, 4, 5, 6, 7, 10, 11, 12, 13, 14, 15, 8};
-
-		signed short log = 0;
-		for (int u = 0; u < 15; u++) {
-			int bit;
-			if (order[u] < 8) {
-				bit = (s >> (7 - order[u])) & 0x1;
-			} else {
-				bit = (c >> (7 - (order[u] - 8))) & 0x1;
-			}
-			log = log | (short)(bit << (15 - u));
-		}
-		pcmROMData[i] = log;
-	}
+	pcmROMData = ROMCache::acquirePCMROMData(pcmROMImage, pcmROMSize);
 	return true;
 }
 
 bool Synth::initPCMList(Bit16u mapAddress, Bit16u count) {
-	ControlROMPCMStruct *tps = (ControlROMPCMStruct *)&controlROMData[mapAddress];
+	const ControlROMPCMStruct *tps = (const ControlROMPCMStruct *)&controlROMData[mapAddress];
 	for (int i = 0; i < count; i++) {
 		Bit32u rAddr = tps[i].pos * 0x800;
 		Bit32u rLenExp = (tps[i].len & 0x70) >> 4;
@@ -368,14 +554,26 @@ bool Synth::open(const ROMImage &controlROMImage, const ROMImage &pcmROMImage, u
 	}
 	partialCount = usePartialCount;
 	abortingPoly = NULL;
+	rendererType = selectedRendererType;
 #if MT32EMU_MONITOR_INIT
 	printDebug("Initialising Constant Tables");
 #endif
-#if !MT32EMU_REDUCE_REVERB_MEMORY
+	Bit32u reverbBufferSize = 0;
 	for (int i = REVERB_MODE_ROOM; i <= REVERB_MODE_TAP_DELAY; i++) {
-		reverbModels[i]->open();
+		delete reverbModels[i];
+		reverbModels[i] = BReverbModel::createBReverbModel(ReverbMode(i), false, rendererType);
+		if (reverbBufferSize < reverbModels[i]->getBufferSize()) {
+			reverbBufferSize = reverbModels[i]->getBufferSize();
+		}
+	}
+	if (rendererType == RendererType_FLOAT) {
+		reverbBuffers = new float[reverbBufferSize];
+	} else {
+		reverbBuffers = new Bit16s[reverbBufferSize];
+	}
+	for (int i = REVERB_MODE_ROOM; i <= REVERB_MODE_TAP_DELAY; i++) {
+		reverbModels[i]->open(reverbBuffers);
 	}
-#endif
 
 	// This is to help detect bugs
 	memset(&mt32ram, '?', sizeof(mt32ram));
@@ -395,7 +593,6 @@ bool Synth::open(const ROMImage &controlROMImage, const ROMImage &pcmROMImage, u
 	// 1MB PCM ROM for CM-32L, LAPC-I, CM-64, CM-500
 	// Note that the size below is given in samples (16-bit), not bytes
 	pcmROMSize = controlROMMap->pcmCount == 256 ? 512 * 1024 : 256 * 1024;
-	pcmROMData = new Bit16s[pcmROMSize];
 
 #if MT32EMU_MONITOR_INIT
 	printDebug("Loading PCM ROM");
@@ -434,6 +631,8 @@ bool Synth::open(const ROMImage &controlROMImage, const ROMImage &pcmROMImage, u
 	memset(&mt32ram.timbres[128], 0, sizeof(mt32ram.timbres[128]) * 64);
 
 	partialManager = new PartialManager(this, parts);
+	setPartialRenderThreadCount(partialRenderThreadCount);
+	setPipelinedReverbEnabled(pipelinedReverbEnabled);
 
 	pcmWaves = new PCMWaveEntry[controlROMMap->pcmCount];
 
@@ -512,6 +711,23 @@ bool Synth::open(const ROMImage &controlROMImage, const ROMImage &pcmROMImage, u
 
 	midiQueue = new MidiEventQueue();
 
+	if (rendererType == RendererType_FLOAT) {
+		mixBuffers = new float[6 * MAX_SAMPLES_PER_RUN];
+	} else {
+		mixBuffers = new Bit16s[6 * MAX_SAMPLES_PER_RUN];
+	}
+
+	memset(&renderStatistics, 0, sizeof(renderStatistics));
+	publishRenderStatistics();
+
+	memset(&partialAllocationStatistics, 0, sizeof(partialAllocationStatistics));
+	if (partialAllocationEventLogSize > 0) {
+		partialAllocationEventLog = new PartialAllocationEvent[partialAllocationEventLogSize];
+		partialAllocationEventLogMask = partialAllocationEventLogSize - 1;
+	}
+	partialAllocationEventLogStart = 0;
+	partialAllocationEventLogEnd = 0;
+
 	isOpen = true;
 	isEnabled = false;
 
@@ -529,6 +745,23 @@ void Synth::close() {
 	delete midiQueue;
 	midiQueue = NULL;
 
+	delete[] partialAllocationEventLog;
+	partialAllocationEventLog = NULL;
+
+	if (rendererType == RendererType_FLOAT) {
+		delete[] static_cast<float *>(mixBuffers);
+	} else {
+		delete[] static_cast<Bit16s *>(mixBuffers);
+	}
+	mixBuffers = NULL;
+
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	delete partialRenderPool;
+	partialRenderPool = NULL;
+	delete reverbPipeline;
+	reverbPipeline = NULL;
+#endif
+
 	delete partialManager;
 	partialManager = NULL;
 
@@ -538,7 +771,10 @@ void Synth::close() {
 	}
 
 	delete[] pcmWaves;
-	delete[] pcmROMData;
+	ROMCache::releaseROMData(pcmROMData);
+	pcmROMData = NULL;
+	ROMCache::releaseROMData(controlROMData);
+	controlROMData = NULL;
 
 	deleteMemoryRegions();
 
@@ -546,6 +782,12 @@ void Synth::close() {
 		reverbModels[i]->close();
 	}
 	reverbModel = NULL;
+	if (rendererType == RendererType_FLOAT) {
+		delete[] static_cast<float *>(reverbBuffers);
+	} else {
+		delete[] static_cast<Bit16s *>(reverbBuffers);
+	}
+	reverbBuffers = NULL;
 	isOpen = false;
 }
 
@@ -561,7 +803,7 @@ void Synth::flushMIDIQueue() {
 			}
 			midiQueue->dropMidiEvent();
 		}
-		lastReceivedMIDIEventTimestamp = renderedSampleCount;
+		storeRelease(lastReceivedMIDIEventTimestamp, renderedSampleCount);
 	}
 }
 
@@ -573,6 +815,15 @@ void Synth::setMIDIEventQueueSize(Bit32u useSize) {
 	}
 }
 
+Bit64u Synth::getRenderedSampleCount() const {
+	return loadAcquire(renderedSampleCount);
+}
+
+Bit64u Synth::extendTimestamp(Bit32u timestamp) const {
+	Bit64u currentTimestamp = loadAcquire(renderedSampleCount);
+	return currentTimestamp + Bit64s(Bit32s(timestamp - Bit32u(currentTimestamp)));
+}
+
 Bit32u Synth::getShortMessageLength(Bit32u msg) {
 	if ((msg & 0xF0) == 0xF0) return 1;
 	// NOTE: This calculation isn't quite correct
@@ -580,22 +831,27 @@ Bit32u Synth::getShortMessageLength(Bit32u msg) {
 	return ((msg & 0xE0) == 0xC0) ? 2 : 3;
 }
 
-Bit32u Synth::addMIDIInterfaceDelay(Bit32u len, Bit32u timestamp) {
+Bit64u Synth::addMIDIInterfaceDelay(Bit32u len, Bit64u timestamp) {
 	Bit32u transferTime =  Bit32u((double)len * MIDI_DATA_TRANSFER_RATE);
-	// Dealing with wrapping
-	if (Bit32s(timestamp - lastReceivedMIDIEventTimestamp) < 0) {
-		timestamp = lastReceivedMIDIEventTimestamp;
+	// The events may be enqueued from several threads, so the last timestamp is updated atomically
+	for (;;) {
+		Bit64u lastTimestamp = loadAcquire(lastReceivedMIDIEventTimestamp);
+		Bit64u newTimestamp = timestamp;
+		if (newTimestamp < lastTimestamp) {
+			newTimestamp = lastTimestamp;
+		}
+		newTimestamp += transferTime;
+		if (compareAndSwap(lastReceivedMIDIEventTimestamp, lastTimestamp, newTimestamp)) {
+			return newTimestamp;
+		}
 	}
-	timestamp += transferTime;
-	lastReceivedMIDIEventTimestamp = timestamp;
-	return timestamp;
 }
 
 bool Synth::playMsg(Bit32u msg) {
-	return playMsg(msg, renderedSampleCount);
+	return playMsg(msg, getRenderedSampleCount());
 }
 
-bool Synth::playMsg(Bit32u msg, Bit32u timestamp) {
+bool Synth::playMsg(Bit32u msg, Bit64u timestamp) {
 	if (midiQueue == NULL) return false;
 	if (midiDelayMode != MIDIDelayMode_IMMEDIATE) {
 		timestamp = addMIDIInterfaceDelay(getShortMessageLength(msg), timestamp);
@@ -604,10 +860,10 @@ bool Synth::playMsg(Bit32u msg, Bit32u timestamp) {
 }
 
 bool Synth::playSysex(const Bit8u *sysex, Bit32u len) {
-	return playSysex(sysex, len, renderedSampleCount);
+	return playSysex(sysex, len, getRenderedSampleCount());
 }
 
-bool Synth::playSysex(const Bit8u *sysex, Bit32u len, Bit32u timestamp) {
+bool Synth::playSysex(const Bit8u *sysex, Bit32u len, Bit64u timestamp) {
 	if (midiQueue == NULL) return false;
 	if (midiDelayMode == MIDIDelayMode_DELAY_ALL) {
 		timestamp = addMIDIInterfaceDelay(len, timestamp);
@@ -1254,6 +1510,12 @@ void Synth::refreshSystemReverbParameters() {
 	reportHandler->onNewReverbTime(mt32ram.system.reverbTime);
 	reportHandler->onNewReverbLevel(mt32ram.system.reverbLevel);
 
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	// The reverb thread may be still processing the previous run
+	if (reverbPipeline != NULL) {
+		reverbPipeline->sync();
+	}
+#endif
 	BReverbModel *oldReverbModel = reverbModel;
 	if (mt32ram.system.reverbTime == 0 && mt32ram.system.reverbLevel == 0) {
 		// Setting both time and level to 0 effectively disables wet reverb output on real devices.
@@ -1263,18 +1525,10 @@ void Synth::refreshSystemReverbParameters() {
 		reverbModel = reverbModels[mt32ram.system.reverbMode];
 	}
 	if (reverbModel != oldReverbModel) {
-#if MT32EMU_REDUCE_REVERB_MEMORY
-		if (oldReverbModel != NULL) {
-			oldReverbModel->close();
-		}
-		if (isReverbEnabled()) {
-			reverbModel->open();
-		}
-#else
+		// The models share the buffers, so the new one must not see the samples left by the old one
 		if (isReverbEnabled()) {
 			reverbModel->mute();
 		}
-#endif
 	}
 	if (isReverbEnabled()) {
 		reverbModel->setParameters(mt32ram.system.reverbTime, mt32ram.system.reverbLevel);
@@ -1344,79 +1598,266 @@ void Synth::reset() {
 	isEnabled = false;
 }
 
-MidiEvent::~MidiEvent() {
-	if (sysexData != NULL) {
-		delete[] sysexData;
-	}
-}
-
-void MidiEvent::setShortMessage(Bit32u useShortMessageData, Bit32u useTimestamp) {
-	if (sysexData != NULL) {
-		delete[] sysexData;
-	}
+void MidiEvent::setShortMessage(Bit32u useShortMessageData, Bit64u useTimestamp) {
 	shortMessageData = useShortMessageData;
 	timestamp = useTimestamp;
 	sysexData = NULL;
 	sysexLength = 0;
 }
 
-void MidiEvent::setSysex(const Bit8u *useSysexData, Bit32u useSysexLength, Bit32u useTimestamp) {
-	if (sysexData != NULL) {
-		delete[] sysexData;
-	}
+void MidiEvent::setSysex(const Bit8u *useSysexData, Bit32u useSysexLength, Bit64u useTimestamp) {
 	shortMessageData = 0;
 	timestamp = useTimestamp;
+	sysexData = useSysexData;
 	sysexLength = useSysexLength;
-	Bit8u *dstSysexData = new Bit8u[sysexLength];
-	sysexData = dstSysexData;
-	memcpy(dstSysexData, useSysexData, sysexLength);
 }
 
-MidiEventQueue::MidiEventQueue(Bit32u useRingBufferSize) : ringBufferSize(useRingBufferSize) {
-	ringBuffer = new MidiEvent[ringBufferSize];
-	memset(ringBuffer, 0, ringBufferSize * sizeof(MidiEvent));
+// The sequence number tells the state of the slot. It equals the position of the slot when it is free for writing,
+// and the position + 1 when it holds an event ready for reading. Thus, the writers can claim the slots by advancing
+// the end position without waiting for each other, and the reader never sees a partially written event.
+struct MidiEventQueue::Slot {
+	MidiEvent event;
+	volatile Bit32u sequenceNumber;
+};
+
+// The chunk header holds the size of the chunk in bytes, including the header itself, once the chunk is freed.
+// It remains zero while the chunk is in use. The chunks are released by the reader strictly in the order of allocation,
+// so that a chunk freed early just waits for the chunks allocated before it.
+static const Bit32u SYSEX_CHUNK_FREED = 0x80000000;
+
+static Bit32u roundUpToPowerOfTwo(Bit32u value) {
+	Bit32u result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+static inline Bit32u getSysexChunkSize(Bit32u sysexLength) {
+	return sizeof(Bit32u) + ((sysexLength + sizeof(Bit32u) - 1) & ~Bit32u(sizeof(Bit32u) - 1));
+}
+
+MidiEventQueue::MidiEventQueue(Bit32u ringBufferSize, Bit32u sysexArenaSize) {
+	ringBufferSize = roundUpToPowerOfTwo(ringBufferSize);
+	ringBufferMask = ringBufferSize - 1;
+	ringBuffer = new Slot[ringBufferSize];
+	// The arena must accommodate at least a single chunk header
+	sysexArenaSize = roundUpToPowerOfTwo(sysexArenaSize < sizeof(Bit32u) ? sizeof(Bit32u) : sysexArenaSize);
+	sysexArenaMask = sysexArenaSize - 1;
+	sysexArena = new Bit32u[sysexArenaSize / sizeof(Bit32u)];
 	reset();
 }
 
 MidiEventQueue::~MidiEventQueue() {
 	delete[] ringBuffer;
+	delete[] sysexArena;
 }
 
 void MidiEventQueue::reset() {
+	for (Bit32u i = 0; i <= ringBufferMask; i++) {
+		ringBuffer[i].event.setShortMessage(0, 0);
+		ringBuffer[i].sequenceNumber = i;
+	}
+	memset(sysexArena, 0, sysexArenaMask + 1);
+	sysexArenaStart = 0;
+	sysexArenaEnd = 0;
 	startPosition = 0;
-	endPosition = 0;
+	storeRelease(endPosition, 0);
 }
 
-bool MidiEventQueue::pushShortMessage(Bit32u shortMessageData, Bit32u timestamp) {
-	unsigned int newEndPosition = (endPosition + 1) % ringBufferSize;
-	// Is ring buffer full?
-	if (startPosition == newEndPosition) return false;
-	ringBuffer[endPosition].setShortMessage(shortMessageData, timestamp);
-	endPosition = newEndPosition;
-	return true;
+// Allocates a chunk in the arena for the sysex data. Returns NULL if the arena lacks the contiguous free space.
+Bit8u *MidiEventQueue::allocateSysexData(Bit32u sysexLength) {
+	Bit32u chunkSize = getSysexChunkSize(sysexLength);
+	if (sysexLength > sysexArenaMask || chunkSize > sysexArenaMask + 1) return NULL;
+	for (;;) {
+		Bit32u start = loadAcquire(sysexArenaStart);
+		Bit32u end = loadAcquire(sysexArenaEnd);
+		Bit32u offset = end & sysexArenaMask;
+		// The data must be contiguous, so the remainder of the arena is skipped as a padding chunk if it is too short
+		Bit32u paddingSize = (sysexArenaMask + 1 - offset < chunkSize) ? sysexArenaMask + 1 - offset : 0;
+		if (end - start + paddingSize + chunkSize > sysexArenaMask + 1) return NULL;
+		if (compareAndSwap(sysexArenaEnd, end, end + paddingSize + chunkSize)) {
+			if (paddingSize > 0) {
+				storeRelease(sysexArena[offset / sizeof(Bit32u)], paddingSize | SYSEX_CHUNK_FREED);
+				offset = 0;
+			}
+			return (Bit8u *)&sysexArena[offset / sizeof(Bit32u) + 1];
+		}
+	}
 }
 
-bool MidiEventQueue::pushSysex(const Bit8u *sysexData, Bit32u sysexLength, Bit32u timestamp) {
-	unsigned int newEndPosition = (endPosition + 1) % ringBufferSize;
-	// Is ring buffer full?
-	if (startPosition == newEndPosition) return false;
-	ringBuffer[endPosition].setSysex(sysexData, sysexLength, timestamp);
-	endPosition = newEndPosition;
-	return true;
+// Marks the chunk that contains the sysex data free. It is released later by the reader.
+void MidiEventQueue::freeSysexData(const Bit8u *sysexData, Bit32u sysexLength) {
+	volatile Bit32u *header = (Bit32u *)sysexData - 1;
+	storeRelease(*header, getSysexChunkSize(sysexLength) | SYSEX_CHUNK_FREED);
+}
+
+// Releases the freed chunks at the start of the arena. Only called by the reader.
+void MidiEventQueue::reclaimSysexArena() {
+	Bit32u start = sysexArenaStart;
+	Bit32u end = loadAcquire(sysexArenaEnd);
+	while (start != end) {
+		Bit32u *header = &sysexArena[(start & sysexArenaMask) / sizeof(Bit32u)];
+		Bit32u headerValue = loadAcquire(*header);
+		if ((headerValue & SYSEX_CHUNK_FREED) == 0) break;
+		Bit32u chunkSize = headerValue & ~SYSEX_CHUNK_FREED;
+		// Any word of the chunk may become a header of a new chunk, so it must be zero when reused
+		memset(header, 0, chunkSize);
+		start += chunkSize;
+		storeRelease(sysexArenaStart, start);
+	}
+}
+
+bool MidiEventQueue::pushShortMessage(Bit32u shortMessageData, Bit64u timestamp) {
+	for (;;) {
+		Bit32u position = loadAcquire(endPosition);
+		Slot &slot = ringBuffer[position & ringBufferMask];
+		Bit32s sequenceDelta = Bit32s(loadAcquire(slot.sequenceNumber) - position);
+		// Is ring buffer full?
+		if (sequenceDelta < 0) return false;
+		// Otherwise, retry if another writer has just claimed the slot
+		if (sequenceDelta == 0 && compareAndSwap(endPosition, position, position + 1)) {
+			slot.event.setShortMessage(shortMessageData, timestamp);
+			storeRelease(slot.sequenceNumber, position + 1);
+			return true;
+		}
+	}
+}
+
+bool MidiEventQueue::pushSysex(const Bit8u *sysexData, Bit32u sysexLength, Bit64u timestamp) {
+	Bit8u *dstSysexData = allocateSysexData(sysexLength);
+	if (dstSysexData == NULL) return false;
+	memcpy(dstSysexData, sysexData, sysexLength);
+	for (;;) {
+		Bit32u position = loadAcquire(endPosition);
+		Slot &slot = ringBuffer[position & ringBufferMask];
+		Bit32s sequenceDelta = Bit32s(loadAcquire(slot.sequenceNumber) - position);
+		if (sequenceDelta < 0) {
+			freeSysexData(dstSysexData, sysexLength);
+			return false;
+		}
+		if (sequenceDelta == 0 && compareAndSwap(endPosition, position, position + 1)) {
+			slot.event.setSysex(dstSysexData, sysexLength, timestamp);
+			storeRelease(slot.sequenceNumber, position + 1);
+			return true;
+		}
+	}
 }
 
 const MidiEvent *MidiEventQueue::peekMidiEvent() {
-	return (startPosition == endPosition) ? NULL : &ringBuffer[startPosition];
+	Slot &slot = ringBuffer[startPosition & ringBufferMask];
+	if (loadAcquire(slot.sequenceNumber) == startPosition + 1) return &slot.event;
+	// The writers may have freed the chunks they failed to enqueue, which would otherwise clog the arena
+	reclaimSysexArena();
+	return NULL;
 }
 
 void MidiEventQueue::dropMidiEvent() {
+	Slot &slot = ringBuffer[startPosition & ringBufferMask];
 	// Is ring buffer empty?
-	if (startPosition != endPosition) {
-		startPosition = (startPosition + 1) % ringBufferSize;
+	if (loadAcquire(slot.sequenceNumber) != startPosition + 1) return;
+	if (slot.event.sysexData != NULL) {
+		freeSysexData(slot.event.sysexData, slot.event.sysexLength);
+	}
+	storeRelease(slot.sequenceNumber, startPosition + ringBufferMask + 1);
+	startPosition++;
+	reclaimSysexArena();
+}
+
+// Mixes the rendered streams down to an output sample, converting the samples if necessary
+static inline void mixStreams(Bit16s &target, const Bit16s nonReverb, const Bit16s reverbDry, const Bit16s reverbWet) {
+	target = Synth::clipBit16s((Bit32s)nonReverb + (Bit32s)reverbDry + (Bit32s)reverbWet);
+}
+
+static inline void mixStreams(float &target, const Bit16s nonReverb, const Bit16s reverbDry, const Bit16s reverbWet) {
+	target = ((Bit32s)nonReverb + (Bit32s)reverbDry + (Bit32s)reverbWet) / 16384.0f;
+}
+
+static inline void mixStreams(Bit16s &target, const float nonReverb, const float reverbDry, const float reverbWet) {
+	target = Synth::convertSample(nonReverb + reverbDry + reverbWet);
+}
+
+static inline void mixStreams(float &target, const float nonReverb, const float reverbDry, const float reverbWet) {
+	target = nonReverb + reverbDry + reverbWet;
+}
+
+template <class Sample, class OutSample>
+static inline void convertStream(OutSample *target, const Sample *source, Bit32u len) {
+	if (target == NULL) return;
+	while (len--) {
+		*(target++) = Synth::convertSample(*(source++));
+	}
+}
+
+template <class Sample>
+static inline Sample *getTempStream(const void *outStream, Sample *tmpBuf) {
+	return outStream == NULL ? NULL : tmpBuf;
+}
+
+void Synth::render(Bit16s *stream, Bit32u len) {
+	render(stream, stream + 1, 2, len);
+}
+
+void Synth::render(float *stream, Bit32u len) {
+	render(stream, stream + 1, 2, len);
+}
+
+void Synth::render(Bit16s *leftStream, Bit16s *rightStream, Bit32u stride, Bit32u len) {
+	if (rendererType == RendererType_FLOAT) {
+		doRender<float>(leftStream, rightStream, stride, len);
+	} else {
+		doRender<Bit16s>(leftStream, rightStream, stride, len);
+	}
+}
+
+void Synth::render(float *leftStream, float *rightStream, Bit32u stride, Bit32u len) {
+	if (rendererType == RendererType_FLOAT) {
+		doRender<float>(leftStream, rightStream, stride, len);
+	} else {
+		doRender<Bit16s>(leftStream, rightStream, stride, len);
+	}
+}
+
+template <class Sample, class OutSample>
+void Synth::doRender(OutSample *leftStream, OutSample *rightStream, Bit32u stride, Bit32u len) {
+	Sample *nonReverbLeft = static_cast<Sample *>(mixBuffers);
+	Sample *nonReverbRight = nonReverbLeft + MAX_SAMPLES_PER_RUN;
+	Sample *reverbDryLeft = nonReverbRight + MAX_SAMPLES_PER_RUN;
+	Sample *reverbDryRight = reverbDryLeft + MAX_SAMPLES_PER_RUN;
+	Sample *reverbWetLeft = reverbDryRight + MAX_SAMPLES_PER_RUN;
+	Sample *reverbWetRight = reverbWetLeft + MAX_SAMPLES_PER_RUN;
+
+	while (len > 0) {
+		Bit32u thisLen = len > MAX_SAMPLES_PER_RUN ? MAX_SAMPLES_PER_RUN : len;
+		renderStreamsNatively(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, thisLen);
+		for (Bit32u i = 0; i < thisLen; i++) {
+			mixStreams(*leftStream, nonReverbLeft[i], reverbDryLeft[i], reverbWetLeft[i]);
+			mixStreams(*rightStream, nonReverbRight[i], reverbDryRight[i], reverbWetRight[i]);
+			leftStream += stride;
+			rightStream += stride;
+		}
+		len -= thisLen;
+	}
+}
+
+void Synth::renderStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u len) {
+	if (rendererType == RendererType_FLOAT) {
+		renderAndConvertStreams<float>(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
+	} else {
+		renderStreamsNatively(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
+	}
+}
+
+void Synth::renderStreams(float *nonReverbLeft, float *nonReverbRight, float *reverbDryLeft, float *reverbDryRight, float *reverbWetLeft, float *reverbWetRight, Bit32u len) {
+	if (rendererType == RendererType_FLOAT) {
+		renderStreamsNatively(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
+	} else {
+		renderAndConvertStreams<Bit16s>(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
 	}
 }
 
-void Synth::render(Sample *stream, Bit32u len) {
+template <class Sample, class OutSample>
+void Synth::renderAndConvertStreams(OutSample *nonReverbLeft, OutSample *nonReverbRight, OutSample *reverbDryLeft, OutSample *reverbDryRight, OutSample *reverbWetLeft, OutSample *reverbWetRight, Bit32u len) {
 	Sample tmpNonReverbLeft[MAX_SAMPLES_PER_RUN];
 	Sample tmpNonReverbRight[MAX_SAMPLES_PER_RUN];
 	Sample tmpReverbDryLeft[MAX_SAMPLES_PER_RUN];
@@ -1426,47 +1867,141 @@ void Synth::render(Sample *stream, Bit32u len) {
 
 	while (len > 0) {
 		Bit32u thisLen = len > MAX_SAMPLES_PER_RUN ? MAX_SAMPLES_PER_RUN : len;
-		renderStreams(tmpNonReverbLeft, tmpNonReverbRight, tmpReverbDryLeft, tmpReverbDryRight, tmpReverbWetLeft, tmpReverbWetRight, thisLen);
-		for (Bit32u i = 0; i < thisLen; i++) {
-#if MT32EMU_USE_FLOAT_SAMPLES
-			*(stream++) = tmpNonReverbLeft[i] + tmpReverbDryLeft[i] + tmpReverbWetLeft[i];
-			*(stream++) = tmpNonReverbRight[i] + tmpReverbDryRight[i] + tmpReverbWetRight[i];
-#else
-			*(stream++) = clipBit16s((Bit32s)tmpNonReverbLeft[i] + (Bit32s)tmpReverbDryLeft[i] + (Bit32s)tmpReverbWetLeft[i]);
-			*(stream++) = clipBit16s((Bit32s)tmpNonReverbRight[i] + (Bit32s)tmpReverbDryRight[i] + (Bit32s)tmpReverbWetRight[i]);
-#endif
-		}
+		// Omitted streams are passed on as NULL to avoid the needless processing
+		renderStreamsNatively(getTempStream(nonReverbLeft, tmpNonReverbLeft), getTempStream(nonReverbRight, tmpNonReverbRight),
+			getTempStream(reverbDryLeft, tmpReverbDryLeft), getTempStream(reverbDryRight, tmpReverbDryRight),
+			getTempStream(reverbWetLeft, tmpReverbWetLeft), getTempStream(reverbWetRight, tmpReverbWetRight), thisLen);
+		convertStream(nonReverbLeft, tmpNonReverbLeft, thisLen);
+		convertStream(nonReverbRight, tmpNonReverbRight, thisLen);
+		convertStream(reverbDryLeft, tmpReverbDryLeft, thisLen);
+		convertStream(reverbDryRight, tmpReverbDryRight, thisLen);
+		convertStream(reverbWetLeft, tmpReverbWetLeft, thisLen);
+		convertStream(reverbWetRight, tmpReverbWetRight, thisLen);
+		advanceStreamPosition(nonReverbLeft, thisLen);
+		advanceStreamPosition(nonReverbRight, thisLen);
+		advanceStreamPosition(reverbDryLeft, thisLen);
+		advanceStreamPosition(reverbDryRight, thisLen);
+		advanceStreamPosition(reverbWetLeft, thisLen);
+		advanceStreamPosition(reverbWetRight, thisLen);
 		len -= thisLen;
 	}
 }
 
-void Synth::renderStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len) {
+// Plays all the MIDI events that are due, so that the following run can be as long as possible.
+// Stops before an event which would terminate a note started within the same batch, so that the note plays at least one sample.
+// Also stops when a poly starts aborting, leaving the event that caused it in the queue.
+void Synth::playDueMIDIEvents() {
+	static const unsigned int MAX_STARTED_NOTES = 32;
+	// Each entry combines the part number and the key of a note started within the batch
+	Bit16u startedNotes[MAX_STARTED_NOTES];
+	unsigned int startedNoteCount = 0;
+	for (;;) {
+		const MidiEvent *nextEvent = midiQueue->peekMidiEvent();
+		if (nextEvent == NULL || nextEvent->timestamp > renderedSampleCount) {
+			return;
+		}
+		if (nextEvent->sysexData != NULL) {
+			// Sysex may reset the synth, so it is never batched with the notes started
+			if (startedNoteCount > 0) {
+				return;
+			}
+			playSysexNow(nextEvent->sysexData, nextEvent->sysexLength);
+			midiQueue->dropMidiEvent();
+			MT32EMU_RENDER_STATISTICS(renderStatistics.dispatchedEventCount++);
+			continue;
+		}
+		Bit32u msg = nextEvent->shortMessageData;
+		unsigned char code = (unsigned char)((msg & 0x0000F0) >> 4);
+		unsigned char note = (unsigned char)((msg & 0x007F00) >> 8);
+		unsigned char velocity = (unsigned char)((msg & 0x7F0000) >> 16);
+		char part = chantable[msg & 0x00000F];
+		bool startsNote = false;
+		if (part >= 0 && part <= 8 && startedNoteCount > 0) {
+			bool endsNotes = false;
+			bool endsAllNotes = false;
+			if (code == 0x8 || code == 0x9) {
+				// A repeated note-on may also cut the note off
+				endsNotes = true;
+			} else if (code == 0xB) {
+				// All notes off and the channel mode messages which imply it
+				endsAllNotes = note >= 0x7B;
+			}
+			for (unsigned int i = 0; i < startedNoteCount; i++) {
+				if ((startedNotes[i] >> 7) == Bit16u(part) && (endsAllNotes || (endsNotes && (startedNotes[i] & 0x7F) == note))) {
+					return;
+				}
+			}
+		}
+		if (code == 0x9 && velocity > 0 && part >= 0 && part <= 8) {
+			if (startedNoteCount == MAX_STARTED_NOTES) {
+				return;
+			}
+			startsNote = true;
+		}
+		playMsgNow(msg);
+		// If a poly is aborting we don't drop the event from the queue.
+		// Instead, we'll return to it again when the abortion is done.
+		if (isAbortingPoly()) {
+			return;
+		}
+		midiQueue->dropMidiEvent();
+		MT32EMU_RENDER_STATISTICS(renderStatistics.dispatchedEventCount++);
+		if (startsNote) {
+			startedNotes[startedNoteCount++] = Bit16u((part << 7) | note);
+		}
+	}
+}
+
+template <class Sample>
+void Synth::renderStreamsNatively(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len) {
+#if MT32EMU_COLLECT_RENDER_STATISTICS
+	// The reset is performed by the rendering thread, so that the statistics are never updated concurrently
+	if (compareAndSwap(renderStatisticsResetRequested, 1, 0)) {
+		memset(&renderStatistics, 0, sizeof(renderStatistics));
+	}
+	const Bit64u startTime = getNanoTime();
+	Bit64u stageStartTime = startTime;
+#endif
+	Bit32u maxRunLength = MAX_SAMPLES_PER_RUN;
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	// The wet output of a run must be complete before the pipeline delays the dry streams any further
+	if (reverbPipeline != NULL && maxRunLength > PIPELINED_REVERB_LATENCY) {
+		maxRunLength = PIPELINED_REVERB_LATENCY;
+	}
+#endif
 	while (len > 0) {
-		// We need to ensure zero-duration notes will play so add minimum 1-sample delay.
-		Bit32u thisLen = 1;
 		if (!isAbortingPoly()) {
+			playDueMIDIEvents();
+			MT32EMU_RENDER_STATISTICS(endRenderStage(renderStatistics.eventDispatchTime, stageStartTime));
+		}
+		Bit32u thisLen = 1;
+		bool prerendered = false;
+		if (isAbortingPoly()) {
+			// The pending events are processed as soon as the aborting poly becomes inactive.
+			// Rather than rendering sample by sample until then, find out the length of the run that ends right at that point.
+			thisLen = partialManager->prerenderAbortingPoly(abortingPoly, len > maxRunLength ? maxRunLength : len);
+			prerendered = true;
+		} else {
 			const MidiEvent *nextEvent = midiQueue->peekMidiEvent();
-			Bit32s samplesToNextEvent = (nextEvent != NULL) ? Bit32s(nextEvent->timestamp - renderedSampleCount) : MAX_SAMPLES_PER_RUN;
+			Bit64s samplesToNextEvent = (nextEvent != NULL) ? Bit64s(nextEvent->timestamp - renderedSampleCount) : maxRunLength;
+			// If an event is still due, it terminates a note just started, so we need to ensure zero-duration notes will play.
+			// Thus, a 1-sample delay is added.
 			if (samplesToNextEvent > 0) {
-				thisLen = len > MAX_SAMPLES_PER_RUN ? MAX_SAMPLES_PER_RUN : len;
-				if (thisLen > (Bit32u)samplesToNextEvent) {
-					thisLen = samplesToNextEvent;
-				}
-			} else {
-				if (nextEvent->sysexData == NULL) {
-					playMsgNow(nextEvent->shortMessageData);
-					// If a poly is aborting we don't drop the event from the queue.
-					// Instead, we'll return to it again when the abortion is done.
-					if (!isAbortingPoly()) {
-						midiQueue->dropMidiEvent();
-					}
-				} else {
-					playSysexNow(nextEvent->sysexData, nextEvent->sysexLength);
-					midiQueue->dropMidiEvent();
+				thisLen = len > maxRunLength ? maxRunLength : len;
+				if (Bit64s(thisLen) > samplesToNextEvent) {
+					thisLen = Bit32u(samplesToNextEvent);
 				}
 			}
 		}
 		doRenderStreams(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, thisLen);
+		if (prerendered) {
+			partialManager->completeAbortingPolyPrerender();
+		}
+#if MT32EMU_COLLECT_RENDER_STATISTICS
+		stageStartTime = getNanoTime();
+		renderStatistics.runCount++;
+		if (thisLen == 1) renderStatistics.singleSampleRunCount++;
+#endif
 		advanceStreamPosition(nonReverbLeft, thisLen);
 		advanceStreamPosition(nonReverbRight, thisLen);
 		advanceStreamPosition(reverbDryLeft, thisLen);
@@ -1475,12 +2010,123 @@ void Synth::renderStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sample
 		advanceStreamPosition(reverbWetRight, thisLen);
 		len -= thisLen;
 	}
+#if MT32EMU_COLLECT_RENDER_STATISTICS
+	Bit64u renderCallTime = getNanoTime() - startTime;
+	renderStatistics.renderCallCount++;
+	renderStatistics.totalTime += renderCallTime;
+	if (renderStatistics.peakRenderCallTime < renderCallTime) renderStatistics.peakRenderCallTime = renderCallTime;
+	publishRenderStatistics();
+#endif
+}
+
+void Synth::publishRenderStatistics() {
+	const unsigned int wordCount = sizeof(publishedRenderStatistics) / sizeof(Bit32u);
+	Bit32u words[wordCount];
+	memcpy(words, &renderStatistics, sizeof(renderStatistics));
+	Bit32u sequence = renderStatisticsSequence;
+	storeRelease(renderStatisticsSequence, sequence + 1);
+	memoryFence();
+	for (unsigned int i = 0; i < wordCount; i++) {
+		storeRelaxed(publishedRenderStatistics[i], words[i]);
+	}
+	storeRelease(renderStatisticsSequence, sequence + 2);
+}
+
+bool Synth::getRenderStatistics(RenderStatistics &statistics) const {
+#if MT32EMU_COLLECT_RENDER_STATISTICS
+	// The copy is retried if it overlaps with publishing. Publishing takes a short while, so this hardly ever spins.
+	const unsigned int wordCount = sizeof(publishedRenderStatistics) / sizeof(Bit32u);
+	Bit32u words[wordCount];
+	for (;;) {
+		Bit32u sequence = loadAcquire(renderStatisticsSequence);
+		if ((sequence & 1) != 0) continue;
+		for (unsigned int i = 0; i < wordCount; i++) {
+			words[i] = loadRelaxed(publishedRenderStatistics[i]);
+		}
+		memoryFence();
+		if (loadAcquire(renderStatisticsSequence) == sequence) break;
+	}
+	memcpy(&statistics, words, sizeof(statistics));
+	return true;
+#else
+	memset(&statistics, 0, sizeof(statistics));
+	return false;
+#endif
+}
+
+void Synth::resetRenderStatistics() {
+	storeRelease(renderStatisticsResetRequested, 1);
+}
+
+static inline void incrementCounter(Bit32u &counter) {
+	storeRelaxed(counter, counter + 1);
+}
+
+// Invoked by the partial manager in the thread which processes the MIDI events
+void Synth::partialAllocationEventOccurred(const PartialAllocationEvent &event) {
+	PartialAllocationStatistics &statistics = partialAllocationStatistics;
+	switch (event.type) {
+		case PartialAllocationEventType_POLY_ABORTED:
+			if (event.polyState == POLY_Releasing) {
+				incrementCounter(statistics.abortedReleasingPolyCount[event.partNum]);
+			} else if (event.polyState == POLY_Held) {
+				incrementCounter(statistics.abortedHeldPolyCount[event.partNum]);
+			} else {
+				incrementCounter(statistics.abortedPlayingPolyCount[event.partNum]);
+			}
+			break;
+		case PartialAllocationEventType_RESERVE_EXCEEDED:
+			incrementCounter(statistics.reserveExceededCount[event.partNum]);
+			break;
+		case PartialAllocationEventType_ALLOCATION_FAILED:
+			incrementCounter(statistics.allocationFailureCount[event.partNum]);
+			break;
+	}
+	if (partialAllocationEventLog == NULL) return;
+	Bit32u end = partialAllocationEventLogEnd;
+	if (end - loadAcquire(partialAllocationEventLogStart) > partialAllocationEventLogMask) {
+		incrementCounter(statistics.droppedEventCount);
+		return;
+	}
+	partialAllocationEventLog[end & partialAllocationEventLogMask] = event;
+	storeRelease(partialAllocationEventLogEnd, end + 1);
+}
+
+void Synth::getPartialAllocationStatistics(PartialAllocationStatistics &statistics) const {
+	// The structure consists of words only
+	const Bit32u *counters = (const Bit32u *)&partialAllocationStatistics;
+	Bit32u *snapshot = (Bit32u *)&statistics;
+	for (unsigned int i = 0; i < sizeof(PartialAllocationStatistics) / sizeof(Bit32u); i++) {
+		snapshot[i] = loadRelaxed(counters[i]);
+	}
+}
+
+void Synth::setPartialAllocationEventLogSize(Bit32u size) {
+	// Keeps the rounding within the range of Bit32u
+	static const Bit32u MAX_PARTIAL_ALLOCATION_EVENT_LOG_SIZE = 0x100000;
+	if (size > MAX_PARTIAL_ALLOCATION_EVENT_LOG_SIZE) {
+		size = MAX_PARTIAL_ALLOCATION_EVENT_LOG_SIZE;
+	}
+	partialAllocationEventLogSize = size > 0 ? roundUpToPowerOfTwo(size) : 0;
+}
+
+Bit32u Synth::readPartialAllocationEvents(PartialAllocationEvent *events, Bit32u maxCount) {
+	if (partialAllocationEventLog == NULL) return 0;
+	Bit32u start = partialAllocationEventLogStart;
+	Bit32u count = loadAcquire(partialAllocationEventLogEnd) - start;
+	if (count > maxCount) {
+		count = maxCount;
+	}
+	for (Bit32u i = 0; i < count; i++) {
+		events[i] = partialAllocationEventLog[(start + i) & partialAllocationEventLogMask];
+	}
+	storeRelease(partialAllocationEventLogStart, start + count);
+	return count;
 }
 
 // In GENERATION2 units, the output from LA32 goes to the Boss chip already bit-shifted.
 // In NICE mode, it's also better to increase volume before the reverb processing to preserve accuracy.
-void Synth::produceLA32Output(Sample *buffer, Bit32u len) {
-#if !MT32EMU_USE_FLOAT_SAMPLES
+void Synth::produceLA32Output(Bit16s *buffer, Bit32u len) {
 	switch (dacInputMode) {
 		case DACInputMode_GENERATION2:
 			while (len--) {
@@ -1497,19 +2143,16 @@ void Synth::produceLA32Output(Sample *buffer, Bit32u len) {
 		default:
 			break;
 	}
-#endif
 }
 
-void Synth::convertSamplesToOutput(Sample *buffer, Bit32u len, bool reverb) {
+void Synth::produceLA32Output(float *, Bit32u) {
+	// The float renderer doesn't emulate the DAC input hacks, and the volume needs no boost
+}
+
+void Synth::convertSamplesToOutput(Bit16s *buffer, Bit32u len, bool reverb) {
 	if (dacInputMode == DACInputMode_PURE) return;
 
-#if MT32EMU_USE_FLOAT_SAMPLES
-	float gain = reverb ? reverbOutputGain * CM32L_REVERB_TO_LA32_ANALOG_OUTPUT_GAIN_FACTOR : outputGain;
-	while (len--) {
-		*(buffer++) *= gain;
-	}
-#else
-	int gain = reverb ? int(reverbOutputGain * CM32L_REVERB_TO_LA32_ANALOG_OUTPUT_GAIN_FACTOR) : outputGain;
+	int gain = reverb ? int(intReverbOutputGain * CM32L_REVERB_TO_LA32_ANALOG_OUTPUT_GAIN_FACTOR) : intOutputGain;
 	if (dacInputMode == DACInputMode_GENERATION1) {
 		while (len--) {
 			Bit32s target = Bit16s((*buffer & 0x8000) | ((*buffer << 1) & 0x7FFE));
@@ -1521,10 +2164,42 @@ void Synth::convertSamplesToOutput(Sample *buffer, Bit32u len, bool reverb) {
 		*buffer = clipBit16s((Bit32s(*buffer) * gain) >> 8);
 		++buffer;
 	}
-#endif
 }
 
+void Synth::convertSamplesToOutput(float *buffer, Bit32u len, bool reverb) {
+	if (dacInputMode == DACInputMode_PURE) return;
+
+	float gain = reverb ? reverbOutputGain * CM32L_REVERB_TO_LA32_ANALOG_OUTPUT_GAIN_FACTOR : outputGain;
+	while (len--) {
+		*(buffer++) *= gain;
+	}
+}
+
+template <class Sample>
 void Synth::doRenderStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len) {
+	// While idle, the output is silent anyway. So, the partials and the reverb model aren't even visited,
+	// and whatever inaudible residue is left in the reverb buffers is kept intact until the next note.
+	if (!isEnabled || !isActive()) {
+		muteSampleBuffer(nonReverbLeft, len);
+		muteSampleBuffer(nonReverbRight, len);
+		muteSampleBuffer(reverbDryLeft, len);
+		muteSampleBuffer(reverbDryRight, len);
+		muteSampleBuffer(reverbWetLeft, len);
+		muteSampleBuffer(reverbWetRight, len);
+		storeRelease(renderedSampleCount, renderedSampleCount + len);
+		return;
+	}
+
+	MT32EMU_RENDER_STATISTICS(Bit64u stageStartTime = getNanoTime());
+#if MT32EMU_COLLECT_RENDER_STATISTICS
+	unsigned int activePartialCount = partialManager->getActivePartialCount();
+	if (renderStatistics.peakActivePartialCount < activePartialCount) renderStatistics.peakActivePartialCount = activePartialCount;
+#endif
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	// Checked before rendering, since the partials may get deactivated during the run
+	const bool dryActive = hasActivePartials();
+#endif
+
 	// Even if LA32 output isn't desired, we proceed anyway with temp buffers
 	Sample tmpBufNonReverbLeft[MAX_SAMPLES_PER_RUN], tmpBufNonReverbRight[MAX_SAMPLES_PER_RUN];
 	if (nonReverbLeft == NULL) nonReverbLeft = tmpBufNonReverbLeft;
@@ -1539,45 +2214,69 @@ void Synth::doRenderStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sampl
 	muteSampleBuffer(reverbDryLeft, len);
 	muteSampleBuffer(reverbDryRight, len);
 
-	if (isEnabled) {
-		for (unsigned int i = 0; i < getPartialCount(); i++) {
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	if (partialRenderPool != NULL) {
+		partialRenderPool->produceOutput(nonReverbLeft, nonReverbRight, reverbDryLeft, reverbDryRight, len);
+	} else
+#endif
+	{
+		for (unsigned int i = partialManager->findNextActivePartial(0); i < getPartialCount(); i = partialManager->findNextActivePartial(i + 1)) {
 			if (partialManager->shouldReverb(i)) {
 				partialManager->produceOutput(i, reverbDryLeft, reverbDryRight, len);
 			} else {
 				partialManager->produceOutput(i, nonReverbLeft, nonReverbRight, len);
 			}
 		}
+	}
 
-		produceLA32Output(reverbDryLeft, len);
-		produceLA32Output(reverbDryRight, len);
+	MT32EMU_RENDER_STATISTICS(endRenderStage(renderStatistics.partialRenderTime, stageStartTime));
 
-		if (isReverbEnabled()) {
-			reverbModel->process(reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
-			if (reverbWetLeft != NULL) convertSamplesToOutput(reverbWetLeft, len, true);
-			if (reverbWetRight != NULL) convertSamplesToOutput(reverbWetRight, len, true);
-		} else {
-			muteSampleBuffer(reverbWetLeft, len);
-			muteSampleBuffer(reverbWetRight, len);
-		}
+	produceLA32Output(reverbDryLeft, len);
+	produceLA32Output(reverbDryRight, len);
 
-		// Don't bother with conversion if the output is going to be unused
-		if (nonReverbLeft != tmpBufNonReverbLeft) {
-			produceLA32Output(nonReverbLeft, len);
-			convertSamplesToOutput(nonReverbLeft, len, false);
-		}
-		if (nonReverbRight != tmpBufNonReverbRight) {
-			produceLA32Output(nonReverbRight, len);
-			convertSamplesToOutput(nonReverbRight, len, false);
-		}
-		if (reverbDryLeft != tmpBufReverbDryLeft) convertSamplesToOutput(reverbDryLeft, len, false);
-		if (reverbDryRight != tmpBufReverbDryRight) convertSamplesToOutput(reverbDryRight, len, false);
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	if (reverbPipeline != NULL) {
+		MT32EMU_RENDER_STATISTICS(endRenderStage(renderStatistics.dacConversionTime, stageStartTime));
+		reverbPipeline->processReverb(reverbModel, dryActive, reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
+		MT32EMU_RENDER_STATISTICS(endRenderStage(renderStatistics.reverbTime, stageStartTime));
+		if (reverbWetLeft != NULL) convertSamplesToOutput(reverbWetLeft, len, true);
+		if (reverbWetRight != NULL) convertSamplesToOutput(reverbWetRight, len, true);
+	} else
+#endif
+	if (isReverbEnabled()) {
+		MT32EMU_RENDER_STATISTICS(endRenderStage(renderStatistics.dacConversionTime, stageStartTime));
+		reverbModel->process(reverbDryLeft, reverbDryRight, reverbWetLeft, reverbWetRight, len);
+		MT32EMU_RENDER_STATISTICS(endRenderStage(renderStatistics.reverbTime, stageStartTime));
+		if (reverbWetLeft != NULL) convertSamplesToOutput(reverbWetLeft, len, true);
+		if (reverbWetRight != NULL) convertSamplesToOutput(reverbWetRight, len, true);
 	} else {
 		muteSampleBuffer(reverbWetLeft, len);
 		muteSampleBuffer(reverbWetRight, len);
 	}
 
+	// Don't bother with conversion if the output is going to be unused
+	if (nonReverbLeft != tmpBufNonReverbLeft) {
+		produceLA32Output(nonReverbLeft, len);
+		convertSamplesToOutput(nonReverbLeft, len, false);
+	}
+	if (nonReverbRight != tmpBufNonReverbRight) {
+		produceLA32Output(nonReverbRight, len);
+		convertSamplesToOutput(nonReverbRight, len, false);
+	}
+	if (reverbDryLeft != tmpBufReverbDryLeft) convertSamplesToOutput(reverbDryLeft, len, false);
+	if (reverbDryRight != tmpBufReverbDryRight) convertSamplesToOutput(reverbDryRight, len, false);
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	if (reverbPipeline != NULL) {
+		reverbPipeline->delayDryStreams(nonReverbLeft != tmpBufNonReverbLeft ? nonReverbLeft : NULL,
+			nonReverbRight != tmpBufNonReverbRight ? nonReverbRight : NULL,
+			reverbDryLeft != tmpBufReverbDryLeft ? reverbDryLeft : NULL,
+			reverbDryRight != tmpBufReverbDryRight ? reverbDryRight : NULL, len);
+	}
+#endif
+	MT32EMU_RENDER_STATISTICS(endRenderStage(renderStatistics.dacConversionTime, stageStartTime));
+
 	partialManager->clearAlreadyOutputed();
-	renderedSampleCount += len;
+	storeRelease(renderedSampleCount, renderedSampleCount + len);
 }
 
 void Synth::printPartialUsage(unsigned long sampleOffset) {
@@ -1591,12 +2290,7 @@ void Synth::printPartialUsage(unsigned long sampleOffset) {
 }
 
 bool Synth::hasActivePartials() const {
-	for (unsigned int partialNum = 0; partialNum < getPartialCount(); partialNum++) {
-		if (partialManager->getPartial(partialNum)->isActive()) {
-			return true;
-		}
-	}
-	return false;
+	return partialManager->getActivePartialCount() > 0;
 }
 
 bool Synth::isAbortingPoly() const {
@@ -1607,6 +2301,12 @@ bool Synth::isActive() const {
 	if (hasActivePartials()) {
 		return true;
 	}
+#if MT32EMU_USE_PARTIAL_RENDER_THREADS
+	// The reverb model is busy on the reverb thread, so the pipeline keeps track of its activity
+	if (reverbPipeline != NULL) {
+		return reverbPipeline->isActive();
+	}
+#endif
 	if (isReverbEnabled()) {
 		return reverbModel->isActive();
 	}
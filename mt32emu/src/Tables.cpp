@@ -15,82 +15,18 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <cmath>
-#include <cstdlib>
-#include <cstring>
-
 #include "mt32emu.h"
-#include "mmath.h"
 
 namespace MT32Emu {
 
+// The constructor doesn't touch any data, so the instance is usable even during the static initialisation of other modules.
+const Tables Tables::instance;
+
 const Tables &Tables::getInstance() {
-	static const Tables instance;
 	return instance;
 }
 
-Tables::Tables() {
-	int lf;
-	for (lf = 0; lf <= 100; lf++) {
-		// CONFIRMED:KG: This matches a ROM table found by Mok
-		float fVal = (2.0f - LOG10F((float)lf + 1.0f)) * 128.0f;
-		int val = (int)(fVal + 1.0);
-		if (val > 255) {
-			val = 255;
-		}
-		levelToAmpSubtraction[lf] = (Bit8u)val;
-	}
-
-	envLogarithmicTime[0] = 64;
-	for (lf = 1; lf <= 255; lf++) {
-		// CONFIRMED:KG: This matches a ROM table found by Mok
-		envLogarithmicTime[lf] = (Bit8u)ceil(64.0f + LOG2F((float)lf) * 8.0f);
-	}
-
-#ifdef EMULATE_LAPC_I // Dummy #ifdef - we'll have runtime emulation mode selection in future.
-	// CONFIRMED: Based on a table found by Mok in the LAPC-I control ROM
-	// Note that this matches the MT-32 table, but with the values clamped to a maximum of 8.
-	memset(masterVolToAmpSubtraction, 8, 71);
-	memset(masterVolToAmpSubtraction + 71, 7, 3);
-	memset(masterVolToAmpSubtraction + 74, 6, 4);
-	memset(masterVolToAmpSubtraction + 78, 5, 3);
-	memset(masterVolToAmpSubtraction + 81, 4, 4);
-	memset(masterVolToAmpSubtraction + 85, 3, 3);
-	memset(masterVolToAmpSubtraction + 88, 2, 4);
-	memset(masterVolToAmpSubtraction + 92, 1, 4);
-	memset(masterVolToAmpSubtraction + 96, 0, 5);
-#else
-	// CONFIRMED: Based on a table found by Mok in the MT-32 control ROM
-	masterVolToAmpSubtraction[0] = 255;
-	for (int masterVol = 1; masterVol <= 100; masterVol++) {
-		masterVolToAmpSubtraction[masterVol] = (int)(106.31 - 16.0f * LOG2F((float)masterVol));
-	}
-#endif
-
-	for (int i = 0; i <= 100; i++) {
-		pulseWidth100To255[i] = (int)(i * 255 / 100.0f + 0.5f);
-		//synth->printDebug("%d: %d", i, pulseWidth100To255[i]);
-	}
-
-	// The LA32 chip contains an exponent table inside. The table contains 12-bit integer values.
-	// The actual table size is 512 rows. The 9 higher bits of the fractional part of the argument are used as a lookup address.
-	// To improve the precision of computations, the lower bits are supposed to be used for interpolation as the LA32 chip also
-	// contains another 512-row table with inverted differences between the main table values.
-	for (int i = 0; i < 512; i++) {
-		exp9[i] = Bit16u(8191.5f - EXP2F(13.0f + ~i / 512.0f));
-	}
-
-	// There is a logarithmic sine table inside the LA32 chip. The table contains 13-bit integer values.
-	for (int i = 1; i < 512; i++) {
-		logsin9[i] = Bit16u(0.5f - LOG2F(sin((i + 0.5f) / 1024.0f * FLOAT_PI)) * 1024.0f);
-	}
-
-	// The very first value is clamped to the maximum possible 13-bit integer
-	logsin9[0] = 8191;
-
-	// found from sample analysis
-	static const Bit8u resAmpDecayFactorTable[] = {31, 16, 12, 8, 5, 3, 2, 1};
-	resAmpDecayFactor = resAmpDecayFactorTable;
-}
+// found from sample analysis
+const Bit8u Tables::resAmpDecayFactor[8] = {31, 16, 12, 8, 5, 3, 2, 1};
 
 }
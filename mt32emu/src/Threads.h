@@ -0,0 +1,83 @@
+/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher
+ * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MT32EMU_THREADS_H
+#define MT32EMU_THREADS_H
+
+// Minimal portable wrappers of the threading primitives used by the concurrent renderers.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace MT32Emu {
+
+#ifdef _WIN32
+
+typedef HANDLE ThreadHandle;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Condition;
+
+static inline void initMutex(Mutex &mutex) { InitializeCriticalSection(&mutex); }
+static inline void destroyMutex(Mutex &mutex) { DeleteCriticalSection(&mutex); }
+static inline void lockMutex(Mutex &mutex) { EnterCriticalSection(&mutex); }
+static inline void unlockMutex(Mutex &mutex) { LeaveCriticalSection(&mutex); }
+static inline void initCondition(Condition &condition) { InitializeConditionVariable(&condition); }
+static inline void destroyCondition(Condition &) {}
+static inline void waitCondition(Condition &condition, Mutex &mutex) { SleepConditionVariableCS(&condition, &mutex, INFINITE); }
+static inline void broadcastCondition(Condition &condition) { WakeAllConditionVariable(&condition); }
+
+static inline bool startThread(ThreadHandle &thread, LPTHREAD_START_ROUTINE threadProc, void *arg) {
+	thread = CreateThread(NULL, 0, threadProc, arg, 0, NULL);
+	return thread != NULL;
+}
+
+static inline void joinThread(ThreadHandle &thread) {
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+#else
+
+typedef pthread_t ThreadHandle;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+
+static inline void initMutex(Mutex &mutex) { pthread_mutex_init(&mutex, NULL); }
+static inline void destroyMutex(Mutex &mutex) { pthread_mutex_destroy(&mutex); }
+static inline void lockMutex(Mutex &mutex) { pthread_mutex_lock(&mutex); }
+static inline void unlockMutex(Mutex &mutex) { pthread_mutex_unlock(&mutex); }
+static inline void initCondition(Condition &condition) { pthread_cond_init(&condition, NULL); }
+static inline void destroyCondition(Condition &condition) { pthread_cond_destroy(&condition); }
+static inline void waitCondition(Condition &condition, Mutex &mutex) { pthread_cond_wait(&condition, &mutex); }
+static inline void broadcastCondition(Condition &condition) { pthread_cond_broadcast(&condition); }
+
+static inline bool startThread(ThreadHandle &thread, void *(*threadProc)(void *), void *arg) {
+	return pthread_create(&thread, NULL, threadProc, arg) == 0;
+}
+
+static inline void joinThread(ThreadHandle &thread) {
+	pthread_join(thread, NULL);
+}
+
+#endif
+
+}
+
+#endif
@@ -25,44 +25,65 @@ class Part;
 class TVA;
 struct ControlROMPCMStruct;
 
+// Collects partials deactivated while being rendered concurrently, so that their polys can be notified later in a deterministic order.
+struct DeactivatedPartialList {
+	Partial **partials;
+	unsigned int count;
+};
+
 // A partial represents one of up to four waveform generators currently playing within a poly.
 class Partial {
 private:
-	Synth *synth;
-	const int debugPartialNum; // Only used for debugging
-	// Number of the sample currently being rendered by produceOutput(), or 0 if no run is in progress
-	// This is only kept available for debugging purposes.
-	unsigned long sampleNum;
+	// The members accessed while rendering come first, so that they share as few cache lines as possible.
+	// The rarely used ones, including the bulky cachebackup, are grouped at the end.
+	TVA *tva;
+	TVP *tvp;
+	TVF *tvf;
+
+	// TODO: This should be owned by PartialPair
+	// Either LA32IntPartialPair or LA32FloatPartialPair, depending on the renderer type of the synth
+	LA32PartialPair *la32Pair;
+
+	Poly *poly;
+	Partial *pair;
+
+	LA32Ramp ampRamp;
+	LA32Ramp cutoffModifierRamp;
 
 	// Actually, this is a 4-bit register but we abuse this to emulate inverted mixing.
 	// Also we double the value to enable INACCURATE_SMOOTH_PAN, with respect to MoK.
+	// The 16-bit renderer keeps the pan values converted to the 8-bit fixed-point factors.
 	Bit32s leftPanValue, rightPanValue;
 
 	int ownerPart; // -1 if unassigned
 	int mixType;
 	int structurePosition; // 0 or 1 of a structure pair
 
-	// Only used for PCM partials
-	int pcmNum;
 	// FIXME: Give this a better name (e.g. pcmWaveInfo)
+	// Only used for PCM partials
 	PCMWaveEntry *pcmWave;
 
-	// Final pulse width value, with velfollow applied, matching what is sent to the LA32.
-	// Range: 0-255
-	int pulseWidthVal;
+	// If not NULL, deactivate() appends the partial to this list rather than notifying the poly immediately.
+	DeactivatedPartialList *deactivatedPartialList;
 
-	Poly *poly;
-	Partial *pair;
+	// If not NULL, the next call to produceOutput() mixes these samples rendered by prerenderOutput() rather than rendering anew.
+	// Points to a buffer of samples of the renderer type.
+	const void *prerenderedOutput;
+	unsigned long prerenderedLength;
 
-	TVA *tva;
-	TVP *tvp;
-	TVF *tvf;
+	// Number of the sample currently being rendered by produceOutput(), or 0 if no run is in progress
+	// This is only kept available for debugging purposes.
+	unsigned long sampleNum;
 
-	LA32Ramp ampRamp;
-	LA32Ramp cutoffModifierRamp;
+	Synth *synth;
+	const int debugPartialNum; // Also used as the index of the partial in PartialManager
 
-	// TODO: This should be owned by PartialPair
-	LA32PartialPair la32Pair;
+	// Only used for PCM partials
+	int pcmNum;
+
+	// Final pulse width value, with velfollow applied, matching what is sent to the LA32.
+	// Range: 0-255
+	int pulseWidthVal;
 
 	const PatchCache *patchCache;
 	PatchCache cachebackup;
@@ -70,10 +91,27 @@ private:
 	Bit32u getAmpValue();
 	Bit32u getCutoffValue();
 
+	// Advances the envelopes for up to length samples storing the resulting control values for the LA32 wave generator.
+	// Stops early after the sample at which the TVA finishes playing. Returns the number of samples processed.
+	unsigned long generateControlBlock(Bit32u *ampVals, Bit16u *pitchVals, Bit32u *cutoffVals, unsigned long offset, unsigned long length);
+
+	// Renders up to length samples, either panned and mixed into leftBuf and rightBuf or, if monoBuf isn't NULL, stored there unpanned.
+	// Returns the number of samples rendered, which is less than length only if the partial has been deactivated.
+	template <class Sample, class LA32PairImpl>
+	unsigned long renderOutput(Sample *leftBuf, Sample *rightBuf, Sample *monoBuf, unsigned long length, LA32PairImpl *la32PairImpl);
+	template <class Sample, class LA32PairImpl>
+	bool doProduceOutput(Sample *leftBuf, Sample *rightBuf, unsigned long length, LA32PairImpl *la32PairImpl);
+	template <class Sample, class LA32PairImpl>
+	unsigned long doPrerenderOutput(Sample *buffer, unsigned long length, LA32PairImpl *la32PairImpl);
+
 public:
 	bool alreadyOutputed;
 
-	Partial(Synth *synth, int debugPartialNum);
+	// Returns the size of the memory block to pass to the constructor for the synth, where the TVA, TVP, TVF and LA32 pair objects are placed.
+	static size_t getComponentMemorySize(const Synth *synth);
+
+	// The componentMemory must be aligned to at least 16 bytes and stay allocated for the whole lifetime of the partial.
+	Partial(Synth *synth, int debugPartialNum, void *componentMemory);
 	~Partial();
 
 	int debugGetPartialNum() const;
@@ -84,6 +122,8 @@ public:
 	bool isActive() const;
 	void activate(int part);
 	void deactivate(void);
+	void setDeactivatedPartialList(DeactivatedPartialList *list);
+	void completeDeferredDeactivation();
 	void startPartial(const Part *part, Poly *usePoly, const PatchCache *useCache, const MemParams::RhythmTemp *rhythmTemp, Partial *pairPartial);
 	void startAbort();
 	void startDecayAll();
@@ -100,7 +140,17 @@ public:
 	// Returns true only if data written to buffer
 	// This function (unlike the one below it) returns processed stereo samples
 	// made from combining this single partial with its pair, if it has one.
-	bool produceOutput(Sample *leftBuf, Sample *rightBuf, unsigned long length);
+	// The sample type must match the renderer type of the synth.
+	bool produceOutput(Bit16s *leftBuf, Bit16s *rightBuf, unsigned long length);
+	bool produceOutput(float *leftBuf, float *rightBuf, unsigned long length);
+
+	// Renders the output ahead of the other partials into the buffer, which must stay intact until the next call to produceOutput().
+	// Returns the number of samples rendered, which is less than length only if the partial has been deactivated.
+	// Deactivation of the partial can be deferred with setDeactivatedPartialList(), so that produceOutput() is still invoked.
+	unsigned long prerenderOutput(Bit16s *buffer, unsigned long length);
+	unsigned long prerenderOutput(float *buffer, unsigned long length);
+	bool hasPrerenderedOutput() const;
+	void discardPrerenderedOutput();
 };
 
 }
@@ -27,6 +27,8 @@ class File;
 class TableInitialiser;
 class Partial;
 class PartialManager;
+class PartialRenderPool;
+class ReverbPipeline;
 class Part;
 class ROMImage;
 class BReverbModel;
@@ -74,6 +76,18 @@ enum MIDIDelayMode {
 	MIDIDelayMode_DELAY_ALL
 };
 
+// Sample format used throughout the rendering engine. See Synth::selectRendererType().
+enum RendererType {
+	// Uses 16-bit signed samples and the refined wave generator based on logarithmic fixed-point computations and LUTs.
+	// * Maximum emulation accuracy and speed.
+	RendererType_BIT16S,
+
+	// Uses float samples in the wave generator, the mixer and the reverb model.
+	// * Maximum output quality and minimum noise.
+	// * DACInputMode_GENERATION1 and DACInputMode_GENERATION2 are not emulated, DACInputMode_NICE is used instead.
+	RendererType_FLOAT
+};
+
 const Bit8u SYSEX_MANUFACTURER_ROLAND = 0x41;
 
 const Bit8u SYSEX_MDL_MT32 = 0x16;
@@ -140,12 +154,12 @@ class MemoryRegion {
 private:
 	Synth *synth;
 	Bit8u *realMemory;
-	Bit8u *maxTable;
+	const Bit8u *maxTable;
 public:
 	MemoryRegionType type;
 	Bit32u startAddr, entrySize, entries;
 
-	MemoryRegion(Synth *useSynth, Bit8u *useRealMemory, Bit8u *useMaxTable, MemoryRegionType useType, Bit32u useStartAddr, Bit32u useEntrySize, Bit32u useEntries) {
+	MemoryRegion(Synth *useSynth, Bit8u *useRealMemory, const Bit8u *useMaxTable, MemoryRegionType useType, Bit32u useStartAddr, Bit32u useEntrySize, Bit32u useEntries) {
 		synth = useSynth;
 		realMemory = useRealMemory;
 		maxTable = useMaxTable;
@@ -200,11 +214,11 @@ public:
 
 class PatchTempMemoryRegion : public MemoryRegion {
 public:
-	PatchTempMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_PatchTemp, MT32EMU_MEMADDR(0x030000), sizeof(MemParams::PatchTemp), 9) {}
+	PatchTempMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, const Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_PatchTemp, MT32EMU_MEMADDR(0x030000), sizeof(MemParams::PatchTemp), 9) {}
 };
 class RhythmTempMemoryRegion : public MemoryRegion {
 public:
-	RhythmTempMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_RhythmTemp, MT32EMU_MEMADDR(0x030110), sizeof(MemParams::RhythmTemp), 85) {}
+	RhythmTempMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, const Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_RhythmTemp, MT32EMU_MEMADDR(0x030110), sizeof(MemParams::RhythmTemp), 85) {}
 };
 class TimbreTempMemoryRegion : public MemoryRegion {
 public:
@@ -212,7 +226,7 @@ public:
 };
 class PatchesMemoryRegion : public MemoryRegion {
 public:
-	PatchesMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_Patches, MT32EMU_MEMADDR(0x050000), sizeof(PatchParam), 128) {}
+	PatchesMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, const Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_Patches, MT32EMU_MEMADDR(0x050000), sizeof(PatchParam), 128) {}
 };
 class TimbresMemoryRegion : public MemoryRegion {
 public:
@@ -220,7 +234,7 @@ public:
 };
 class SystemMemoryRegion : public MemoryRegion {
 public:
-	SystemMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_System, MT32EMU_MEMADDR(0x100000), sizeof(MemParams::System), 1) {}
+	SystemMemoryRegion(Synth *useSynth, Bit8u *useRealMemory, const Bit8u *useMaxTable) : MemoryRegion(useSynth, useRealMemory, useMaxTable, MR_System, MT32EMU_MEMADDR(0x100000), sizeof(MemParams::System), 1) {}
 };
 class DisplayMemoryRegion : public MemoryRegion {
 public:
@@ -258,16 +272,16 @@ protected:
 
 /**
  * Used to safely store timestamped MIDI events in a local queue.
+ * The sysex data isn't owned by the event, it resides in the sysex arena of the queue.
  */
 struct MidiEvent {
 	Bit32u shortMessageData;
 	const Bit8u *sysexData;
 	Bit32u sysexLength;
-	Bit32u timestamp;
+	Bit64u timestamp;
 
-	~MidiEvent();
-	void setShortMessage(Bit32u shortMessageData, Bit32u timestamp);
-	void setSysex(const Bit8u *sysexData, Bit32u sysexLength, Bit32u timestamp);
+	void setShortMessage(Bit32u shortMessageData, Bit64u timestamp);
+	void setSysex(const Bit8u *sysexData, Bit32u sysexLength, Bit64u timestamp);
 };
 
 /**
@@ -276,27 +290,116 @@ struct MidiEvent {
  * - get rid of prerenderer while retaining graceful partial abortion
  * - add fair emulation of the MIDI interface delays
  * - extend the synth interface with the default implementation of a typical rendering loop.
+ * The sysex data is copied into a preallocated arena, so that neither pushing nor dropping events touches the heap.
+ * Both the ring buffer size and the arena size are rounded up to a power of two.
  * THREAD SAFETY:
- * It is safe to use either in a single thread environment or when there are only two threads - one performs only reading
- * and one performs only writing. More complicated usage requires external synchronisation.
+ * It is safe to push events from any number of threads concurrently without external synchronisation,
+ * while a single thread performs reading (i.e. peeks and drops the events). The events pushed by each thread
+ * preserve their order, the events pushed by different threads are interleaved in the order of the pushes.
+ * No synchronisation is also needed between the writers and the reader, except for reset() which requires exclusive access.
  */
 class MidiEventQueue {
 private:
-	MidiEvent *ringBuffer;
-	Bit32u ringBufferSize;
+	struct Slot;
+
+	Slot *ringBuffer;
+	Bit32u ringBufferMask;
+	// Only the reader modifies the start positions, while the end positions are advanced by the writers atomically
 	volatile Bit32u startPosition;
 	volatile Bit32u endPosition;
 
+	// The arena consists of chunks, each prefixed by a header word, allocated consecutively
+	Bit32u *sysexArena;
+	Bit32u sysexArenaMask;
+	volatile Bit32u sysexArenaStart;
+	volatile Bit32u sysexArenaEnd;
+
+	Bit8u *allocateSysexData(Bit32u sysexLength);
+	void freeSysexData(const Bit8u *sysexData, Bit32u sysexLength);
+	void reclaimSysexArena();
+
 public:
-	MidiEventQueue(Bit32u ringBufferSize = DEFAULT_MIDI_EVENT_QUEUE_SIZE);
+	MidiEventQueue(Bit32u ringBufferSize = DEFAULT_MIDI_EVENT_QUEUE_SIZE, Bit32u sysexArenaSize = DEFAULT_SYSEX_ARENA_SIZE);
 	~MidiEventQueue();
 	void reset();
-	bool pushShortMessage(Bit32u shortMessageData, Bit32u timestamp);
-	bool pushSysex(const Bit8u *sysexData, Bit32u sysexLength, Bit32u timestamp);
+	bool pushShortMessage(Bit32u shortMessageData, Bit64u timestamp);
+	bool pushSysex(const Bit8u *sysexData, Bit32u sysexLength, Bit64u timestamp);
 	const MidiEvent *peekMidiEvent();
 	void dropMidiEvent();
 };
 
+// Counters and timings of the rendering engine, accumulated since the synth was opened or the statistics were reset.
+// The times are in nanoseconds. See Synth::getRenderStatistics().
+struct RenderStatistics {
+	// Number of invocations of the renderer. The public rendering methods split longer requests into chunks of MAX_SAMPLES_PER_RUN.
+	Bit64u renderCallCount;
+	// Number of runs the chunks are split into, at the timestamps of the MIDI events and when an aborting poly finishes
+	Bit64u runCount;
+	// Number of runs only 1 sample long, which are forced by the events that end the notes just started
+	Bit64u singleSampleRunCount;
+	// Number of MIDI events taken from the queue and played
+	Bit64u dispatchedEventCount;
+
+	Bit64u totalTime;
+	Bit64u eventDispatchTime;
+	Bit64u partialRenderTime;
+	Bit64u reverbTime;
+	// The DAC input emulation and the output gain
+	Bit64u dacConversionTime;
+	// The longest invocation of the renderer
+	Bit64u peakRenderCallTime;
+
+	// The maximum number of partials active during a run
+	unsigned int peakActivePartialCount;
+};
+
+// Counters of the voice stealing decisions made when partials are short, accumulated since the synth was opened.
+// The arrays are indexed by the part number, 0..7 for Part 1..8, or 8 for Rhythm. See Synth::getPartialAllocationStatistics().
+struct PartialAllocationStatistics {
+	// Numbers of polys aborted in the part to free partials for a new poly, by the state of the aborted poly
+	Bit32u abortedPlayingPolyCount[9];
+	Bit32u abortedHeldPolyCount[9];
+	Bit32u abortedReleasingPolyCount[9];
+	// Number of polys which needed more partials than the part has reserved, while not enough partials were free
+	Bit32u reserveExceededCount[9];
+	// Number of polys not played due to the lack of partials
+	Bit32u allocationFailureCount[9];
+	// Number of events which didn't fit into the event log
+	Bit32u droppedEventCount;
+};
+
+enum PartialAllocationEventType {
+	// A poly was aborted to free its partials for a new poly
+	PartialAllocationEventType_POLY_ABORTED,
+	// A new poly needed more partials than its part has reserved, while not enough partials were free
+	PartialAllocationEventType_RESERVE_EXCEEDED,
+	// A new poly wasn't played due to the lack of partials
+	PartialAllocationEventType_ALLOCATION_FAILED
+};
+
+// An entry of the log of the voice stealing decisions, see Synth::readPartialAllocationEvents().
+struct PartialAllocationEvent {
+	// The rendered sample count at the moment the event occurred
+	Bit64u timestamp;
+	// One of PartialAllocationEventType values
+	Bit8u type;
+	// The part the event concerns, i.e. the part of the aborted poly or the part of the new poly
+	Bit8u partNum;
+	// The part of the new poly which the partials are needed for
+	Bit8u requestingPartNum;
+	// The key of the aborted poly, or the key of the new poly
+	Bit8u key;
+	// The state of the aborted poly, one of PolyState values
+	Bit8u polyState;
+	// The number of partials needed for the new poly
+	Bit8u neededPartialCount;
+	// The number of partials reserved for the part
+	Bit8u reservedPartialCount;
+	// The number of partials active in the part, and the number of free partials just after the event
+	Bit16u activePartialCount;
+	Bit16u freePartialCount;
+};
+
 class Synth {
 friend class Part;
 friend class RhythmPart;
@@ -325,33 +428,41 @@ private:
 	PCMWaveEntry *pcmWaves; // Array
 
 	const ControlROMMap *controlROMMap;
-	Bit8u controlROMData[CONTROL_ROM_SIZE];
-	Bit16s *pcmROMData;
+	// Both are shared among the synths opened with the same ROMs, see ROMCache
+	const Bit8u *controlROMData;
+	const Bit16s *pcmROMData;
 	size_t pcmROMSize; // This is in 16-bit samples, therefore half the number of bytes in the ROM
 
 	unsigned int partialCount;
 	Bit8s chantable[32]; // FIXME: Need explanation why 32 is set, obviously it should be 16
 
 	MidiEventQueue *midiQueue;
-	volatile Bit32u lastReceivedMIDIEventTimestamp;
-	volatile Bit32u renderedSampleCount;
+	// The timeline is 64-bit, so it doesn't wrap in practice.
+	// Since these may be accessed concurrently with the rendering thread, the access must be atomic.
+	volatile Bit64u lastReceivedMIDIEventTimestamp;
+	volatile Bit64u renderedSampleCount;
 
 	MemParams mt32ram, mt32default;
 
 	BReverbModel *reverbModels[4];
 	BReverbModel *reverbModel;
+	// Shared by the reverb models, since only one is in use at a time. Sized for the largest one,
+	// so that changing the reverb mode merely mutes the buffers of the new model.
+	void *reverbBuffers;
 	bool reverbOverridden;
 
 	MIDIDelayMode midiDelayMode;
 	DACInputMode dacInputMode;
 
-#if MT32EMU_USE_FLOAT_SAMPLES
+	// The renderer type requested by the application and the one actually in use since the last open()
+	RendererType selectedRendererType;
+	RendererType rendererType;
+
 	float outputGain;
 	float reverbOutputGain;
-#else
-	int outputGain;
-	int reverbOutputGain;
-#endif
+	// Fixed-point gains used by the 16-bit renderer, with 8-bit fractional part
+	int intOutputGain;
+	int intReverbOutputGain;
 
 	bool reversedStereoEnabled;
 
@@ -363,17 +474,57 @@ private:
 	PartialManager *partialManager;
 	Part *parts[9];
 
+	// Six streams of MAX_SAMPLES_PER_RUN samples of the renderer type which render() mixes down, allocated in open()
+	void *mixBuffers;
+
+	unsigned int partialRenderThreadCount;
+	PartialRenderPool *partialRenderPool;
+
+	bool pipelinedReverbEnabled;
+	ReverbPipeline *reverbPipeline;
+
+	// Updated by the rendering thread, and copied after each invocation of the renderer to the published statistics.
+	// The copy is guarded by a sequence number which is odd while the copy is in progress, see getRenderStatistics().
+	// The published copy is stored as words, so that each of them is accessed atomically.
+	RenderStatistics renderStatistics;
+	volatile Bit32u publishedRenderStatistics[(sizeof(RenderStatistics) + 3) / 4];
+	volatile Bit32u renderStatisticsSequence;
+	volatile Bit32u renderStatisticsResetRequested;
+
+	// Updated by the thread which processes the MIDI events, and read word by word from any thread
+	PartialAllocationStatistics partialAllocationStatistics;
+	// Ring buffer with a single writer, which is the thread processing the MIDI events, and a single reader
+	PartialAllocationEvent *partialAllocationEventLog;
+	Bit32u partialAllocationEventLogSize;
+	Bit32u partialAllocationEventLogMask;
+	volatile Bit32u partialAllocationEventLogStart;
+	volatile Bit32u partialAllocationEventLogEnd;
+
 	// When a partial needs to be aborted to free it up for use by a new Poly,
 	// the controller will busy-loop waiting for the sound to finish.
 	// We emulate this by delaying new MIDI events processing until abortion finishes.
 	Poly *abortingPoly;
 
 	Bit32u getShortMessageLength(Bit32u msg);
-	Bit32u addMIDIInterfaceDelay(Bit32u len, Bit32u timestamp);
+	Bit64u addMIDIInterfaceDelay(Bit32u len, Bit64u timestamp);
 
-	void produceLA32Output(Sample *buffer, Bit32u len);
-	void convertSamplesToOutput(Sample *buffer, Bit32u len, bool reverb);
+	void produceLA32Output(Bit16s *buffer, Bit32u len);
+	void produceLA32Output(float *buffer, Bit32u len);
+	void convertSamplesToOutput(Bit16s *buffer, Bit32u len, bool reverb);
+	void convertSamplesToOutput(float *buffer, Bit32u len, bool reverb);
 	bool isAbortingPoly() const;
+	void playDueMIDIEvents();
+	void publishRenderStatistics();
+	void partialAllocationEventOccurred(const PartialAllocationEvent &event);
+
+	// Sample is the sample type of the renderer in use, the public rendering methods convert the output if necessary
+	template <class Sample, class OutSample>
+	void doRender(OutSample *leftStream, OutSample *rightStream, Bit32u stride, Bit32u len);
+	template <class Sample>
+	void renderStreamsNatively(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len);
+	template <class Sample, class OutSample>
+	void renderAndConvertStreams(OutSample *nonReverbLeft, OutSample *nonReverbRight, OutSample *reverbDryLeft, OutSample *reverbDryRight, OutSample *reverbWetLeft, OutSample *reverbWetRight, Bit32u len);
+	template <class Sample>
 	void doRenderStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len);
 
 	void readSysex(unsigned char channel, const Bit8u *sysex, Bit32u len) const;
@@ -413,17 +564,29 @@ public:
 		return ((-0x8000 <= sample) && (sample <= 0x7FFF)) ? (Bit16s)sample : (sample >> 31) ^ 0x7FFF;
 	}
 
-	static inline void muteSampleBuffer(Sample *buffer, Bit32u len) {
+	static inline void muteSampleBuffer(Bit16s *buffer, Bit32u len) {
 		if (buffer == NULL) return;
+		memset(buffer, 0, len * sizeof(Bit16s));
+	}
 
-#if MT32EMU_USE_FLOAT_SAMPLES
+	static inline void muteSampleBuffer(float *buffer, Bit32u len) {
+		if (buffer == NULL) return;
 		// FIXME: Use memset() where compatibility is guaranteed (if this turns out to be a win)
 		while (len--) {
 			*(buffer++) = 0.0f;
 		}
-#else
-		memset(buffer, 0, len * sizeof(Sample));
-#endif
+	}
+
+	// The float renderer output within [-2.0, 2.0] maps onto the full range of 16-bit samples
+	static inline Bit16s convertSample(float sample) {
+		sample *= 16384.0f;
+		if (sample <= -32768.0f) return -32768;
+		if (sample >= 32767.0f) return 32767;
+		return Bit16s(sample < 0.0f ? sample - 0.5f : sample + 0.5f);
+	}
+
+	static inline float convertSample(Bit16s sample) {
+		return sample / 16384.0f;
 	}
 
 	static Bit8u calcSysexChecksum(const Bit8u *data, Bit32u len, Bit8u checksum);
@@ -441,23 +604,41 @@ public:
 	// Closes the MT-32 and deallocates any memory used by the synthesizer
 	void close(void);
 
+	// Selects the type of samples used by the renderer. Takes effect on the next open().
+	// Both render() and renderStreams() accept either sample type regardless of the renderer type,
+	// the output is converted when the types differ. The default is RendererType_FLOAT if the library
+	// is built with MT32EMU_USE_FLOAT_SAMPLES enabled, otherwise RendererType_BIT16S.
+	void selectRendererType(RendererType newRendererType);
+	RendererType getSelectedRendererType() const;
+
 	// All the enqueued events are processed by the synth immediately.
 	void flushMIDIQueue();
 
 	// Sets size of the internal MIDI event queue.
 	// The queue is flushed before reallocation.
+	// Must not be called concurrently with the methods that enqueue MIDI events.
 	void setMIDIEventQueueSize(Bit32u);
 
+	// Returns the global rendered sample count since the synth was created, i.e. the current timestamp.
+	// May be called from any thread.
+	Bit64u getRenderedSampleCount() const;
+
+	// Converts a 32-bit timestamp, which is assumed to have wrapped around, to the 64-bit timeline.
+	// The result is the timestamp nearest to the current one with the same 32 least significant bits.
+	// Facilitates timestamping MIDI events with a 32-bit sample counter which is kept in sync with the synth.
+	Bit64u extendTimestamp(Bit32u timestamp) const;
+
 	// Enqueues a MIDI event for subsequent playback.
 	// The minimum delay involves the delay introduced while the event is transferred via MIDI interface
 	// and emulation of the MCU busy-loop while it frees partials for use by a new Poly.
-	// Calls from multiple threads must be synchronised, although,
-	// no synchronisation is required with the rendering thread.
+	// These methods may be called from multiple threads concurrently,
+	// no synchronisation is required either between them or with the rendering thread.
 
 	// The MIDI event will be processed not before the specified timestamp.
 	// The timestamp is measured as the global rendered sample count since the synth was created.
-	bool playMsg(Bit32u msg, Bit32u timestamp);
-	bool playSysex(const Bit8u *sysex, Bit32u len, Bit32u timestamp);
+	// See getRenderedSampleCount() and extendTimestamp().
+	bool playMsg(Bit32u msg, Bit64u timestamp);
+	bool playSysex(const Bit8u *sysex, Bit32u len, Bit64u timestamp);
 	// The MIDI event will be processed ASAP.
 	bool playMsg(Bit32u msg);
 	bool playSysex(const Bit8u *sysex, Bit32u len);
@@ -503,13 +684,41 @@ public:
 	void setReversedStereoEnabled(bool enabled);
 	bool isReversedStereoEnabled();
 
+	// Sets the number of threads used to render partials, including the rendering thread itself.
+	// With more than one thread, disjoint sets of active partials are rendered concurrently into separate buses
+	// which are then mixed in a fixed order. The output is deterministic for a given number of threads,
+	// though it may slightly differ from the single-threaded output due to the different order of mixing.
+	// Only effective if the library is built with MT32EMU_USE_PARTIAL_RENDER_THREADS enabled.
+	// Must not be called while rendering is in progress.
+	void setPartialRenderThreadCount(unsigned int threadCount);
+	unsigned int getPartialRenderThreadCount() const;
+
+	// Enables processing of the reverb on a dedicated thread, concurrently with rendering of the partials for the next run.
+	// The wet output of each run is returned during the next run, so all the output streams are delayed
+	// by PIPELINED_REVERB_LATENCY samples to stay aligned. Otherwise, the output is the same as without pipelining.
+	// Toggling the mode while open drops the samples being delayed.
+	// Only effective if the library is built with MT32EMU_USE_PARTIAL_RENDER_THREADS enabled.
+	// Must not be called while rendering is in progress.
+	void setPipelinedReverbEnabled(bool enabled);
+	bool isPipelinedReverbEnabled() const;
+
 	// Renders samples to the specified output stream.
 	// The length is in frames, not bytes (in 16-bit stereo,
 	// one frame is 4 bytes).
-	void render(Sample *stream, Bit32u len);
+	void render(Bit16s *stream, Bit32u len);
+	void render(float *stream, Bit32u len);
+
+	// Renders samples directly to the caller's buffers with an arbitrary layout.
+	// The samples of each frame are stored at leftStream[i * stride] and rightStream[i * stride].
+	// E.g. for interleaved stereo, pass rightStream = leftStream + 1 and stride = 2; for planar output,
+	// pass two separate buffers and stride = 1; to fill two channels of N-channel frames, offset the pointers
+	// by the channel indices and pass stride = N. The length is in frames.
+	void render(Bit16s *leftStream, Bit16s *rightStream, Bit32u stride, Bit32u len);
+	void render(float *leftStream, float *rightStream, Bit32u stride, Bit32u len);
 
 	// Renders samples to the specified output streams (any or all of which may be NULL).
-	void renderStreams(Sample *nonReverbLeft, Sample *nonReverbRight, Sample *reverbDryLeft, Sample *reverbDryRight, Sample *reverbWetLeft, Sample *reverbWetRight, Bit32u len);
+	void renderStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u len);
+	void renderStreams(float *nonReverbLeft, float *nonReverbRight, float *reverbDryLeft, float *reverbDryRight, float *reverbWetLeft, float *reverbWetRight, Bit32u len);
 
 	// Returns true when there is at least one active partial, otherwise false.
 	bool hasActivePartials() const;
@@ -522,6 +731,31 @@ public:
 	// Returns the maximum number of partials playing simultaneously.
 	unsigned int getPartialCount() const;
 
+	// Fills in a consistent snapshot of the statistics of the rendering engine, and returns true.
+	// May be called from any thread, it never blocks the rendering thread. The statistics are updated once per invocation
+	// of the renderer, so they lag behind while a long request is being rendered.
+	// Returns false and zeroes the statistics unless the library is built with MT32EMU_COLLECT_RENDER_STATISTICS enabled.
+	bool getRenderStatistics(RenderStatistics &statistics) const;
+
+	// Requests the statistics to be zeroed. May be called from any thread. The request is served by the rendering thread
+	// when the renderer is invoked next time, so the snapshots taken until then still contain the old values.
+	void resetRenderStatistics();
+
+	// Fills in the counters of the voice stealing decisions made since the synth was opened.
+	// May be called from any thread, it never blocks the rendering thread. Each counter is read atomically,
+	// though the counters updated meanwhile may be inconsistent with each other. The counters aren't reset while open,
+	// so the activity during a period is obtained as the difference between two snapshots.
+	void getPartialAllocationStatistics(PartialAllocationStatistics &statistics) const;
+
+	// Sets the capacity of the log of the voice stealing events, which is rounded up to a power of two.
+	// Zero disables the log, which is the default. Takes effect on the next open().
+	void setPartialAllocationEventLogSize(Bit32u size);
+
+	// Moves up to maxCount oldest events from the log to the array, and returns the number of events moved.
+	// May be called from any thread, though from a single one at a time. It never blocks the rendering thread.
+	// When the log is full, new events are dropped and counted in PartialAllocationStatistics::droppedEventCount.
+	Bit32u readPartialAllocationEvents(PartialAllocationEvent *events, Bit32u maxCount);
+
 	void readMemory(Bit32u addr, Bit32u len, Bit8u *data);
 
 	// partNum should be 0..7 for Part 1..8, or 8 for Rhythm
@@ -61,18 +61,26 @@
 
 // Configuration
 
-// If non-zero, deletes reverb buffers that are not in use to save memory.
-// If zero, keeps reverb buffers for all modes around all the time to avoid allocating/freeing in the critical path.
-#define MT32EMU_REDUCE_REVERB_MEMORY 1
-
 // 0: Maximum speed at the cost of a bit lower emulation accuracy.
 // 1: Maximum achievable emulation accuracy.
 #define MT32EMU_BOSS_REVERB_PRECISE_MODE 0
 
+// Both the integer and the float renderers are always built in, and the renderer type is selected at runtime
+// with Synth::selectRendererType(). This only selects the default renderer type and the type of Sample used in the API.
 // 0: Use 16-bit signed samples and refined wave generator based on logarithmic fixed-point computations and LUTs. Maximum emulation accuracy and speed.
 // 1: Use float samples in the wave generator and renderer. Maximum output quality and minimum noise.
 #define MT32EMU_USE_FLOAT_SAMPLES 0
 
+// 0: Partials are always rendered in the rendering thread.
+// 1: Enables Synth::setPartialRenderThreadCount() which allows rendering partials concurrently using a pool of worker threads.
+//    Requires POSIX threads (or Win32 threads on Windows), so the application should link with the thread library.
+#define MT32EMU_USE_PARTIAL_RENDER_THREADS 0
+
+// 0: No statistics of the rendering engine are collected.
+// 1: Enables Synth::getRenderStatistics() which provides the counters and the timings of the rendering stages.
+//    The timings cost a few reads of the system clock per rendering run.
+#define MT32EMU_COLLECT_RENDER_STATISTICS 0
+
 namespace MT32Emu
 {
 // The default value for the maximum number of partials playing simultaneously.
@@ -87,6 +95,10 @@ const unsigned int DEFAULT_MAX_PARTIALS = 32;
 // This value must be >= 1.
 const unsigned int MAX_SAMPLES_PER_RUN = 4096;
 
+// The number of samples all the output streams are delayed by when the reverb is pipelined, see Synth::setPipelinedReverbEnabled().
+// While pipelined, rendering is split into runs no longer than this, so a low value increases the synchronisation overhead.
+const unsigned int PIPELINED_REVERB_LATENCY = 256;
+
 // The default size of the internal MIDI event queue.
 // It holds the incoming MIDI events before the rendering engine actually processes them.
 // The main goal is to fairly emulate the real hardware behaviour which obviously
@@ -95,6 +107,11 @@ const unsigned int MAX_SAMPLES_PER_RUN = 4096;
 // This also facilitates building of an external rendering loop
 // as the queue stores timestamped MIDI events.
 const unsigned int DEFAULT_MIDI_EVENT_QUEUE_SIZE = 1024;
+
+// The default size in bytes of the arena which stores the sysex data of the enqueued MIDI events.
+// The arena is allocated along with the MIDI event queue, so that no memory is allocated while enqueueing sysex messages.
+// A sysex message which doesn't fit in the free space of the arena is rejected, just like an event pushed to a full queue.
+const unsigned int DEFAULT_SYSEX_ARENA_SIZE = 32768;
 }
 
 #include "Structures.h"
@@ -104,6 +121,7 @@ const unsigned int DEFAULT_MIDI_EVENT_QUEUE_SIZE = 1024;
 #include "Poly.h"
 #include "LA32Ramp.h"
 #include "LA32WaveGenerator.h"
+#include "LA32FloatWaveGenerator.h"
 #include "TVA.h"
 #include "TVP.h"
 #include "TVF.h"
@@ -111,5 +129,7 @@ const unsigned int DEFAULT_MIDI_EVENT_QUEUE_SIZE = 1024;
 #include "Part.h"
 #include "ROMInfo.h"
 #include "Synth.h"
+#include "SampleRateConverter.h"
+#include "SMFSequencer.h"
 
 #endif
@@ -0,0 +1,213 @@
+/* Copyright (C) 2011, 2012, 2013, 2014 Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "SyntheticROM.h"
+
+using namespace MT32Emu;
+
+static const Bit32u PCM_ROM_SIZE = 1048576;
+
+// The digests of CM-32L Control ROM v1.00 and CM-32L PCM ROM
+static const char CONTROL_ROM_SHA1[] = "73683d585cd6948cc19547942ca0e14a0319456d";
+static const char PCM_ROM_SHA1[] = "289cc298ad532b702461bfc738009d9ebe8025ea";
+
+// Locations of the tables within CM-32L Control ROM v1.00, as in the ControlROMMap used by the synth
+static const char ROM_ID[] = "\000CM32/LAPC1.00 890404";
+static const Bit32u ROM_ID_POSITION = 0x2205;
+static const Bit32u PCM_TABLE = 0x8100;
+static const Bit32u PCM_COUNT = 256;
+static const Bit32u TIMBRE_A_MAP = 0x8000;
+static const Bit32u TIMBRE_A_OFFSET = 0x8000;
+static const Bit32u TIMBRE_B_MAP = 0x8080;
+static const Bit32u TIMBRE_B_OFFSET = 0x8000;
+static const Bit32u TIMBRE_R_MAP = 0x8500;
+static const Bit32u TIMBRE_R_COUNT = 64;
+static const Bit32u RHYTHM_SETTINGS = 0x8580;
+static const Bit32u RHYTHM_SETTINGS_COUNT = 85;
+static const Bit32u RESERVE_SETTINGS = 0x4F65;
+static const Bit32u PAN_SETTINGS = 0x4F80;
+static const Bit32u PROGRAM_SETTINGS = 0x4F6E;
+static const Bit32u RHYTHM_MAX_TABLE = 0x48A1;
+static const Bit32u PATCH_MAX_TABLE = 0x48A5;
+static const Bit32u SYSTEM_MAX_TABLE = 0x48BE;
+static const Bit32u TIMBRE_MAX_TABLE = 0x48D5;
+
+static const Bit32u TIMBRE_SIZE = sizeof(TimbreParam);
+static const Bit32u TIMBRE_AREA_START = 0x9000;
+static const Bit32u TIMBRE_AREA_SIZE = 0x7000;
+
+// Maximum values of the partial parameters, in the order of TimbreParam::PartialParam
+static const Bit8u PARTIAL_PARAM_MAX[58] = {
+	96, 100, 16, 1, 3, 127, 100, 14,
+	10, 100, 4, 100, 100, 100, 100, 100, 100, 100, 100, 100,
+	100, 100, 100,
+	100, 30, 14, 127, 14, 100, 100, 4, 4, 100, 100, 100, 100, 100, 100, 100, 100, 100,
+	100, 100, 127, 12, 127, 12, 4, 4, 100, 100, 100, 100, 100, 100, 100, 100, 100
+};
+
+static const Bit8u RHYTHM_PARAM_MAX[4] = {127, 100, 14, 1};
+static const Bit8u PATCH_PARAM_MAX[16] = {3, 63, 48, 100, 24, 3, 1, 0, 100, 14, 0, 0, 0, 0, 0, 0};
+static const Bit8u SYSTEM_PARAM_MAX[23] = {127, 3, 7, 7, 32, 32, 32, 32, 32, 32, 32, 32, 32, 16, 16, 16, 16, 16, 16, 16, 16, 16, 100};
+
+// Simple LCG, so that the images don't depend on the C library implementation
+class Random {
+private:
+	Bit32u state;
+
+public:
+	Random(Bit32u seed) : state(seed) {}
+
+	Bit32u next(Bit32u range) {
+		state = state * 1664525 + 1013904223;
+		return (state >> 8) % range;
+	}
+};
+
+static void writeAddress(Bit8u *data, Bit32u address) {
+	data[0] = Bit8u(address);
+	data[1] = Bit8u(address >> 8);
+}
+
+// The synth clips the parameters to the valid range on loading, yet purely random timbres are mostly muted or barely audible.
+// So, the parameters that affect the loudness are set to sensible values, and the partials are never muted altogether.
+// About a quarter of the timbres use a single partial, which keeps the synths with few partials busy.
+static void shapeTimbre(Bit8u *timbreData, Random &random) {
+	TimbreParam *timbre = reinterpret_cast<TimbreParam *>(timbreData);
+	timbre->common.partialMute = Bit8u(1 + random.next(15));
+	for (int i = 0; i < 4; i++) {
+		TimbreParam::PartialParam &partial = timbre->partial[i];
+		partial.tvf.cutoff = Bit8u(50 + random.next(51));
+		partial.tva.level = Bit8u(80 + random.next(21));
+		partial.tva.veloSensitivity = Bit8u(random.next(50));
+		partial.tva.biasLevel1 = 12;
+		partial.tva.biasLevel2 = 12;
+		for (int j = 0; j < 4; j++) {
+			partial.tva.envLevel[j] = Bit8u(70 + random.next(31));
+		}
+	}
+}
+
+static void generateROMs(Bit32u seed, Bit8u *controlROMData, Bit8u *pcmROMData) {
+	Random random(seed);
+	// The parameters within the timbres and all the other data are 7-bit
+	for (Bit32u i = 0; i < CONTROL_ROM_SIZE; i++) {
+		controlROMData[i] = Bit8u(random.next(128));
+	}
+	for (Bit32u i = 0; i < PCM_ROM_SIZE; i++) {
+		pcmROMData[i] = Bit8u(random.next(256));
+	}
+
+	// The timbres are placed at random within the upper 28K of the ROM, so they overlap
+	for (Bit32u i = 0; i < 64; i++) {
+		Bit32u address = TIMBRE_AREA_START + random.next(TIMBRE_AREA_SIZE - TIMBRE_SIZE);
+		writeAddress(&controlROMData[TIMBRE_A_MAP + 2 * i], address - TIMBRE_A_OFFSET);
+		writeAddress(&controlROMData[TIMBRE_B_MAP + 2 * i], address - TIMBRE_B_OFFSET);
+		shapeTimbre(&controlROMData[address], random);
+	}
+	for (Bit32u i = 0; i < TIMBRE_R_COUNT; i++) {
+		Bit32u address = TIMBRE_AREA_START + random.next(TIMBRE_AREA_SIZE - TIMBRE_SIZE);
+		writeAddress(&controlROMData[TIMBRE_R_MAP + 2 * i], address);
+		shapeTimbre(&controlROMData[address], random);
+	}
+
+	// Each PCM wave occupies 2^exponent blocks of 2048 samples within the PCM ROM
+	Bit32u pcmBlockCount = PCM_ROM_SIZE / 2 / 0x800;
+	for (Bit32u i = 0; i < PCM_COUNT; i++) {
+		Bit8u *pcmEntry = &controlROMData[PCM_TABLE + 4 * i];
+		Bit32u exponent = random.next(5);
+		pcmEntry[0] = Bit8u(random.next(pcmBlockCount - (1 << exponent) + 1));
+		pcmEntry[1] = Bit8u((exponent << 4) | (random.next(2) << 7) | random.next(2));
+		pcmEntry[2] = Bit8u(random.next(256));
+		pcmEntry[3] = Bit8u(0x20 + random.next(0x40));
+	}
+
+	for (Bit32u i = 0; i < RHYTHM_SETTINGS_COUNT; i++) {
+		Bit8u *rhythmEntry = &controlROMData[RHYTHM_SETTINGS + 4 * i];
+		rhythmEntry[0] = Bit8u(random.next(128));
+		rhythmEntry[1] = Bit8u(random.next(101));
+		rhythmEntry[2] = Bit8u(random.next(15));
+		rhythmEntry[3] = Bit8u(random.next(2));
+	}
+	for (Bit32u i = 0; i < 9; i++) {
+		controlROMData[RESERVE_SETTINGS + i] = Bit8u(random.next(5));
+	}
+	for (Bit32u i = 0; i < 8; i++) {
+		controlROMData[PAN_SETTINGS + i] = Bit8u(random.next(15));
+		controlROMData[PROGRAM_SETTINGS + i] = Bit8u(random.next(128));
+	}
+
+	memcpy(&controlROMData[RHYTHM_MAX_TABLE], RHYTHM_PARAM_MAX, sizeof(RHYTHM_PARAM_MAX));
+	memcpy(&controlROMData[PATCH_MAX_TABLE], PATCH_PARAM_MAX, sizeof(PATCH_PARAM_MAX));
+	memcpy(&controlROMData[SYSTEM_MAX_TABLE], SYSTEM_PARAM_MAX, sizeof(SYSTEM_PARAM_MAX));
+	// The common timbre parameters precede the partial parameters
+	Bit8u *timbreMax = &controlROMData[TIMBRE_MAX_TABLE];
+	memset(timbreMax, 127, 10);
+	timbreMax[10] = 12;
+	timbreMax[11] = 12;
+	timbreMax[12] = 15;
+	timbreMax[13] = 1;
+	memcpy(timbreMax + 14, PARTIAL_PARAM_MAX, sizeof(PARTIAL_PARAM_MAX));
+
+	memcpy(&controlROMData[ROM_ID_POSITION], ROM_ID, sizeof(ROM_ID));
+}
+
+SyntheticROMFile::SyntheticROMFile(const Bit8u *useData, size_t size, const char *useSHA1Digest) : sha1Digest(useSHA1Digest) {
+	data = const_cast<Bit8u *>(useData);
+	fileSize = size;
+}
+
+size_t SyntheticROMFile::getSize() {
+	return fileSize;
+}
+
+const unsigned char *SyntheticROMFile::getData() {
+	return data;
+}
+
+const char *SyntheticROMFile::getSHA1() {
+	return sha1Digest;
+}
+
+void SyntheticROMFile::close() {}
+
+SyntheticROMSet::SyntheticROMSet(Bit32u seed) {
+	controlROMData = new Bit8u[CONTROL_ROM_SIZE];
+	pcmROMData = new Bit8u[PCM_ROM_SIZE];
+	generateROMs(seed, controlROMData, pcmROMData);
+	controlROMFile = new SyntheticROMFile(controlROMData, CONTROL_ROM_SIZE, CONTROL_ROM_SHA1);
+	pcmROMFile = new SyntheticROMFile(pcmROMData, PCM_ROM_SIZE, PCM_ROM_SHA1);
+	controlROMImage = ROMImage::makeROMImage(controlROMFile);
+	pcmROMImage = ROMImage::makeROMImage(pcmROMFile);
+}
+
+SyntheticROMSet::~SyntheticROMSet() {
+	ROMImage::freeROMImage(controlROMImage);
+	ROMImage::freeROMImage(pcmROMImage);
+	delete controlROMFile;
+	delete pcmROMFile;
+	delete[] controlROMData;
+	delete[] pcmROMData;
+}
+
+const ROMImage &SyntheticROMSet::getControlROMImage() const {
+	return *controlROMImage;
+}
+
+const ROMImage &SyntheticROMSet::getPCMROMImage() const {
+	return *pcmROMImage;
+}
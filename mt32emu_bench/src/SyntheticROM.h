@@ -0,0 +1,56 @@
+/* Copyright (C) 2011, 2012, 2013, 2014 Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MT32EMU_BENCH_SYNTHETIC_ROM_H
+#define MT32EMU_BENCH_SYNTHETIC_ROM_H
+
+#include <mt32emu/mt32emu.h>
+
+// An in-memory ROM image which claims the SHA1 digest of a known ROM, so that it is accepted by ROMInfo::getROMInfo().
+class SyntheticROMFile : public MT32Emu::File {
+private:
+	const char *sha1Digest;
+
+public:
+	SyntheticROMFile(const MT32Emu::Bit8u *data, size_t size, const char *sha1Digest);
+	size_t getSize();
+	const unsigned char *getData();
+	const char *getSHA1();
+	void close();
+};
+
+// Generates a pair of Control and PCM ROM images in place of the CM-32L v1.00 ROMs.
+// The contents are pseudo-random, though the tables the synth relies upon are laid out like in the real Control ROM
+// and filled with valid values. Thus, the synth plays the same odd yet deterministic sounds given the same seed.
+// This makes the benchmarks and the golden output checks reproducible without the copyrighted ROM dumps.
+class SyntheticROMSet {
+private:
+	MT32Emu::Bit8u *controlROMData;
+	MT32Emu::Bit8u *pcmROMData;
+	SyntheticROMFile *controlROMFile;
+	SyntheticROMFile *pcmROMFile;
+	const MT32Emu::ROMImage *controlROMImage;
+	const MT32Emu::ROMImage *pcmROMImage;
+
+public:
+	SyntheticROMSet(MT32Emu::Bit32u seed);
+	~SyntheticROMSet();
+
+	const MT32Emu::ROMImage &getControlROMImage() const;
+	const MT32Emu::ROMImage &getPCMROMImage() const;
+};
+
+#endif
@@ -0,0 +1,696 @@
+/* Copyright (C) 2011, 2012, 2013, 2014 Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmarks of the rendering engine, from the LA32 ramps and wave generators up to Synth::render().
+// The synths run on the synthetic ROM images, so that the numbers are reproducible without the real ROM dumps.
+// Each benchmark is repeated several times and the best run is reported, which filters out most of the noise
+// caused by the other processes. The checksums of the output are printed as well, both to keep the compiler
+// from optimising the work away and to spot changes in the output while optimising.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <mt32emu/mt32emu.h>
+// Internal header of the library, found in the source tree
+#include "BReverbModel.h"
+
+#include "SyntheticROM.h"
+
+using namespace MT32Emu;
+
+static const Bit32u DEFAULT_SEED = 1;
+static const Bit32u DEFAULT_SAMPLE_COUNT = 10 * SAMPLE_RATE;
+static const unsigned int DEFAULT_REPEAT_COUNT = 5;
+
+// Length of the blocks the output buffers are processed in, in samples
+static const Bit32u BLOCK_LENGTH = 256;
+
+static const Bit32u PCM_WAVE_LENGTH = 65536;
+
+// Returns the time in nanoseconds elapsed since an arbitrary point in the past
+#ifdef _WIN32
+
+static double getTime() {
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return double(counter.QuadPart) * 1e9 / double(frequency.QuadPart);
+}
+
+#else
+
+static double getTime() {
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return double(time.tv_sec) * 1e9 + double(time.tv_nsec);
+}
+
+#endif
+
+class QuietReportHandler : public ReportHandler {
+protected:
+	void printDebug(const char *, va_list) {}
+	void showLCDMessage(const char *) {}
+};
+
+// Simple LCG, so that the input doesn't depend on the C library implementation
+class Random {
+private:
+	Bit32u state;
+
+public:
+	Random(Bit32u seed) : state(seed) {}
+
+	Bit32u next(Bit32u range) {
+		state = state * 1664525 + 1013904223;
+		return (state >> 8) % range;
+	}
+};
+
+static inline Bit32u updateChecksum(Bit32u checksum, Bit32u value) {
+	return (checksum ^ value) * 16777619;
+}
+
+// The float output is deterministic for a given build, so the bits are hashed as is
+static inline Bit32u updateChecksum(Bit32u checksum, float value) {
+	Bit32u bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return updateChecksum(checksum, bits);
+}
+
+static inline Bit32u updateChecksum(Bit32u checksum, Bit16s value) {
+	return updateChecksum(checksum, Bit32u(value));
+}
+
+class Benchmark {
+protected:
+	char name[64];
+	const SyntheticROMSet &romSet;
+
+public:
+	Benchmark(const SyntheticROMSet &useROMSet) : romSet(useROMSet) {
+		name[0] = 0;
+	}
+
+	virtual ~Benchmark() {}
+
+	const char *getName() const {
+		return name;
+	}
+
+	// Prepares the initial state, which is not timed. Invoked before each run.
+	virtual void setUp(Bit32u seed) = 0;
+
+	// Processes sampleCount samples of output, and returns the checksum of the output.
+	virtual Bit32u run(Bit32u sampleCount) = 0;
+
+	// Releases the state allocated by setUp()
+	virtual void tearDown() {}
+};
+
+static const char *getRendererName(RendererType rendererType) {
+	return rendererType == RendererType_FLOAT ? "float" : "int";
+}
+
+class RampBenchmark : public Benchmark {
+private:
+	LA32Ramp ramp;
+	Random random;
+
+public:
+	RampBenchmark(const SyntheticROMSet &useROMSet) : Benchmark(useROMSet), random(0) {
+		strcpy(name, "LA32Ramp::nextValue");
+	}
+
+	void setUp(Bit32u seed) {
+		random = Random(seed);
+		ramp.reset();
+	}
+
+	Bit32u run(Bit32u sampleCount) {
+		Bit32u checksum = 0;
+		for (Bit32u i = 0; i < sampleCount; i++) {
+			// Restart the ramp frequently, both upwards and downwards, like the TVA and TVF do
+			if ((i & 255) == 0) {
+				ramp.startRamp(Bit8u(random.next(256)), Bit8u(1 + random.next(255)));
+			}
+			checksum = updateChecksum(checksum, ramp.nextValue());
+			if (ramp.checkInterrupt()) {
+				checksum = updateChecksum(checksum, Bit32u(1));
+			}
+		}
+		return checksum;
+	}
+};
+
+enum WaveType {
+	WaveType_SQUARE,
+	WaveType_SAWTOOTH,
+	WaveType_PCM
+};
+
+static const char *getWaveName(WaveType waveType) {
+	switch (waveType) {
+	case WaveType_SQUARE:
+		return "square";
+	case WaveType_SAWTOOTH:
+		return "sawtooth";
+	default:
+		return "pcm";
+	}
+}
+
+// Holds the control values a wave generator is fed with, which follow a slow sweep of the pitch and the cutoff
+class WaveControl {
+private:
+	Random random;
+	Bit32u amp;
+	Bit16u pitch;
+	Bit32u cutoff;
+
+public:
+	WaveControl() : random(0), amp(0), pitch(0), cutoff(0) {}
+
+	void reset(Bit32u seed) {
+		random = Random(seed);
+		update();
+	}
+
+	void update() {
+		amp = random.next(0x1000000);
+		pitch = Bit16u(0x3000 + random.next(0x6000));
+		cutoff = (64 + random.next(192)) << 18;
+	}
+
+	Bit32u getAmp() const {
+		return amp;
+	}
+
+	Bit16u getPitch() const {
+		return pitch;
+	}
+
+	Bit32u getCutoff() const {
+		return cutoff;
+	}
+};
+
+class PCMWave {
+private:
+	Bit16s *samples;
+
+public:
+	PCMWave(Bit32u seed) {
+		Random random(seed);
+		samples = new Bit16s[PCM_WAVE_LENGTH];
+		// A random walk sounds more like a real recording than white noise does
+		Bit32s value = 0;
+		for (Bit32u i = 0; i < PCM_WAVE_LENGTH; i++) {
+			value += Bit32s(random.next(2048)) - 1024;
+			if (value > 32767 || value < -32768) value /= 2;
+			samples[i] = Bit16s(value);
+		}
+	}
+
+	~PCMWave() {
+		delete[] samples;
+	}
+
+	const Bit16s *getSamples() const {
+		return samples;
+	}
+};
+
+template <class WaveGenerator>
+class WaveGeneratorBenchmark : public Benchmark {
+protected:
+	const WaveType waveType;
+	const PCMWave &pcmWave;
+	WaveGenerator waveGenerator;
+	WaveControl control;
+
+	Bit32u generateSample(Bit32u checksum, LA32WaveGenerator &wg) {
+		wg.generateNextSample(control.getAmp(), control.getPitch(), control.getCutoff());
+		LogSample first = wg.getOutputLogSample(true);
+		LogSample second = wg.getOutputLogSample(false);
+		checksum = updateChecksum(checksum, Bit32u(first.logValue | (first.sign << 16)));
+		return updateChecksum(checksum, Bit32u(second.logValue | (second.sign << 16)));
+	}
+
+	Bit32u generateSample(Bit32u checksum, LA32FloatWaveGenerator &wg) {
+		return updateChecksum(checksum, wg.generateNextSample(control.getAmp(), control.getPitch(), control.getCutoff()));
+	}
+
+public:
+	WaveGeneratorBenchmark(const SyntheticROMSet &useROMSet, const char *className, WaveType useWaveType, const PCMWave &usePCMWave) : Benchmark(useROMSet), waveType(useWaveType), pcmWave(usePCMWave) {
+		sprintf(name, "%s::generateNextSample/%s", className, getWaveName(waveType));
+	}
+
+	void setUp(Bit32u seed) {
+		control.reset(seed);
+		if (waveType == WaveType_PCM) {
+			waveGenerator.initPCM(pcmWave.getSamples(), PCM_WAVE_LENGTH, true, true);
+		} else {
+			waveGenerator.initSynth(waveType == WaveType_SAWTOOTH, 64, 16);
+		}
+	}
+
+	Bit32u run(Bit32u sampleCount) {
+		Bit32u checksum = 0;
+		for (Bit32u i = 0; i < sampleCount; i++) {
+			if ((i & 1023) == 0) control.update();
+			checksum = generateSample(checksum, waveGenerator);
+		}
+		return checksum;
+	}
+
+	void tearDown() {
+		waveGenerator.deactivate();
+	}
+};
+
+// Generates the same samples as the per-sample benchmark of the synth waves, block by block
+class SynthBlockBenchmark : public Benchmark {
+private:
+	const WaveType waveType;
+	LA32WaveGenerator waveGenerator;
+	WaveControl control;
+
+public:
+	SynthBlockBenchmark(const SyntheticROMSet &useROMSet, WaveType useWaveType) : Benchmark(useROMSet), waveType(useWaveType) {
+		sprintf(name, "LA32WaveGenerator::generateNextSynthBlock/%s", getWaveName(waveType));
+	}
+
+	void setUp(Bit32u seed) {
+		control.reset(seed);
+		waveGenerator.initSynth(waveType == WaveType_SAWTOOTH, 64, 16);
+	}
+
+	Bit32u run(Bit32u sampleCount) {
+		Bit32u ampVals[BLOCK_LENGTH];
+		Bit16u pitchVals[BLOCK_LENGTH];
+		Bit32u cutoffVals[BLOCK_LENGTH];
+		Bit16s outBuf[BLOCK_LENGTH];
+		Bit32u checksum = 0;
+		for (Bit32u i = 0; i < sampleCount; i += BLOCK_LENGTH) {
+			Bit32u length = sampleCount - i < BLOCK_LENGTH ? sampleCount - i : BLOCK_LENGTH;
+			for (Bit32u j = 0; j < length; j++) {
+				if (((i + j) & 1023) == 0) control.update();
+				ampVals[j] = control.getAmp();
+				pitchVals[j] = control.getPitch();
+				cutoffVals[j] = control.getCutoff();
+			}
+			waveGenerator.generateNextSynthBlock(outBuf, ampVals, pitchVals, cutoffVals, length);
+			for (Bit32u j = 0; j < length; j++) {
+				checksum = updateChecksum(checksum, outBuf[j]);
+			}
+		}
+		return checksum;
+	}
+
+	void tearDown() {
+		waveGenerator.deactivate();
+	}
+};
+
+template <class PartialPair>
+class PartialPairBenchmark : public Benchmark {
+private:
+	const bool ringModulated;
+	const PCMWave &pcmWave;
+	PartialPair partialPair;
+	WaveControl masterControl;
+	WaveControl slaveControl;
+
+public:
+	PartialPairBenchmark(const SyntheticROMSet &useROMSet, const char *className, bool useRingModulated, const PCMWave &usePCMWave) : Benchmark(useROMSet), ringModulated(useRingModulated), pcmWave(usePCMWave) {
+		sprintf(name, "%s::nextOutSample/%s", className, ringModulated ? "ring" : "mix");
+	}
+
+	void setUp(Bit32u seed) {
+		masterControl.reset(seed);
+		slaveControl.reset(seed + 1);
+		partialPair.init(ringModulated, ringModulated);
+		partialPair.initSynth(LA32PartialPair::MASTER, true, 32, 8);
+		partialPair.initPCM(LA32PartialPair::SLAVE, pcmWave.getSamples(), PCM_WAVE_LENGTH, true);
+	}
+
+	Bit32u run(Bit32u sampleCount) {
+		Bit32u checksum = 0;
+		for (Bit32u i = 0; i < sampleCount; i++) {
+			if ((i & 1023) == 0) {
+				masterControl.update();
+				slaveControl.update();
+			}
+			partialPair.generateNextSample(LA32PartialPair::MASTER, masterControl.getAmp(), masterControl.getPitch(), masterControl.getCutoff());
+			partialPair.generateNextSample(LA32PartialPair::SLAVE, slaveControl.getAmp(), slaveControl.getPitch(), slaveControl.getCutoff());
+			checksum = updateChecksum(checksum, partialPair.nextOutSample());
+		}
+		return checksum;
+	}
+
+	void tearDown() {
+		partialPair.deactivate(LA32PartialPair::MASTER);
+		partialPair.deactivate(LA32PartialPair::SLAVE);
+	}
+};
+
+// Base for the benchmarks that need an open synth
+class SynthBenchmark : public Benchmark {
+protected:
+	const RendererType rendererType;
+	const unsigned int partialCount;
+	QuietReportHandler reportHandler;
+	Synth *synth;
+	Random random;
+
+	// Returns a Note On message with a random key for one of the melodic parts
+	Bit32u makeRandomNote() {
+		Bit32u channel = random.next(8);
+		Bit32u key = 36 + random.next(48);
+		Bit32u velocity = 64 + random.next(64);
+		return 0x90 | channel | (key << 8) | (velocity << 16);
+	}
+
+public:
+	SynthBenchmark(const SyntheticROMSet &useROMSet, RendererType useRendererType, unsigned int usePartialCount) : Benchmark(useROMSet), rendererType(useRendererType), partialCount(usePartialCount), synth(NULL), random(0) {}
+
+	void setUp(Bit32u seed) {
+		random = Random(seed);
+		synth = new Synth(&reportHandler);
+		synth->selectRendererType(rendererType);
+		if (!synth->open(romSet.getControlROMImage(), romSet.getPCMROMImage(), partialCount)) {
+			fprintf(stderr, "Failed to open the synth\n");
+			exit(1);
+		}
+	}
+
+	void tearDown() {
+		synth->close();
+		delete synth;
+		synth = NULL;
+	}
+};
+
+class PartialBenchmark : public SynthBenchmark {
+private:
+	template <class Sample>
+	Bit32u produceOutput(Bit32u sampleCount) {
+		Sample leftBuffer[BLOCK_LENGTH];
+		Sample rightBuffer[BLOCK_LENGTH];
+		Bit32u checksum = 0;
+		while (sampleCount > 0) {
+			Bit32u length = sampleCount < BLOCK_LENGTH ? sampleCount : BLOCK_LENGTH;
+			bool produced = false;
+			memset(leftBuffer, 0, sizeof(leftBuffer));
+			memset(rightBuffer, 0, sizeof(rightBuffer));
+			for (unsigned int i = 0; i < partialCount; i++) {
+				Partial *partial = const_cast<Partial *>(synth->getPartial(i));
+				partial->alreadyOutputed = false;
+				if (partial->produceOutput(leftBuffer, rightBuffer, length)) produced = true;
+			}
+			if (!produced) {
+				// The partials have all decayed, start over
+				synth->playMsgNow(0xB0 | (123 << 8));
+				for (int i = 0; i < 8; i++) synth->playMsgNow(makeRandomNote());
+				continue;
+			}
+			for (Bit32u i = 0; i < length; i++) {
+				checksum = updateChecksum(checksum, leftBuffer[i]);
+				checksum = updateChecksum(checksum, rightBuffer[i]);
+			}
+			sampleCount -= length;
+		}
+		return checksum;
+	}
+
+public:
+	PartialBenchmark(const SyntheticROMSet &useROMSet, RendererType useRendererType) : SynthBenchmark(useROMSet, useRendererType, DEFAULT_MAX_PARTIALS) {
+		sprintf(name, "Partial::produceOutput/%s", getRendererName(rendererType));
+	}
+
+	void setUp(Bit32u seed) {
+		SynthBenchmark::setUp(seed);
+		for (int i = 0; i < 8; i++) synth->playMsgNow(makeRandomNote());
+	}
+
+	Bit32u run(Bit32u sampleCount) {
+		if (rendererType == RendererType_FLOAT) return produceOutput<float>(sampleCount);
+		return produceOutput<Bit16s>(sampleCount);
+	}
+};
+
+class SynthRenderBenchmark : public SynthBenchmark {
+private:
+	template <class Sample>
+	Bit32u render(Bit32u sampleCount) {
+		Sample buffer[2 * BLOCK_LENGTH];
+		Bit32u checksum = 0;
+		Bit32u blockIndex = 0;
+		while (sampleCount > 0) {
+			Bit32u length = sampleCount < BLOCK_LENGTH ? sampleCount : BLOCK_LENGTH;
+			// Keep the synth busy with a steady stream of notes. The older notes are stolen once the partials run out.
+			Bit64u timestamp = synth->getRenderedSampleCount() + random.next(length);
+			synth->playMsg(makeRandomNote(), timestamp);
+			if ((blockIndex++ & 7) == 0) {
+				synth->playMsg(0xB0 | random.next(8) | (123 << 8), timestamp);
+			}
+			synth->render(buffer, length);
+			for (Bit32u i = 0; i < 2 * length; i++) {
+				checksum = updateChecksum(checksum, buffer[i]);
+			}
+			sampleCount -= length;
+		}
+		return checksum;
+	}
+
+public:
+	SynthRenderBenchmark(const SyntheticROMSet &useROMSet, RendererType useRendererType, unsigned int usePartialCount) : SynthBenchmark(useROMSet, useRendererType, usePartialCount) {
+		sprintf(name, "Synth::render/%u partials/%s", partialCount, getRendererName(rendererType));
+	}
+
+	Bit32u run(Bit32u sampleCount) {
+		if (rendererType == RendererType_FLOAT) return render<float>(sampleCount);
+		return render<Bit16s>(sampleCount);
+	}
+};
+
+class ReverbBenchmark : public Benchmark {
+private:
+	// Bursts of noise alternate with silence, so that the tails are processed too
+	static const Bit32u INPUT_LENGTH = 16 * BLOCK_LENGTH;
+
+	const ReverbMode reverbMode;
+	const RendererType rendererType;
+	BReverbModel *reverbModel;
+	Bit16s intInput[2][INPUT_LENGTH];
+	float floatInput[2][INPUT_LENGTH];
+
+	template <class Sample>
+	Bit32u process(Bit32u sampleCount, const Sample (*input)[INPUT_LENGTH]) {
+		Sample outLeft[BLOCK_LENGTH], outRight[BLOCK_LENGTH];
+		Bit32u checksum = 0;
+		Bit32u inputPosition = 0;
+		while (sampleCount > 0) {
+			Bit32u length = sampleCount < BLOCK_LENGTH ? sampleCount : BLOCK_LENGTH;
+			reverbModel->process(input[0] + inputPosition, input[1] + inputPosition, outLeft, outRight, length);
+			for (Bit32u i = 0; i < length; i++) {
+				checksum = updateChecksum(checksum, outLeft[i]);
+				checksum = updateChecksum(checksum, outRight[i]);
+			}
+			inputPosition = (inputPosition + BLOCK_LENGTH) % INPUT_LENGTH;
+			sampleCount -= length;
+		}
+		return checksum;
+	}
+
+public:
+	ReverbBenchmark(const SyntheticROMSet &useROMSet, ReverbMode useReverbMode, RendererType useRendererType) : Benchmark(useROMSet), reverbMode(useReverbMode), rendererType(useRendererType), reverbModel(NULL) {
+		static const char * const modeNames[] = {"room", "hall", "plate", "tap delay"};
+		sprintf(name, "BReverbModel::process/%s/%s", modeNames[reverbMode], getRendererName(rendererType));
+	}
+
+	void setUp(Bit32u seed) {
+		Random random(seed);
+		for (int channel = 0; channel < 2; channel++) {
+			for (Bit32u i = 0; i < INPUT_LENGTH; i++) {
+				Bit32s value = (i < INPUT_LENGTH / 2) ? Bit32s(random.next(16384)) - 8192 : 0;
+				intInput[channel][i] = Bit16s(value);
+				floatInput[channel][i] = value / 32768.0f;
+			}
+		}
+		reverbModel = BReverbModel::createBReverbModel(reverbMode, true, rendererType);
+		reverbModel->open();
+		reverbModel->setParameters(5, 3);
+	}
+
+	Bit32u run(Bit32u sampleCount) {
+		if (rendererType == RendererType_FLOAT) return process<float>(sampleCount, floatInput);
+		return process<Bit16s>(sampleCount, intInput);
+	}
+
+	void tearDown() {
+		reverbModel->close();
+		delete reverbModel;
+		reverbModel = NULL;
+	}
+};
+
+static const unsigned int MAX_BENCHMARK_COUNT = 64;
+
+struct Options {
+	Bit32u seed;
+	Bit32u sampleCount;
+	unsigned int repeatCount;
+	const char *filter;
+};
+
+static void printUsage() {
+	fprintf(stderr,
+		"Usage: mt32emu-bench [options]\n"
+		"  -f <text>   Only run the benchmarks whose names contain the text\n"
+		"  -n <count>  Number of samples processed in each run (default: %u)\n"
+		"  -r <count>  Number of runs, the best one is reported (default: %u)\n"
+		"  -s <seed>   Seed of the synthetic ROMs and the input (default: %u)\n"
+		"  -l          List the benchmarks and exit\n",
+		DEFAULT_SAMPLE_COUNT, DEFAULT_REPEAT_COUNT, DEFAULT_SEED);
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	options.seed = DEFAULT_SEED;
+	options.sampleCount = DEFAULT_SAMPLE_COUNT;
+	options.repeatCount = DEFAULT_REPEAT_COUNT;
+	options.filter = NULL;
+	bool listOnly = false;
+
+	for (int argIndex = 1; argIndex < argc; argIndex++) {
+		const char *option = argv[argIndex];
+		if (option[0] != '-' || option[1] == 0 || option[2] != 0) {
+			printUsage();
+			return 1;
+		}
+		if (option[1] == 'l') {
+			listOnly = true;
+			continue;
+		}
+		if (argIndex + 1 >= argc) {
+			printUsage();
+			return 1;
+		}
+		const char *value = argv[++argIndex];
+		switch (option[1]) {
+		case 'f':
+			options.filter = value;
+			break;
+		case 'n':
+			options.sampleCount = Bit32u(strtoul(value, NULL, 10));
+			break;
+		case 'r':
+			options.repeatCount = (unsigned int)atoi(value);
+			break;
+		case 's':
+			options.seed = Bit32u(strtoul(value, NULL, 10));
+			break;
+		default:
+			printUsage();
+			return 1;
+		}
+	}
+	if (options.sampleCount == 0 || options.repeatCount == 0) {
+		printUsage();
+		return 1;
+	}
+
+	SyntheticROMSet romSet(options.seed);
+	PCMWave pcmWave(options.seed);
+	static const RendererType rendererTypes[] = {RendererType_BIT16S, RendererType_FLOAT};
+	static const WaveType waveTypes[] = {WaveType_SQUARE, WaveType_SAWTOOTH, WaveType_PCM};
+	static const unsigned int renderPartialCounts[] = {1, 8, 32};
+
+	Benchmark *benchmarks[MAX_BENCHMARK_COUNT];
+	unsigned int benchmarkCount = 0;
+	benchmarks[benchmarkCount++] = new RampBenchmark(romSet);
+	for (unsigned int i = 0; i < 3; i++) {
+		benchmarks[benchmarkCount++] = new WaveGeneratorBenchmark<LA32WaveGenerator>(romSet, "LA32WaveGenerator", waveTypes[i], pcmWave);
+	}
+	for (unsigned int i = 0; i < 2; i++) {
+		benchmarks[benchmarkCount++] = new SynthBlockBenchmark(romSet, waveTypes[i]);
+	}
+	for (unsigned int i = 0; i < 3; i++) {
+		benchmarks[benchmarkCount++] = new WaveGeneratorBenchmark<LA32FloatWaveGenerator>(romSet, "LA32FloatWaveGenerator", waveTypes[i], pcmWave);
+	}
+	for (int ringModulated = 0; ringModulated < 2; ringModulated++) {
+		benchmarks[benchmarkCount++] = new PartialPairBenchmark<LA32IntPartialPair>(romSet, "LA32IntPartialPair", ringModulated != 0, pcmWave);
+		benchmarks[benchmarkCount++] = new PartialPairBenchmark<LA32FloatPartialPair>(romSet, "LA32FloatPartialPair", ringModulated != 0, pcmWave);
+	}
+	for (unsigned int i = 0; i < 2; i++) {
+		benchmarks[benchmarkCount++] = new PartialBenchmark(romSet, rendererTypes[i]);
+	}
+	for (unsigned int mode = REVERB_MODE_ROOM; mode <= REVERB_MODE_TAP_DELAY; mode++) {
+		for (unsigned int i = 0; i < 2; i++) {
+			benchmarks[benchmarkCount++] = new ReverbBenchmark(romSet, ReverbMode(mode), rendererTypes[i]);
+		}
+	}
+	for (unsigned int i = 0; i < 3; i++) {
+		for (unsigned int j = 0; j < 2; j++) {
+			benchmarks[benchmarkCount++] = new SynthRenderBenchmark(romSet, rendererTypes[j], renderPartialCounts[i]);
+		}
+	}
+
+	if (!listOnly) {
+		printf("%-48s %12s %12s %10s\n", "Benchmark", "ns/sample", "x realtime", "checksum");
+	}
+	for (unsigned int i = 0; i < benchmarkCount; i++) {
+		Benchmark &benchmark = *benchmarks[i];
+		if (options.filter != NULL && strstr(benchmark.getName(), options.filter) == NULL) continue;
+		if (listOnly) {
+			printf("%s\n", benchmark.getName());
+			continue;
+		}
+		double bestTime = 0.0;
+		Bit32u checksum = 0;
+		for (unsigned int run = 0; run < options.repeatCount; run++) {
+			benchmark.setUp(options.seed);
+			double startTime = getTime();
+			Bit32u runChecksum = benchmark.run(options.sampleCount);
+			double time = getTime() - startTime;
+			benchmark.tearDown();
+			if (run == 0 || time < bestTime) bestTime = time;
+			// Each run starts from the same state, hence the output must match
+			if (run > 0 && runChecksum != checksum) {
+				fprintf(stderr, "%s: output differs between runs\n", benchmark.getName());
+			}
+			checksum = runChecksum;
+		}
+		double timePerSample = bestTime / options.sampleCount;
+		printf("%-48s %12.2f %12.1f %08x\n", benchmark.getName(), timePerSample, 1e9 / (timePerSample * SAMPLE_RATE), checksum);
+		fflush(stdout);
+	}
+
+	for (unsigned int i = 0; i < benchmarkCount; i++) {
+		delete benchmarks[i];
+	}
+	return 0;
+}
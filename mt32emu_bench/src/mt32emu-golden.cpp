@@ -0,0 +1,636 @@
+/* Copyright (C) 2011, 2012, 2013, 2014 Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Golden output checks, which ensure that an optimisation of the rendering engine keeps the output bit-exact.
+// A set of fixed MIDI scripts is played through Synth::render() and Synth::renderStreams() with either renderer type,
+// on the synthetic ROM images. The rendering is split into blocks of pseudo-random length, and each output stream
+// of each block is hashed. A golden file recorded with the reference build is then verified with the optimised one,
+// and the first differing block is reported. To find out the first differing sample, both builds dump the raw output,
+// and the dumps are compared.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <mt32emu/mt32emu.h>
+
+#include "SyntheticROM.h"
+
+using namespace MT32Emu;
+
+static const Bit32u DEFAULT_SEED = 1;
+static const Bit32u DEFAULT_SAMPLE_COUNT = 5 * SAMPLE_RATE;
+
+static const Bit32u MAX_BLOCK_LENGTH = 4096;
+static const unsigned int MAX_STREAM_COUNT = 6;
+
+static const char GOLDEN_FILE_SIGNATURE[] = "mt32emu-golden";
+static const char DUMP_FILE_SIGNATURE[8] = {'M', 'T', '3', '2', 'D', 'U', 'M', 'P'};
+static const Bit32u FORMAT_VERSION = 1;
+
+class QuietReportHandler : public ReportHandler {
+protected:
+	void printDebug(const char *, va_list) {}
+	void showLCDMessage(const char *) {}
+};
+
+// Simple LCG, so that the scripts don't depend on the C library implementation
+class Random {
+private:
+	Bit32u state;
+
+public:
+	Random(Bit32u seed) : state(seed) {}
+
+	Bit32u next(Bit32u range) {
+		state = state * 1664525 + 1013904223;
+		return (state >> 8) % range;
+	}
+};
+
+// A script enqueues the MIDI events due within the block about to be rendered
+typedef void (*Script)(Synth &synth, Random &random, Bit64u blockStart, Bit32u blockLength);
+
+static void playMsgWithin(Synth &synth, Random &random, Bit64u blockStart, Bit32u blockLength, Bit32u msg) {
+	synth.playMsg(msg, blockStart + random.next(blockLength));
+}
+
+static void playNote(Synth &synth, Random &random, Bit64u blockStart, Bit32u blockLength, Bit32u channel) {
+	Bit32u key = 24 + random.next(72);
+	Bit32u velocity = random.next(4) == 0 ? 0 : 1 + random.next(127);
+	// Note Off events are sent as Note On with zero velocity just as often
+	Bit32u status = velocity == 0 && random.next(2) == 0 ? 0x80 : 0x90;
+	playMsgWithin(synth, random, blockStart, blockLength, status | channel | (key << 8) | (velocity << 16));
+}
+
+static void playMelodicScript(Synth &synth, Random &random, Bit64u blockStart, Bit32u blockLength) {
+	Bit32u eventCount = random.next(1 + blockLength / 128);
+	for (Bit32u i = 0; i < eventCount; i++) {
+		Bit32u channel = random.next(8);
+		switch (random.next(16)) {
+		case 0:
+			playMsgWithin(synth, random, blockStart, blockLength, 0xC0 | channel | (random.next(128) << 8));
+			break;
+		case 1:
+			playMsgWithin(synth, random, blockStart, blockLength, 0xE0 | channel | (random.next(128) << 8) | (random.next(128) << 16));
+			break;
+		case 2:
+			playMsgWithin(synth, random, blockStart, blockLength, 0xB0 | channel | (64 << 8) | (random.next(128) << 16));
+			break;
+		default:
+			playNote(synth, random, blockStart, blockLength, channel);
+			break;
+		}
+	}
+}
+
+static void playRhythmScript(Synth &synth, Random &random, Bit64u blockStart, Bit32u blockLength) {
+	Bit32u eventCount = random.next(1 + blockLength / 64);
+	for (Bit32u i = 0; i < eventCount; i++) {
+		Bit32u key = 35 + random.next(47);
+		playMsgWithin(synth, random, blockStart, blockLength, 0x99 | (key << 8) | ((1 + random.next(127)) << 16));
+	}
+}
+
+static void playControllerScript(Synth &synth, Random &random, Bit64u blockStart, Bit32u blockLength) {
+	static const Bit8u controllers[] = {1, 7, 10, 11, 64, 121, 123};
+	playMelodicScript(synth, random, blockStart, blockLength);
+	if (random.next(4) == 0) {
+		Bit32u channel = random.next(8);
+		Bit32u controller = controllers[random.next(sizeof(controllers))];
+		playMsgWithin(synth, random, blockStart, blockLength, 0xB0 | channel | (controller << 8) | (random.next(128) << 16));
+	}
+}
+
+static void playReverbScript(Synth &synth, Random &random, Bit64u blockStart, Bit32u blockLength) {
+	playMelodicScript(synth, random, blockStart, blockLength);
+	playRhythmScript(synth, random, blockStart, blockLength);
+	if (random.next(32) == 0) {
+		// Reverb mode, time and level at once
+		Bit8u sysex[] = {0xF0, 0x41, 0x10, 0x16, 0x12, 0x10, 0x00, 0x01, 0, 0, 0, 0, 0xF7};
+		sysex[8] = Bit8u(random.next(4));
+		sysex[9] = Bit8u(random.next(8));
+		sysex[10] = Bit8u(random.next(8));
+		sysex[11] = Synth::calcSysexChecksum(&sysex[5], 6, 0);
+		synth.playSysex(sysex, sizeof(sysex), blockStart + random.next(blockLength));
+	}
+}
+
+struct TestCase {
+	const char *name;
+	Script script;
+	unsigned int partialCount;
+	DACInputMode dacInputMode;
+};
+
+static const TestCase TEST_CASES[] = {
+	{"melodic", playMelodicScript, DEFAULT_MAX_PARTIALS, DACInputMode_NICE},
+	{"melodic-pure", playMelodicScript, DEFAULT_MAX_PARTIALS, DACInputMode_PURE},
+	{"melodic-gen1", playMelodicScript, DEFAULT_MAX_PARTIALS, DACInputMode_GENERATION1},
+	{"melodic-gen2", playMelodicScript, DEFAULT_MAX_PARTIALS, DACInputMode_GENERATION2},
+	{"rhythm", playRhythmScript, DEFAULT_MAX_PARTIALS, DACInputMode_NICE},
+	{"controllers", playControllerScript, DEFAULT_MAX_PARTIALS, DACInputMode_NICE},
+	{"reverb", playReverbScript, DEFAULT_MAX_PARTIALS, DACInputMode_NICE},
+	// Voice stealing and aborting
+	{"polyphony", playReverbScript, 8, DACInputMode_NICE}
+};
+
+static const unsigned int TEST_CASE_COUNT = sizeof(TEST_CASES) / sizeof(TEST_CASES[0]);
+
+// Each test case is rendered with both renderer types, both via render() and renderStreams()
+static const unsigned int VARIANT_COUNT = 4;
+
+static const char * const STREAM_NAMES[] = {"nonReverbLeft", "nonReverbRight", "reverbDryLeft", "reverbDryRight", "reverbWetLeft", "reverbWetRight"};
+static const char * const STEREO_STREAM_NAMES[] = {"left", "right"};
+
+struct Options {
+	Bit32u seed;
+	Bit32u sampleCount;
+	unsigned int threadCount;
+};
+
+// Receives the rendered blocks. Returns false to stop processing the current test case.
+class BlockProcessor {
+public:
+	virtual ~BlockProcessor() {}
+	virtual void startTestCase(Bit32u index, const char *name) = 0;
+	virtual bool processBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const Bit16s * const *streams, unsigned int streamCount) = 0;
+	virtual bool processBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const float * const *streams, unsigned int streamCount) = 0;
+};
+
+static inline Bit32u updateHash(Bit32u hash, Bit32u value) {
+	for (int i = 0; i < 4; i++) {
+		hash = (hash ^ ((value >> (i << 3)) & 0xFF)) * 16777619;
+	}
+	return hash;
+}
+
+static inline Bit32u getSampleBits(Bit16s sample) {
+	return Bit16u(sample);
+}
+
+// The float output is deterministic for a given build, so the bits are hashed as is
+static inline Bit32u getSampleBits(float sample) {
+	Bit32u bits;
+	memcpy(&bits, &sample, sizeof(bits));
+	return bits;
+}
+
+template <class Sample>
+static void hashStreams(Bit32u *hashes, Bit32u blockLength, const Sample * const *streams, unsigned int streamCount) {
+	for (unsigned int i = 0; i < streamCount; i++) {
+		Bit32u hash = 2166136261U;
+		for (Bit32u j = 0; j < blockLength; j++) {
+			hash = updateHash(hash, getSampleBits(streams[i][j]));
+		}
+		hashes[i] = hash;
+	}
+}
+
+class HashRecorder : public BlockProcessor {
+private:
+	FILE *file;
+	const char *testCaseName;
+
+	template <class Sample>
+	bool recordBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const Sample * const *streams, unsigned int streamCount) {
+		Bit32u hashes[MAX_STREAM_COUNT];
+		hashStreams(hashes, blockLength, streams, streamCount);
+		fprintf(file, "%s %u %lu %u", testCaseName, blockIndex, (unsigned long)blockStart, blockLength);
+		for (unsigned int i = 0; i < streamCount; i++) {
+			fprintf(file, " %08x", hashes[i]);
+		}
+		fprintf(file, "\n");
+		return true;
+	}
+
+public:
+	HashRecorder(FILE *useFile) : file(useFile), testCaseName(NULL) {}
+
+	void startTestCase(Bit32u, const char *name) {
+		testCaseName = name;
+	}
+
+	bool processBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const Bit16s * const *streams, unsigned int streamCount) {
+		return recordBlock(blockIndex, blockStart, blockLength, streams, streamCount);
+	}
+
+	bool processBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const float * const *streams, unsigned int streamCount) {
+		return recordBlock(blockIndex, blockStart, blockLength, streams, streamCount);
+	}
+};
+
+class HashVerifier : public BlockProcessor {
+private:
+	FILE *file;
+	const char *testCaseName;
+	unsigned int failedTestCaseCount;
+	bool readError;
+
+	// Reads the next record, skipping the rest of the test case which is already reported
+	bool readRecord(char *name, Bit32u &blockIndex, unsigned long &blockStart, Bit32u &blockLength, Bit32u *hashes, unsigned int streamCount) {
+		char line[256];
+		if (fgets(line, sizeof(line), file) == NULL) return false;
+		int offset = 0;
+		if (sscanf(line, "%63s %u %lu %u%n", name, &blockIndex, &blockStart, &blockLength, &offset) != 4) return false;
+		for (unsigned int i = 0; i < streamCount; i++) {
+			int length = 0;
+			if (sscanf(line + offset, " %x%n", &hashes[i], &length) != 1) return false;
+			offset += length;
+		}
+		return true;
+	}
+
+	template <class Sample>
+	bool verifyBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const Sample * const *streams, unsigned int streamCount) {
+		char expectedName[64];
+		Bit32u expectedBlockIndex, expectedBlockLength;
+		unsigned long expectedBlockStart;
+		Bit32u expectedHashes[MAX_STREAM_COUNT];
+		if (!readRecord(expectedName, expectedBlockIndex, expectedBlockStart, expectedBlockLength, expectedHashes, streamCount)
+			|| strcmp(expectedName, testCaseName) != 0 || expectedBlockIndex != blockIndex
+			|| expectedBlockStart != (unsigned long)blockStart || expectedBlockLength != blockLength) {
+			printf("%s: the golden file doesn't match the test case at block %u\n", testCaseName, blockIndex);
+			readError = true;
+			failedTestCaseCount++;
+			return false;
+		}
+		Bit32u hashes[MAX_STREAM_COUNT];
+		hashStreams(hashes, blockLength, streams, streamCount);
+		for (unsigned int i = 0; i < streamCount; i++) {
+			if (hashes[i] != expectedHashes[i]) {
+				const char *streamName = streamCount == 2 ? STEREO_STREAM_NAMES[i] : STREAM_NAMES[i];
+				printf("%s: output differs in block %u (samples %lu to %lu) of stream %s\n", testCaseName, blockIndex, (unsigned long)blockStart, (unsigned long)(blockStart + blockLength - 1), streamName);
+				failedTestCaseCount++;
+				skipTestCase();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void skipTestCase() {
+		char line[256];
+		for (;;) {
+			long position = ftell(file);
+			char name[64];
+			if (fgets(line, sizeof(line), file) == NULL) return;
+			if (sscanf(line, "%63s", name) != 1 || strcmp(name, testCaseName) != 0) {
+				fseek(file, position, SEEK_SET);
+				return;
+			}
+		}
+	}
+
+public:
+	HashVerifier(FILE *useFile) : file(useFile), testCaseName(NULL), failedTestCaseCount(0), readError(false) {}
+
+	void startTestCase(Bit32u, const char *name) {
+		testCaseName = name;
+	}
+
+	bool processBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const Bit16s * const *streams, unsigned int streamCount) {
+		if (readError) return false;
+		return verifyBlock(blockIndex, blockStart, blockLength, streams, streamCount);
+	}
+
+	bool processBlock(Bit32u blockIndex, Bit64u blockStart, Bit32u blockLength, const float * const *streams, unsigned int streamCount) {
+		if (readError) return false;
+		return verifyBlock(blockIndex, blockStart, blockLength, streams, streamCount);
+	}
+
+	unsigned int getFailedTestCaseCount() const {
+		return failedTestCaseCount;
+	}
+};
+
+// The dump consists of the blocks written one after another. Each block starts with a header of 5 words:
+// the test case index, the block index, the block length, the stream count and the sample size.
+// The streams follow in native byte order. The dumps are only meant to be compared on the same machine.
+class OutputDumper : public BlockProcessor {
+private:
+	FILE *file;
+	Bit32u testCaseIndex;
+
+	template <class Sample>
+	bool dumpBlock(Bit32u blockIndex, Bit32u blockLength, const Sample * const *streams, unsigned int streamCount) {
+		Bit32u header[5] = {testCaseIndex, blockIndex, blockLength, streamCount, sizeof(Sample)};
+		fwrite(header, sizeof(header), 1, file);
+		for (unsigned int i = 0; i < streamCount; i++) {
+			fwrite(streams[i], sizeof(Sample), blockLength, file);
+		}
+		return true;
+	}
+
+public:
+	OutputDumper(FILE *useFile) : file(useFile), testCaseIndex(0) {}
+
+	void startTestCase(Bit32u index, const char *) {
+		testCaseIndex = index;
+	}
+
+	bool processBlock(Bit32u blockIndex, Bit64u, Bit32u blockLength, const Bit16s * const *streams, unsigned int streamCount) {
+		return dumpBlock(blockIndex, blockLength, streams, streamCount);
+	}
+
+	bool processBlock(Bit32u blockIndex, Bit64u, Bit32u blockLength, const float * const *streams, unsigned int streamCount) {
+		return dumpBlock(blockIndex, blockLength, streams, streamCount);
+	}
+};
+
+static void makeTestCaseName(char *name, Bit32u testCaseIndex) {
+	const TestCase &testCase = TEST_CASES[testCaseIndex / VARIANT_COUNT];
+	unsigned int variant = testCaseIndex % VARIANT_COUNT;
+	sprintf(name, "%s/%s/%s", testCase.name, (variant & 1) ? "float" : "int", (variant & 2) ? "renderStreams" : "render");
+}
+
+template <class Sample>
+static void renderTestCase(Synth &synth, const TestCase &testCase, bool renderStreams, const Options &options, BlockProcessor &processor) {
+	static Sample buffer[2 * MAX_BLOCK_LENGTH];
+	static Sample streamBuffers[MAX_STREAM_COUNT][MAX_BLOCK_LENGTH];
+	const Sample *streams[MAX_STREAM_COUNT];
+	for (unsigned int i = 0; i < MAX_STREAM_COUNT; i++) {
+		streams[i] = streamBuffers[i];
+	}
+	// The block lengths don't depend on the script, so the events always fall onto the same blocks
+	Random blockRandom(options.seed);
+	Random eventRandom(options.seed + 1);
+	Bit64u blockStart = 0;
+	for (Bit32u blockIndex = 0; blockStart < options.sampleCount; blockIndex++) {
+		Bit32u blockLength;
+		switch (blockRandom.next(8)) {
+		case 0:
+			// Tiny blocks to exercise splitting at the event boundaries
+			blockLength = 1 + blockRandom.next(8);
+			break;
+		case 1:
+			blockLength = 1 + blockRandom.next(MAX_BLOCK_LENGTH);
+			break;
+		default:
+			blockLength = 1 + blockRandom.next(512);
+			break;
+		}
+		if (blockLength > options.sampleCount - blockStart) blockLength = Bit32u(options.sampleCount - blockStart);
+		testCase.script(synth, eventRandom, blockStart, blockLength);
+		bool processed;
+		if (renderStreams) {
+			synth.renderStreams(streamBuffers[0], streamBuffers[1], streamBuffers[2], streamBuffers[3], streamBuffers[4], streamBuffers[5], blockLength);
+			processed = processor.processBlock(blockIndex, blockStart, blockLength, streams, MAX_STREAM_COUNT);
+		} else {
+			synth.render(buffer, blockLength);
+			for (Bit32u i = 0; i < blockLength; i++) {
+				streamBuffers[0][i] = buffer[2 * i];
+				streamBuffers[1][i] = buffer[2 * i + 1];
+			}
+			processed = processor.processBlock(blockIndex, blockStart, blockLength, streams, 2);
+		}
+		if (!processed) return;
+		blockStart += blockLength;
+	}
+}
+
+static void renderTestCases(const SyntheticROMSet &romSet, const Options &options, BlockProcessor &processor) {
+	for (Bit32u testCaseIndex = 0; testCaseIndex < TEST_CASE_COUNT * VARIANT_COUNT; testCaseIndex++) {
+		const TestCase &testCase = TEST_CASES[testCaseIndex / VARIANT_COUNT];
+		unsigned int variant = testCaseIndex % VARIANT_COUNT;
+		char name[64];
+		makeTestCaseName(name, testCaseIndex);
+		processor.startTestCase(testCaseIndex, name);
+
+		QuietReportHandler reportHandler;
+		Synth synth(&reportHandler);
+		synth.selectRendererType((variant & 1) ? RendererType_FLOAT : RendererType_BIT16S);
+		synth.setPartialRenderThreadCount(options.threadCount);
+		if (!synth.open(romSet.getControlROMImage(), romSet.getPCMROMImage(), testCase.partialCount)) {
+			fprintf(stderr, "Failed to open the synth\n");
+			exit(1);
+		}
+		synth.setDACInputMode(testCase.dacInputMode);
+		if (variant & 1) {
+			renderTestCase<float>(synth, testCase, (variant & 2) != 0, options, processor);
+		} else {
+			renderTestCase<Bit16s>(synth, testCase, (variant & 2) != 0, options, processor);
+		}
+		synth.close();
+	}
+}
+
+static bool readDumpHeader(FILE *file, Options &options) {
+	char signature[sizeof(DUMP_FILE_SIGNATURE)];
+	Bit32u header[4];
+	if (fread(signature, sizeof(signature), 1, file) != 1 || memcmp(signature, DUMP_FILE_SIGNATURE, sizeof(signature)) != 0) return false;
+	if (fread(header, sizeof(header), 1, file) != 1 || header[0] != FORMAT_VERSION) return false;
+	options.seed = header[1];
+	options.sampleCount = header[2];
+	options.threadCount = header[3];
+	return true;
+}
+
+template <class Sample>
+static bool compareSamples(Bit32u testCaseIndex, Bit32u blockStart, Bit32u blockLength, unsigned int streamCount, FILE *file1, FILE *file2) {
+	static Sample streams1[MAX_STREAM_COUNT][MAX_BLOCK_LENGTH];
+	static Sample streams2[MAX_STREAM_COUNT][MAX_BLOCK_LENGTH];
+	for (unsigned int i = 0; i < streamCount; i++) {
+		fread(streams1[i], sizeof(Sample), blockLength, file1);
+		fread(streams2[i], sizeof(Sample), blockLength, file2);
+	}
+	for (Bit32u j = 0; j < blockLength; j++) {
+		for (unsigned int i = 0; i < streamCount; i++) {
+			if (getSampleBits(streams1[i][j]) == getSampleBits(streams2[i][j])) continue;
+			char name[64];
+			makeTestCaseName(name, testCaseIndex);
+			const char *streamName = streamCount == 2 ? STEREO_STREAM_NAMES[i] : STREAM_NAMES[i];
+			printf("%s: first difference at sample %u of stream %s: %.9g vs %.9g\n", name, blockStart + j, streamName, double(streams1[i][j]), double(streams2[i][j]));
+			return false;
+		}
+	}
+	return true;
+}
+
+static int compareDumps(const char *fileName1, const char *fileName2) {
+	FILE *file1 = fopen(fileName1, "rb");
+	FILE *file2 = fopen(fileName2, "rb");
+	Options options1, options2;
+	if (file1 == NULL || file2 == NULL || !readDumpHeader(file1, options1) || !readDumpHeader(file2, options2)) {
+		fprintf(stderr, "Can't read the dump files\n");
+		return 2;
+	}
+	if (options1.seed != options2.seed || options1.sampleCount != options2.sampleCount || options1.threadCount != options2.threadCount) {
+		fprintf(stderr, "The dumps are made with different options\n");
+		return 2;
+	}
+	unsigned int failedTestCaseCount = 0;
+	Bit32u failedTestCaseIndex = TEST_CASE_COUNT * VARIANT_COUNT;
+	Bit32u blockStart = 0;
+	Bit32u lastTestCaseIndex = TEST_CASE_COUNT * VARIANT_COUNT;
+	for (;;) {
+		Bit32u header1[5], header2[5];
+		bool read1 = fread(header1, sizeof(header1), 1, file1) == 1;
+		bool read2 = fread(header2, sizeof(header2), 1, file2) == 1;
+		if (!read1 && !read2) break;
+		if (read1 != read2 || memcmp(header1, header2, sizeof(header1)) != 0 || header1[0] >= TEST_CASE_COUNT * VARIANT_COUNT
+			|| header1[2] > MAX_BLOCK_LENGTH || header1[3] > MAX_STREAM_COUNT) {
+			fprintf(stderr, "The dumps are inconsistent\n");
+			return 2;
+		}
+		Bit32u testCaseIndex = header1[0];
+		if (testCaseIndex != lastTestCaseIndex) {
+			lastTestCaseIndex = testCaseIndex;
+			blockStart = 0;
+		}
+		Bit32u blockLength = header1[2];
+		unsigned int streamCount = header1[3];
+		// Once a difference is reported, the rest of the test case is skipped
+		if (testCaseIndex == failedTestCaseIndex) {
+			fseek(file1, long(header1[4] * streamCount * blockLength), SEEK_CUR);
+			fseek(file2, long(header1[4] * streamCount * blockLength), SEEK_CUR);
+		} else {
+			bool equal;
+			if (header1[4] == sizeof(float)) {
+				equal = compareSamples<float>(testCaseIndex, blockStart, blockLength, streamCount, file1, file2);
+			} else {
+				equal = compareSamples<Bit16s>(testCaseIndex, blockStart, blockLength, streamCount, file1, file2);
+			}
+			if (!equal) {
+				failedTestCaseIndex = testCaseIndex;
+				failedTestCaseCount++;
+			}
+		}
+		blockStart += blockLength;
+	}
+	fclose(file1);
+	fclose(file2);
+	if (failedTestCaseCount > 0) {
+		printf("%u of %u test cases differ\n", failedTestCaseCount, TEST_CASE_COUNT * VARIANT_COUNT);
+		return 1;
+	}
+	printf("The dumps are identical\n");
+	return 0;
+}
+
+static void printUsage() {
+	fprintf(stderr,
+		"Usage: mt32emu-golden record [options] <golden file>\n"
+		"       mt32emu-golden verify <golden file>\n"
+		"       mt32emu-golden dump [options] <dump file>\n"
+		"       mt32emu-golden compare <dump file> <dump file>\n"
+		"Options:\n"
+		"  -n <count>  Number of samples rendered in each test case (default: %u)\n"
+		"  -s <seed>   Seed of the synthetic ROMs and the scripts (default: %u)\n"
+		"  -t <count>  Number of partial rendering threads (default: 1)\n",
+		DEFAULT_SAMPLE_COUNT, DEFAULT_SEED);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 3) {
+		printUsage();
+		return 2;
+	}
+	const char *command = argv[1];
+	if (strcmp(command, "compare") == 0) {
+		if (argc != 4) {
+			printUsage();
+			return 2;
+		}
+		return compareDumps(argv[2], argv[3]);
+	}
+
+	Options options;
+	options.seed = DEFAULT_SEED;
+	options.sampleCount = DEFAULT_SAMPLE_COUNT;
+	options.threadCount = 1;
+	int argIndex = 2;
+	for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex++) {
+		const char *option = argv[argIndex];
+		const char *value = argv[++argIndex];
+		switch (option[1] == 0 || option[2] != 0 ? 0 : option[1]) {
+		case 'n':
+			options.sampleCount = Bit32u(strtoul(value, NULL, 10));
+			break;
+		case 's':
+			options.seed = Bit32u(strtoul(value, NULL, 10));
+			break;
+		case 't':
+			options.threadCount = (unsigned int)atoi(value);
+			break;
+		default:
+			printUsage();
+			return 2;
+		}
+	}
+	if (argIndex + 1 != argc || options.sampleCount == 0) {
+		printUsage();
+		return 2;
+	}
+	const char *fileName = argv[argIndex];
+
+	if (strcmp(command, "record") == 0) {
+		FILE *file = fopen(fileName, "w");
+		if (file == NULL) {
+			fprintf(stderr, "Can't create %s\n", fileName);
+			return 2;
+		}
+		fprintf(file, "%s %u %u %u %u\n", GOLDEN_FILE_SIGNATURE, FORMAT_VERSION, options.seed, options.sampleCount, options.threadCount);
+		SyntheticROMSet romSet(options.seed);
+		HashRecorder recorder(file);
+		renderTestCases(romSet, options, recorder);
+		fclose(file);
+		return 0;
+	}
+	if (strcmp(command, "verify") == 0) {
+		if (argIndex != 2) {
+			// The options are taken from the golden file
+			printUsage();
+			return 2;
+		}
+		FILE *file = fopen(fileName, "r");
+		char signature[sizeof(GOLDEN_FILE_SIGNATURE)];
+		Bit32u version;
+		if (file == NULL || fscanf(file, "%14s %u %u %u %u ", signature, &version, &options.seed, &options.sampleCount, &options.threadCount) != 5
+			|| strcmp(signature, GOLDEN_FILE_SIGNATURE) != 0 || version != FORMAT_VERSION) {
+			fprintf(stderr, "Can't read the golden file %s\n", fileName);
+			return 2;
+		}
+		SyntheticROMSet romSet(options.seed);
+		HashVerifier verifier(file);
+		renderTestCases(romSet, options, verifier);
+		fclose(file);
+		if (verifier.getFailedTestCaseCount() > 0) {
+			printf("%u of %u test cases failed\n", verifier.getFailedTestCaseCount(), TEST_CASE_COUNT * VARIANT_COUNT);
+			return 1;
+		}
+		printf("All %u test cases passed\n", TEST_CASE_COUNT * VARIANT_COUNT);
+		return 0;
+	}
+	if (strcmp(command, "dump") == 0) {
+		FILE *file = fopen(fileName, "wb");
+		if (file == NULL) {
+			fprintf(stderr, "Can't create %s\n", fileName);
+			return 2;
+		}
+		Bit32u header[4] = {FORMAT_VERSION, options.seed, options.sampleCount, options.threadCount};
+		fwrite(DUMP_FILE_SIGNATURE, sizeof(DUMP_FILE_SIGNATURE), 1, file);
+		fwrite(header, sizeof(header), 1, file);
+		SyntheticROMSet romSet(options.seed);
+		OutputDumper dumper(file);
+		renderTestCases(romSet, options, dumper);
+		fclose(file);
+		return 0;
+	}
+	printUsage();
+	return 2;
+}
@@ -0,0 +1,218 @@
+/* Copyright (C) 2011, 2012, 2013, 2014 Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Generator of the constant lookup tables of the library. The tables used to be computed at run time with float math,
+// which made the results depend on the C library of the platform. They are now compiled in from TableData.cpp,
+// which this tool emits from the original formulas. It also verifies the tables compiled into the library against them.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <mt32emu/mt32emu.h>
+
+#include "mmath.h"
+
+using namespace MT32Emu;
+
+static const char TABLE_DATA_HEADER[] =
+	"/* Copyright (C) 2003, 2004, 2005, 2006, 2008, 2009 Dean Beeler, Jerome Fisher\n"
+	" * Copyright (C) 2011, 2012, 2013, 2014 Dean Beeler, Jerome Fisher, Sergey V. Mikayev\n"
+	" *\n"
+	" *  This program is free software: you can redistribute it and/or modify\n"
+	" *  it under the terms of the GNU Lesser General Public License as published by\n"
+	" *  the Free Software Foundation, either version 2.1 of the License, or\n"
+	" *  (at your option) any later version.\n"
+	" *\n"
+	" *  This program is distributed in the hope that it will be useful,\n"
+	" *  but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+	" *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+	" *  GNU Lesser General Public License for more details.\n"
+	" *\n"
+	" *  You should have received a copy of the GNU Lesser General Public License\n"
+	" *  along with this program.  If not, see <http://www.gnu.org/licenses/>.\n"
+	" */\n"
+	"\n"
+	"// This file is generated by mt32emu-tablegen, don't edit it by hand.\n"
+	"// The tables are computed with the original formulas, which can be found in the generator.\n"
+	"\n"
+	"#include \"mt32emu.h\"\n"
+	"\n"
+	"namespace MT32Emu {\n";
+
+static const unsigned int VALUES_PER_LINE = 16;
+
+// The tables computed with the original formulas
+struct ReferenceTables {
+	Bit8u levelToAmpSubtraction[101];
+	Bit8u envLogarithmicTime[256];
+	Bit8u masterVolToAmpSubtractionMT32[101];
+	Bit8u masterVolToAmpSubtractionLAPC[101];
+	Bit8u pulseWidth100To255[101];
+	Bit16u exp9[512];
+	Bit16u logsin9[512];
+};
+
+// Same as EXP2F() on the platforms other than OSX, where exp2f() gives slightly different results.
+// The generated tables don't depend on the platform, so the reference formula is fixed.
+static float referenceExp2(float x) {
+	return float(exp(FLOAT_LN_2 * x));
+}
+
+static void computeReferenceTables(ReferenceTables &tables) {
+	int lf;
+	for (lf = 0; lf <= 100; lf++) {
+		// CONFIRMED:KG: This matches a ROM table found by Mok
+		float fVal = (2.0f - LOG10F((float)lf + 1.0f)) * 128.0f;
+		int val = (int)(fVal + 1.0);
+		if (val > 255) {
+			val = 255;
+		}
+		tables.levelToAmpSubtraction[lf] = (Bit8u)val;
+	}
+
+	tables.envLogarithmicTime[0] = 64;
+	for (lf = 1; lf <= 255; lf++) {
+		// CONFIRMED:KG: This matches a ROM table found by Mok
+		tables.envLogarithmicTime[lf] = (Bit8u)ceil(64.0f + LOG2F((float)lf) * 8.0f);
+	}
+
+	// CONFIRMED: Based on a table found by Mok in the LAPC-I control ROM
+	// Note that this matches the MT-32 table, but with the values clamped to a maximum of 8.
+	memset(tables.masterVolToAmpSubtractionLAPC, 8, 71);
+	memset(tables.masterVolToAmpSubtractionLAPC + 71, 7, 3);
+	memset(tables.masterVolToAmpSubtractionLAPC + 74, 6, 4);
+	memset(tables.masterVolToAmpSubtractionLAPC + 78, 5, 3);
+	memset(tables.masterVolToAmpSubtractionLAPC + 81, 4, 4);
+	memset(tables.masterVolToAmpSubtractionLAPC + 85, 3, 3);
+	memset(tables.masterVolToAmpSubtractionLAPC + 88, 2, 4);
+	memset(tables.masterVolToAmpSubtractionLAPC + 92, 1, 4);
+	memset(tables.masterVolToAmpSubtractionLAPC + 96, 0, 5);
+
+	// CONFIRMED: Based on a table found by Mok in the MT-32 control ROM
+	tables.masterVolToAmpSubtractionMT32[0] = 255;
+	for (int masterVol = 1; masterVol <= 100; masterVol++) {
+		tables.masterVolToAmpSubtractionMT32[masterVol] = (int)(106.31 - 16.0f * LOG2F((float)masterVol));
+	}
+
+	for (int i = 0; i <= 100; i++) {
+		tables.pulseWidth100To255[i] = (int)(i * 255 / 100.0f + 0.5f);
+	}
+
+	for (int i = 0; i < 512; i++) {
+		tables.exp9[i] = Bit16u(8191.5f - referenceExp2(13.0f + ~i / 512.0f));
+	}
+
+	for (int i = 1; i < 512; i++) {
+		tables.logsin9[i] = Bit16u(0.5f - LOG2F(sin((i + 0.5f) / 1024.0f * FLOAT_PI)) * 1024.0f);
+	}
+
+	// The very first value is clamped to the maximum possible 13-bit integer
+	tables.logsin9[0] = 8191;
+}
+
+template <class T>
+static void writeTable(FILE *file, const char *comment, const char *declaration, const T *values, unsigned int length) {
+	fprintf(file, "\n%s%s[%u] = {", comment, declaration, length);
+	for (unsigned int i = 0; i < length; i++) {
+		fprintf(file, i % VALUES_PER_LINE == 0 ? "\n\t%u," : " %u,", (unsigned int)values[i]);
+	}
+	fprintf(file, "\n};\n");
+}
+
+static int generate(const char *fileName) {
+	ReferenceTables tables;
+	computeReferenceTables(tables);
+
+	FILE *file = fopen(fileName, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Can't create %s\n", fileName);
+		return 2;
+	}
+	fputs(TABLE_DATA_HEADER, file);
+	writeTable(file, "// CONFIRMED:KG: This matches a ROM table found by Mok\n", "const Bit8u Tables::levelToAmpSubtraction", tables.levelToAmpSubtraction, 101);
+	writeTable(file, "// CONFIRMED:KG: This matches a ROM table found by Mok\n", "const Bit8u Tables::envLogarithmicTime", tables.envLogarithmicTime, 256);
+	fprintf(file, "\n#ifdef EMULATE_LAPC_I // Dummy #ifdef - we'll have runtime emulation mode selection in future.\n");
+	writeTable(file, "// CONFIRMED: Based on a table found by Mok in the LAPC-I control ROM\n"
+		"// Note that this matches the MT-32 table, but with the values clamped to a maximum of 8.\n",
+		"const Bit8u Tables::masterVolToAmpSubtraction", tables.masterVolToAmpSubtractionLAPC, 101);
+	fprintf(file, "\n#else\n");
+	writeTable(file, "// CONFIRMED: Based on a table found by Mok in the MT-32 control ROM\n",
+		"const Bit8u Tables::masterVolToAmpSubtraction", tables.masterVolToAmpSubtractionMT32, 101);
+	fprintf(file, "\n#endif\n");
+	writeTable(file, "", "const Bit8u Tables::pulseWidth100To255", tables.pulseWidth100To255, 101);
+	writeTable(file, "", "const Bit16u Tables::exp9", tables.exp9, 512);
+	writeTable(file, "", "const Bit16u Tables::logsin9", tables.logsin9, 512);
+	fprintf(file, "\n}\n");
+	if (fclose(file) != 0) {
+		fprintf(stderr, "Can't write %s\n", fileName);
+		return 2;
+	}
+	return 0;
+}
+
+template <class T>
+static bool verifyTable(const char *name, const T *expected, const T *actual, unsigned int length) {
+	for (unsigned int i = 0; i < length; i++) {
+		if (expected[i] != actual[i]) {
+			printf("%s[%u]: expected %u, found %u\n", name, i, (unsigned int)expected[i], (unsigned int)actual[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+static int verify() {
+	ReferenceTables expected;
+	computeReferenceTables(expected);
+	const Tables &actual = Tables::getInstance();
+
+#ifdef EMULATE_LAPC_I
+	const Bit8u *expectedMasterVolToAmpSubtraction = expected.masterVolToAmpSubtractionLAPC;
+#else
+	const Bit8u *expectedMasterVolToAmpSubtraction = expected.masterVolToAmpSubtractionMT32;
+#endif
+
+	bool passed = verifyTable("levelToAmpSubtraction", expected.levelToAmpSubtraction, actual.levelToAmpSubtraction, 101);
+	passed &= verifyTable("envLogarithmicTime", expected.envLogarithmicTime, actual.envLogarithmicTime, 256);
+	passed &= verifyTable("masterVolToAmpSubtraction", expectedMasterVolToAmpSubtraction, actual.masterVolToAmpSubtraction, 101);
+	passed &= verifyTable("pulseWidth100To255", expected.pulseWidth100To255, actual.pulseWidth100To255, 101);
+	passed &= verifyTable("exp9", expected.exp9, actual.exp9, 512);
+	passed &= verifyTable("logsin9", expected.logsin9, actual.logsin9, 512);
+	if (!passed) {
+		printf("The tables compiled into the library don't match the formulas\n");
+		return 1;
+	}
+	printf("All tables match the formulas\n");
+	return 0;
+}
+
+static void printUsage() {
+	fprintf(stderr,
+		"Usage: mt32emu-tablegen generate <TableData.cpp>\n"
+		"       mt32emu-tablegen verify\n");
+}
+
+int main(int argc, char *argv[]) {
+	if (argc == 3 && strcmp(argv[1], "generate") == 0) {
+		return generate(argv[2]);
+	}
+	if (argc == 2 && strcmp(argv[1], "verify") == 0) {
+		return verify();
+	}
+	printUsage();
+	return 2;
+}
@@ -0,0 +1,434 @@
+/* Copyright (C) 2011, 2012, 2013, 2014 Jerome Fisher, Sergey V. Mikayev
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Renders a batch of Standard MIDI Files to WAV files faster than real time.
+// Each worker thread runs its own Synth, while the ROM images are loaded once and shared by all of them.
+// The files are distributed among the workers via per-worker job queues. A worker that runs out of jobs
+// steals from the back of the fullest queue, so that a few long songs don't leave the other workers idle.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include <mt32emu/mt32emu.h>
+
+using namespace MT32Emu;
+
+static const unsigned int MAX_WORKER_COUNT = 64;
+
+// Length of the blocks rendered and written at a time, in output frames
+static const Bit32u BLOCK_LENGTH = 4096;
+
+#ifdef _WIN32
+
+typedef HANDLE ThreadHandle;
+typedef CRITICAL_SECTION Mutex;
+
+static void initMutex(Mutex &mutex) { InitializeCriticalSection(&mutex); }
+static void destroyMutex(Mutex &mutex) { DeleteCriticalSection(&mutex); }
+static void lockMutex(Mutex &mutex) { EnterCriticalSection(&mutex); }
+static void unlockMutex(Mutex &mutex) { LeaveCriticalSection(&mutex); }
+
+static unsigned int getProcessorCount() {
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwNumberOfProcessors;
+}
+
+#else
+
+typedef pthread_t ThreadHandle;
+typedef pthread_mutex_t Mutex;
+
+static void initMutex(Mutex &mutex) { pthread_mutex_init(&mutex, NULL); }
+static void destroyMutex(Mutex &mutex) { pthread_mutex_destroy(&mutex); }
+static void lockMutex(Mutex &mutex) { pthread_mutex_lock(&mutex); }
+static void unlockMutex(Mutex &mutex) { pthread_mutex_unlock(&mutex); }
+
+static unsigned int getProcessorCount() {
+	long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+	return processorCount > 0 ? (unsigned int)processorCount : 1;
+}
+
+#endif
+
+// Suppresses the debug output of the synths, which would otherwise be interleaved
+class QuietReportHandler : public ReportHandler {
+protected:
+	void printDebug(const char *, va_list) {}
+	void showLCDMessage(const char *) {}
+};
+
+struct Options {
+	const char *controlROMFileName;
+	const char *pcmROMFileName;
+	const char *outputDirectory;
+	unsigned int workerCount;
+	unsigned int sampleRate;
+	// Maximum length rendered after the last event while the synth remains active, in seconds
+	unsigned int maxTailLength;
+};
+
+struct Job {
+	const char *inputFileName;
+	char *outputFileName;
+	bool succeeded;
+	Bit64u renderedLength;
+};
+
+// Holds the jobs [start, end) of the shared job list. The owner takes jobs from the front, the thieves take them from the back.
+struct JobQueue {
+	Mutex mutex;
+	unsigned int start;
+	unsigned int end;
+};
+
+struct Worker {
+	ThreadHandle thread;
+	unsigned int index;
+	bool started;
+};
+
+static Options options;
+static const ROMImage *controlROMImage;
+static const ROMImage *pcmROMImage;
+static Job *jobs;
+static JobQueue jobQueues[MAX_WORKER_COUNT];
+static Worker workers[MAX_WORKER_COUNT];
+
+static Job *takeJob(unsigned int workerIndex) {
+	JobQueue &ownQueue = jobQueues[workerIndex];
+	lockMutex(ownQueue.mutex);
+	if (ownQueue.start < ownQueue.end) {
+		Job *job = &jobs[ownQueue.start++];
+		unlockMutex(ownQueue.mutex);
+		return job;
+	}
+	unlockMutex(ownQueue.mutex);
+	for (;;) {
+		// The remaining counts may change meanwhile, so the choice of the victim is only a hint
+		unsigned int victimIndex = workerIndex;
+		unsigned int victimJobCount = 0;
+		for (unsigned int i = 0; i < options.workerCount; i++) {
+			lockMutex(jobQueues[i].mutex);
+			unsigned int jobCount = jobQueues[i].end - jobQueues[i].start;
+			unlockMutex(jobQueues[i].mutex);
+			if (jobCount > victimJobCount) {
+				victimIndex = i;
+				victimJobCount = jobCount;
+			}
+		}
+		if (victimJobCount == 0) return NULL;
+		JobQueue &victimQueue = jobQueues[victimIndex];
+		lockMutex(victimQueue.mutex);
+		if (victimQueue.start < victimQueue.end) {
+			Job *job = &jobs[--victimQueue.end];
+			unlockMutex(victimQueue.mutex);
+			return job;
+		}
+		unlockMutex(victimQueue.mutex);
+	}
+}
+
+static void writeLittleEndian(FILE *file, Bit32u value, unsigned int byteCount) {
+	for (unsigned int i = 0; i < byteCount; i++) {
+		fputc((value >> (8 * i)) & 0xFF, file);
+	}
+}
+
+static void writeWAVHeader(FILE *file, Bit32u dataSize) {
+	fwrite("RIFF", 1, 4, file);
+	writeLittleEndian(file, 36 + dataSize, 4);
+	fwrite("WAVEfmt ", 1, 8, file);
+	writeLittleEndian(file, 16, 4);
+	// PCM, stereo, 16 bits per sample
+	writeLittleEndian(file, 1, 2);
+	writeLittleEndian(file, 2, 2);
+	writeLittleEndian(file, options.sampleRate, 4);
+	writeLittleEndian(file, options.sampleRate * 4, 4);
+	writeLittleEndian(file, 4, 2);
+	writeLittleEndian(file, 16, 2);
+	fwrite("data", 1, 4, file);
+	writeLittleEndian(file, dataSize, 4);
+}
+
+static bool renderJob(Synth &synth, SMFSequencer &sequencer, Job &job) {
+	FileStream inputFile;
+	if (!inputFile.open(job.inputFileName) || !sequencer.load(inputFile)) {
+		fprintf(stderr, "%s: Not a valid Standard MIDI File\n", job.inputFileName);
+		return false;
+	}
+	inputFile.close();
+	FILE *outputFile = fopen(job.outputFileName, "wb");
+	if (outputFile == NULL) {
+		fprintf(stderr, "%s: Can't create the output file\n", job.outputFileName);
+		return false;
+	}
+	// The actual data size is filled in when done
+	writeWAVHeader(outputFile, 0);
+
+	SampleRateConverter *converter = NULL;
+	Bit32u lookaheadLength = BLOCK_LENGTH;
+	if (options.sampleRate != SAMPLE_RATE) {
+		converter = new SampleRateConverter(synth, options.sampleRate, SampleRateConversionQuality_GOOD);
+		lookaheadLength = Bit32u(converter->convertOutputToSynthTimestamp(BLOCK_LENGTH)) + converter->getLookahead() + 1;
+	}
+	Bit64u songEndTimestamp = synth.getRenderedSampleCount() + sequencer.getSongLength();
+	Bit64u maxEndTimestamp = songEndTimestamp + Bit64u(options.maxTailLength) * SAMPLE_RATE;
+	Bit16s buffer[2 * BLOCK_LENGTH];
+	Bit64u renderedLength = 0;
+	bool succeeded = true;
+	for (;;) {
+		bool eventsPending = sequencer.enqueueEvents(lookaheadLength);
+		Bit64u timestamp = synth.getRenderedSampleCount();
+		// The MIDI interface delay may postpone the last events slightly, hence the extra block
+		if (!eventsPending && timestamp > songEndTimestamp + BLOCK_LENGTH && (!synth.isActive() || timestamp > maxEndTimestamp)) break;
+		if (converter != NULL) {
+			converter->getOutputSamples(buffer, BLOCK_LENGTH);
+		} else {
+			synth.render(buffer, BLOCK_LENGTH);
+		}
+		for (Bit32u i = 0; i < 2 * BLOCK_LENGTH; i++) {
+			writeLittleEndian(outputFile, Bit16u(buffer[i]), 2);
+		}
+		renderedLength += BLOCK_LENGTH;
+		// The size fields of the header are limited to 32 bits
+		if (renderedLength * 4 > 0xFFFFFFFFU - BLOCK_LENGTH * 4 - 36) {
+			fprintf(stderr, "%s: The output exceeds the maximum WAV file size, truncated\n", job.outputFileName);
+			break;
+		}
+	}
+	delete converter;
+	fseek(outputFile, 0, SEEK_SET);
+	writeWAVHeader(outputFile, Bit32u(renderedLength * 4));
+	if (ferror(outputFile)) {
+		fprintf(stderr, "%s: Error writing the output file\n", job.outputFileName);
+		succeeded = false;
+	}
+	fclose(outputFile);
+	job.renderedLength = renderedLength;
+	return succeeded;
+}
+
+static void runWorker(Worker &worker) {
+	QuietReportHandler reportHandler;
+	Synth synth(&reportHandler);
+	SMFSequencer sequencer(synth);
+	for (;;) {
+		Job *job = takeJob(worker.index);
+		if (job == NULL) break;
+		// Each song starts with the synth in the power-on state. Reopening is cheap since the ROM data is cached.
+		if (!synth.open(*controlROMImage, *pcmROMImage)) {
+			fprintf(stderr, "%s: Failed to initialise the synth\n", job->inputFileName);
+			continue;
+		}
+		job->succeeded = renderJob(synth, sequencer, *job);
+		sequencer.unload();
+		synth.close();
+	}
+}
+
+#ifdef _WIN32
+static unsigned long __stdcall workerThreadProc(void *worker) {
+	runWorker(*static_cast<Worker *>(worker));
+	return 0;
+}
+#else
+static void *workerThreadProc(void *worker) {
+	runWorker(*static_cast<Worker *>(worker));
+	return NULL;
+}
+#endif
+
+static bool startWorker(Worker &worker) {
+#ifdef _WIN32
+	worker.thread = CreateThread(NULL, 0, workerThreadProc, &worker, 0, NULL);
+	return worker.thread != NULL;
+#else
+	return pthread_create(&worker.thread, NULL, workerThreadProc, &worker) == 0;
+#endif
+}
+
+static void joinWorker(Worker &worker) {
+#ifdef _WIN32
+	WaitForSingleObject(worker.thread, INFINITE);
+	CloseHandle(worker.thread);
+#else
+	pthread_join(worker.thread, NULL);
+#endif
+}
+
+// Replaces the extension of the input file name with .wav, and the directory with the output directory if specified
+static char *makeOutputFileName(const char *inputFileName) {
+	const char *baseName = inputFileName;
+	for (const char *p = inputFileName; *p != 0; p++) {
+		if (*p == '/' || *p == '\\') baseName = p + 1;
+	}
+	const char *extension = strrchr(baseName, '.');
+	if (extension == NULL) extension = baseName + strlen(baseName);
+	// Without the output directory, the directory of the input file is kept as a part of the name
+	const char *name = (options.outputDirectory != NULL) ? baseName : inputFileName;
+	size_t nameLength = size_t(extension - name);
+	size_t directoryLength = (options.outputDirectory != NULL) ? strlen(options.outputDirectory) + 1 : 0;
+	char *outputFileName = new char[directoryLength + nameLength + 5];
+	if (options.outputDirectory != NULL) {
+		strcpy(outputFileName, options.outputDirectory);
+		outputFileName[directoryLength - 1] = '/';
+	}
+	memcpy(outputFileName + directoryLength, name, nameLength);
+	strcpy(outputFileName + directoryLength + nameLength, ".wav");
+	return outputFileName;
+}
+
+static void printUsage() {
+	fprintf(stderr,
+		"Usage: mt32emu-smf2wav [options] <file.mid>...\n"
+		"Renders each Standard MIDI File to a WAV file with the same name and the .wav extension.\n"
+		"Options:\n"
+		"  -c <file>   Control ROM image (default: MT32_CONTROL.ROM)\n"
+		"  -p <file>   PCM ROM image (default: MT32_PCM.ROM)\n"
+		"  -o <dir>    Directory to put the WAV files into (default: next to the MIDI files)\n"
+		"  -j <count>  Number of worker threads (default: number of processors)\n"
+		"  -r <rate>   Output sample rate (default: %u)\n"
+		"  -t <secs>   Maximum length of the tail rendered after the last event (default: %u)\n",
+		SAMPLE_RATE, options.maxTailLength);
+}
+
+int main(int argc, char *argv[]) {
+	options.controlROMFileName = "MT32_CONTROL.ROM";
+	options.pcmROMFileName = "MT32_PCM.ROM";
+	options.outputDirectory = NULL;
+	options.workerCount = getProcessorCount();
+	options.sampleRate = SAMPLE_RATE;
+	options.maxTailLength = 30;
+
+	int argIndex = 1;
+	for (; argIndex < argc && argv[argIndex][0] == '-'; argIndex++) {
+		const char *option = argv[argIndex];
+		if (option[1] == 0 || option[2] != 0 || argIndex + 1 >= argc) {
+			printUsage();
+			return 1;
+		}
+		const char *value = argv[++argIndex];
+		switch (option[1]) {
+		case 'c':
+			options.controlROMFileName = value;
+			break;
+		case 'p':
+			options.pcmROMFileName = value;
+			break;
+		case 'o':
+			options.outputDirectory = value;
+			break;
+		case 'j':
+			options.workerCount = (unsigned int)atoi(value);
+			break;
+		case 'r':
+			options.sampleRate = (unsigned int)atoi(value);
+			break;
+		case 't':
+			options.maxTailLength = (unsigned int)atoi(value);
+			break;
+		default:
+			printUsage();
+			return 1;
+		}
+	}
+	unsigned int jobCount = (unsigned int)(argc - argIndex);
+	if (jobCount == 0 || options.sampleRate == 0) {
+		printUsage();
+		return 1;
+	}
+	if (options.workerCount == 0) options.workerCount = 1;
+	if (options.workerCount > MAX_WORKER_COUNT) options.workerCount = MAX_WORKER_COUNT;
+	if (options.workerCount > jobCount) options.workerCount = jobCount;
+
+	// The ROM images are loaded only once. The synths share the decoded ROM data as well.
+	FileStream controlROMFile;
+	FileStream pcmROMFile;
+	if (!controlROMFile.open(options.controlROMFileName) || !pcmROMFile.open(options.pcmROMFileName)) {
+		fprintf(stderr, "Can't open the ROM files\n");
+		return 1;
+	}
+	controlROMImage = ROMImage::makeROMImage(&controlROMFile);
+	pcmROMImage = ROMImage::makeROMImage(&pcmROMFile);
+	if (controlROMImage->getROMInfo() == NULL || pcmROMImage->getROMInfo() == NULL) {
+		fprintf(stderr, "Unknown ROM images\n");
+		ROMImage::freeROMImage(controlROMImage);
+		ROMImage::freeROMImage(pcmROMImage);
+		return 1;
+	}
+
+	jobs = new Job[jobCount];
+	for (unsigned int i = 0; i < jobCount; i++) {
+		jobs[i].inputFileName = argv[argIndex + i];
+		jobs[i].outputFileName = makeOutputFileName(jobs[i].inputFileName);
+		jobs[i].succeeded = false;
+		jobs[i].renderedLength = 0;
+	}
+	// Initially, each worker gets an equal share of consecutive jobs
+	for (unsigned int i = 0; i < options.workerCount; i++) {
+		initMutex(jobQueues[i].mutex);
+		jobQueues[i].start = i * jobCount / options.workerCount;
+		jobQueues[i].end = (i + 1) * jobCount / options.workerCount;
+	}
+
+	time_t startTime = time(NULL);
+	// The main thread serves as the last worker. The jobs of the workers that failed to start are stolen by the others.
+	unsigned int threadCount = 1;
+	for (unsigned int i = 0; i < options.workerCount; i++) {
+		workers[i].index = i;
+		workers[i].started = i + 1 < options.workerCount && startWorker(workers[i]);
+		if (workers[i].started) {
+			threadCount++;
+		} else if (i + 1 < options.workerCount) {
+			fprintf(stderr, "Failed to start a worker thread\n");
+		}
+	}
+	runWorker(workers[options.workerCount - 1]);
+	for (unsigned int i = 0; i + 1 < options.workerCount; i++) {
+		if (workers[i].started) joinWorker(workers[i]);
+	}
+	double elapsedTime = difftime(time(NULL), startTime);
+
+	unsigned int succeededJobCount = 0;
+	double renderedTime = 0.0;
+	for (unsigned int i = 0; i < jobCount; i++) {
+		if (jobs[i].succeeded) {
+			succeededJobCount++;
+			renderedTime += double(jobs[i].renderedLength) / options.sampleRate;
+			printf("%s -> %s (%.1f s)\n", jobs[i].inputFileName, jobs[i].outputFileName, double(jobs[i].renderedLength) / options.sampleRate);
+		}
+		delete[] jobs[i].outputFileName;
+	}
+	printf("Rendered %u of %u files, %.0f s of audio in %.0f s using %u threads\n", succeededJobCount, jobCount, renderedTime, elapsedTime, threadCount);
+	delete[] jobs;
+	for (unsigned int i = 0; i < options.workerCount; i++) {
+		destroyMutex(jobQueues[i].mutex);
+	}
+	ROMImage::freeROMImage(controlROMImage);
+	ROMImage::freeROMImage(pcmROMImage);
+	return succeededJobCount == jobCount ? 0 : 1;
+}